@@ -0,0 +1,56 @@
+import network
+import socket
+import select
+import time
+
+from camera import Camera, FrameSize, PixelFormat, FanOut
+# Cam Config
+cam = Camera(frame_size = FrameSize.VGA,pixel_format=PixelFormat.JPEG,fb_count=2)
+
+# WLAN config
+ssid = '<yourSSID>'
+password = '<yourPW>'
+
+station = network.WLAN(network.STA_IF)
+station.active(True)
+station.connect(ssid, password)
+
+while not station.isconnected():
+    time.sleep(1)
+
+print(f'Connected! IP: {station.ifconfig()[0]}. Open http://{station.ifconfig()[0]}/stream in several browsers')
+
+# HTTP-Server starten
+addr = socket.getaddrinfo('0.0.0.0', 80)[0][-1]
+s = socket.socket()
+s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+s.bind(addr)
+s.listen(4)
+
+poller = select.poll()
+poller.register(s, select.POLLIN)
+
+# Each frame is captured once and sent to all viewers. Slow viewers skip frames instead of slowing down the others.
+fan = FanOut(cam, boundary='frame', max_fps=20)
+last_report = time.ticks_ms()
+
+while True:
+    # Accept new viewers without blocking the stream
+    if poller.poll(0):
+        client, client_addr = s.accept()
+        client.recv(1024)
+        client.send(b'HTTP/1.1 200 OK\r\nContent-Type: multipart/x-mixed-replace; boundary=frame\r\n\r\n')
+        fan.add(client)
+        print('Viewer connected:', client_addr)
+
+    if fan:
+        for client in fan.step():
+            print('Viewer disconnected')
+            client.close()
+    else:
+        time.sleep_ms(10)
+
+    if time.ticks_diff(time.ticks_ms(), last_report) > 5000:
+        last_report = time.ticks_ms()
+        for i, (client, delivered, dropped) in enumerate(fan.stats()):
+            print(f'Viewer {i}: {delivered} frames delivered, {dropped} dropped')
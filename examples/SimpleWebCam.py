@@ -68,13 +68,7 @@ def handle_client(client):
             response = b'HTTP/1.1 200 OK\r\nContent-Type: multipart/x-mixed-replace; boundary=frame\r\n\r\n'
             client.send(response)
             cam.init()
-            while cam:
-                frame = cam.capture()
-                if frame:
-                    client.send(b'--frame\r\n')
-                    client.send(b'Content-Type: image/jpeg\r\n\r\n' + frame + b'\r\n')
-                else:
-                    break
+            cam.stream_mjpeg(client, boundary='frame')  # Returns when the client disconnects
         else:
             response = 'HTTP/1.1 200 OK\r\nContent-Type: text/html\r\n\r\n' + html
             client.send(response.encode())
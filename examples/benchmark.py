@@ -1,109 +1,370 @@
-from camera import Camera, FrameSize, PixelFormat
+"""
+Benchmark suite of the camera API.
+
+Device mode sweeps frame_size x pixel_format x fb_count x grab_mode on the camera and records per point
+the FPS percentiles, the capture latency, the frame (JPEG) sizes and the heap/PSRAM high-water marks.
+Host mode measures the conversion and processing code (convert, stats, MotionDetector) on synthetic
+frames and does not touch the sensor, so it also runs without a camera connected.
+
+Every point captures a fixed number of frames (instead of running for a fixed time) and the report is
+written as JSON, so runs can be compared across firmware versions:
+
+    import benchmark
+    benchmark.run_device(out='device.json')
+    benchmark.run_host(out='host.json')
+    benchmark.compare('old.json', 'device.json')
+"""
+from camera import Camera, Frame, FrameSize, PixelFormat, GrabMode, MotionDetector
+import camera
+import array
+import json
 import time
 import gc
 import os
-gc.enable()
 
-def measure_fps(duration=2):
-    start_time = time.ticks_ms()
-    while time.ticks_ms() - start_time < 500:
-        cam.capture()
-    
-    start_time = time.ticks_ms()
-    frame_count = 0
+try:
+    import esp32
+except ImportError:
+    esp32 = None
+
+TICKS_PERIOD = 1 << 30  # time.ticks_us() wraps around at the MicroPython small int range
+PSRAM_MIN_HEAP = 1 << 20  # IDF heaps at least this large are counted as PSRAM
+
+DEVICE_CONFIG = {
+    'frames': 60,           # Frames measured per point
+    'warmup': 10,           # Frames discarded after each reconfiguration
+    'fb_counts': [1, 2],
+    'grab_modes': ['WHEN_EMPTY', 'LATEST'],
+    'pixel_formats': None,  # None: all formats supported by the sensor
+    'frame_sizes': None,    # None: all frame sizes up to the maximum of the sensor
+}
+
+HOST_CONFIG = {
+    'iterations': 20,
+    'frame_sizes': ['QQVGA', 'QVGA', 'VGA'],
+}
+
+HOST_SIZES = {'QQVGA': (160, 120), 'QVGA': (320, 240), 'VGA': (640, 480)}
+BYTES_PER_PIXEL = {'GRAYSCALE': 1, 'RGB565': 2, 'YUV422': 2, 'RGB444': 2, 'RGB555': 2, 'RGB888': 3}
+
+
+def names(cls):
+    return {getattr(cls, n): n for n in dir(cls) if not n.startswith('_')}
+
+
+def percentile(values, p):
+    # values must be sorted
+    if not values:
+        return None
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+
+def summary(values, pcts=(50, 90, 99)):
+    values = sorted(values)
+    if not values:
+        return None
+    result = {'n': len(values), 'min': values[0], 'max': values[-1], 'mean': round(sum(values) / len(values), 1)}
+    for p in pcts:
+        result['p' + str(p)] = percentile(values, p)
+    return result
+
 
-    while time.ticks_ms() - start_time < duration*1000:
+def psram_free():
+    """Free PSRAM and the lowest free PSRAM since boot (IDF low-water mark) in bytes."""
+    if esp32 is None:
+        return None, None
+    free = low = 0
+    for total, heap_free, largest, min_free in esp32.idf_heap_info(esp32.HEAP_DATA):
+        if total >= PSRAM_MIN_HEAP:
+            free += heap_free
+            low += min_free
+    return free, low
+
+
+def metadata():
+    u = os.uname()
+    meta = {'machine': u.machine, 'release': u.release, 'version': u.version,
+            'camera_api': getattr(camera, 'Version', None)}
+    if callable(meta['camera_api']):
+        meta['camera_api'] = meta['camera_api']()
+    return meta
+
+
+def write_report(report, out):
+    if out:
+        with open(out, 'w') as f:
+            json.dump(report, f)
+    print(json.dumps(report))
+    return report
+
+
+# ---------------------------------------------------------------------------------------------------------
+# Device mode
+# ---------------------------------------------------------------------------------------------------------
+
+def measure_point(cam, frames, warmup):
+    for _ in range(warmup):
         img = cam.capture()
         if img:
-            frame_count += 1
-
-    end_time = time.ticks_ms()
-    fps = frame_count / (end_time - start_time) * 1000
-    return round(fps,1)
-
-def print_summary_table(results, cam):
-    print(f"\nBenchmark {os.uname().machine} with {cam.get_sensor_name()}, GrabMode: {cam.get_grab_mode()}:")
-
-    fb_counts = sorted(results.keys())
-    frame_size_names = {getattr(FrameSize, f): f for f in dir(FrameSize) if not f.startswith('_')}
-    
-    header_row = f"{'Frame Size':<15}"
-    sub_header_row = " " * 15
-    
-    for fb in fb_counts:
-        for p in results[fb].keys():
-            header_row += f"{'fb_count ' + str(fb):<15}"
-            sub_header_row += f"{p:<15}"
-    
-    print(header_row)
-    print(sub_header_row)
-
-    frame_sizes = list(next(iter(next(iter(results.values())).values())).keys())
-    
-    for f in frame_sizes:
-        frame_size_name = frame_size_names.get(f, str(f))
-        print(f"{frame_size_name:<15}", end="")
-
-        for fb in fb_counts:
-            for p in results[fb].keys():
-                fps = results[fb][p].get(f, "N/A")
-                print(f"{fps:<15}", end="")
-        print()
+            img.release()
 
-if __name__ == "__main__":
-    cam = Camera()
-    results = {}
+    # Preallocated, so measuring does not trigger a garbage collection
+    capture_us = array.array('i', [0] * frames)
+    age_us = array.array('i', [0] * frames)
+    interval_us = array.array('i', [0] * frames)
+    sizes = array.array('i', [0] * frames)
+    gc.collect()
+    heap_base = gc.mem_alloc()
+    heap_peak = heap_base
+    psram_start, _ = psram_free()
+    cam.frame_stats(reset=True)
+    cam.perf(reset=True)
+
+    n = intervals = failed = 0
+    last = None
+    for _ in range(frames):
+        t0 = time.ticks_us()
+        img = cam.capture()
+        t1 = time.ticks_us()
+        if not img:
+            failed += 1
+            continue
+        capture_us[n] = time.ticks_diff(t1, t0)
+        age_us[n] = time.ticks_diff(t1, img.timestamp % TICKS_PERIOD)
+        sizes[n] = len(img)
+        img.release()
+        n += 1
+        if last is not None:
+            interval_us[intervals] = time.ticks_diff(t1, last)
+            intervals += 1
+        last = t1
+        heap_peak = max(heap_peak, gc.mem_alloc())
+
+    psram_end, psram_low = psram_free()
+    intervals = sorted(interval_us[:intervals])
+    result = {
+        'frames': n,
+        'failed': failed,
+        'fps': None,
+        'capture_us': summary(capture_us[:n]),
+        'age_us': summary(age_us[:n]),
+        'frame_bytes': summary(sizes[:n], ()),
+        'heap': {'base': heap_base, 'peak': heap_peak},
+        'psram': {'free_start': psram_start, 'free_end': psram_end, 'low_water': psram_low},
+        'frame_stats': cam.frame_stats(),
+        'perf': cam.perf(),
+    }
+    if intervals:
+        # Slow frames are the interesting ones: p10 is the FPS which 90% of the frames reach
+        result['fps'] = {
+            'mean': round(1000000 * len(intervals) / sum(intervals), 2),
+            'p50': round(1000000 / percentile(intervals, 50), 2),
+            'p10': round(1000000 / percentile(intervals, 90), 2),
+            'p1': round(1000000 / percentile(intervals, 99), 2),
+        }
+    return result
+
+
+def run_device(out=None, cam=None, **config):
+    """Sweep the camera configurations and return (and write to out) the JSON report."""
+    cfg = dict(DEVICE_CONFIG)
+    cfg.update(config)
+    own_cam = cam is None
+    if own_cam:
+        cam = Camera()
 
+    formats = names(PixelFormat)
+    sizes = names(FrameSize)
+    modes = {n: getattr(GrabMode, n) for n in cfg['grab_modes']}
+    pixel_formats = cfg['pixel_formats'] or [f for f in formats.values() if f not in ('RAW', 'YUV420')]
+    frame_sizes = cfg['frame_sizes'] or [sizes[v] for v in sorted(sizes) if v <= cam.max_frame_size]
+
+    report = {'mode': 'device', 'meta': metadata(), 'config': cfg, 'points': []}
+    report['meta']['sensor'] = cam.sensor_name
     try:
-        for fb in [1, 2]:
-            cam.reconfigure(fb_count=fb)
-            results[fb] = {}
-            for p in dir(PixelFormat):
-                if not p.startswith('_'):
-                    p_value = getattr(PixelFormat, p)
-                    if (p_value == PixelFormat.RGB888 and cam.get_sensor_name() == "OV2640") or (p_value != PixelFormat.JPEG and fb > 1):
-                        continue
-                    try:
-                        cam.reconfigure(pixel_format=p_value)
-                        results[fb][p] = {}
-                    except Exception as e:
-                        print('ERR:', e)
-                        continue
-
-                    for f in dir(FrameSize):
-                        if not f.startswith('_'):
-                            f_value = getattr(FrameSize, f)
-                            if f_value > cam.get_max_frame_size():
-                                continue
-                            gc.collect()
-                            print('Set', p, f,f'fb={fb}',':')
-
-                            try:
-                                cam.reconfigure(frame_size=f_value) #set_frame_size fails for YUV422
-                                time.sleep_ms(10)
-                                img = cam.capture()
-                                
-                                if img:
-                                    print('---> Image size:', len(img))
-                                    fps = measure_fps(2)
-                                    print(f"---> FPS: {fps}")
-                                    results[fb][p][f_value] = fps
-                                else:
-                                    print('No image captured')
-                                    results[fb][p][f_value] = 'No img'
-                                
-                                print(f"---> Free Memory: {gc.mem_free()}")
-                            except Exception as e:
-                                print('ERR:', e)
-                                results[fb][p][f_value] = 'ERR'
-                            finally:
-                                time.sleep_ms(250)
+        for fb in cfg['fb_counts']:
+            for mode_name, mode in modes.items():
+                for p in pixel_formats:
+                    for f in frame_sizes:
+                        point = {'key': f'{f}/{p}/fb{fb}/{mode_name}',
+                                 'frame_size': f, 'pixel_format': p, 'fb_count': fb, 'grab_mode': mode_name}
+                        print('Measuring', point['key'])
+                        try:
+                            mem = camera.estimate_memory(getattr(FrameSize, f), getattr(PixelFormat, p), fb)
+                            if not mem['fits']:
+                                point['error'] = 'does not fit into memory'
+                            else:
                                 gc.collect()
-                                print('')
-
+                                cam.reconfigure(frame_size=getattr(FrameSize, f), pixel_format=getattr(PixelFormat, p),
+                                                fb_count=fb, grab_mode=mode)
+                                point.update(measure_point(cam, cfg['frames'], cfg['warmup']))
+                                if not point['frames']:
+                                    point['error'] = 'no frame'
+                        except Exception as e:
+                            point['error'] = str(e)
+                        report['points'].append(point)
     except KeyboardInterrupt:
-        print("\nScript interrupted by user.")
-
+        report['interrupted'] = True
     finally:
-        print_summary_table(results, cam)
-        cam.deinit()
+        if own_cam:
+            cam.deinit()
+    print_summary_table(report)
+    return write_report(report, out)
+
+
+# ---------------------------------------------------------------------------------------------------------
+# Host mode
+# ---------------------------------------------------------------------------------------------------------
+
+def synthetic_image(width, height, bpp, shift=0):
+    """Deterministic test image: a noisy gradient row, shifted by `shift` pixels per line."""
+    seed = 12345
+    row = bytearray(width * bpp)
+    for i in range(len(row)):
+        seed = (seed * 1103515245 + 12345) & 0x7FFFFFFF
+        row[i] = ((i * 255) // len(row) + (seed >> 24)) & 0xFF
+    image = bytearray(width * height * bpp)
+    step = shift * bpp
+    for y in range(height):
+        k = (y * step) % len(row)
+        image[y * len(row):(y + 1) * len(row)] = row[k:] + row[:k]
+    return image
+
+
+def timed(fn, iterations):
+    times = array.array('i', [0] * iterations)
+    fn()    # Warm up, e.g. allocate lazily created buffers
+    gc.collect()
+    heap_base = gc.mem_alloc()
+    for i in range(iterations):
+        t0 = time.ticks_us()
+        fn()
+        times[i] = time.ticks_diff(time.ticks_us(), t0)
+    result = summary(times)
+    result['heap_delta'] = gc.mem_alloc() - heap_base
+    return result
+
+
+def run_host(out=None, **config):
+    """Measure conversion and processing on synthetic frames and return (and write to out) the JSON report."""
+    cfg = dict(HOST_CONFIG)
+    cfg.update(config)
+    n = cfg['iterations']
+    report = {'mode': 'host', 'meta': metadata(), 'config': cfg, 'points': []}
+
+    def add(key, fn, pixels):
+        gc.collect()
+        try:
+            point = timed(fn, n)
+            point['mpix_s'] = round(pixels / point['p50'], 2) if point['p50'] else None
+        except Exception as e:
+            point = {'error': str(e)}
+        point['key'] = key
+        report['points'].append(point)
+        print(key, point.get('p50', point.get('error')))
+
+    for size in cfg['frame_sizes']:
+        w, h = HOST_SIZES[size]
+        images = {fmt: synthetic_image(w, h, bpp) for fmt, bpp in BYTES_PER_PIXEL.items()}
+
+        for src in BYTES_PER_PIXEL:
+            for dst in BYTES_PER_PIXEL:
+                if src == dst:
+                    continue
+                out_buf = bytearray(w * h * BYTES_PER_PIXEL[dst])
+                src_fmt, dst_fmt = getattr(PixelFormat, src), getattr(PixelFormat, dst)
+                try:
+                    camera.convert(images[src], src_fmt, dst_fmt, out=out_buf)
+                except ValueError:
+                    continue    # Conversion not supported
+                add(f'convert/{src}>{dst}/{size}',
+                    lambda s=images[src], o=out_buf, a=src_fmt, b=dst_fmt: camera.convert(s, a, b, out=o), w * h)
+
+        for fmt in ('GRAYSCALE', 'RGB565', 'RGB888', 'YUV422'):
+            frame = Frame(images[fmt], w, h, getattr(PixelFormat, fmt))
+            add(f'stats/{fmt}/{size}', lambda f=frame: camera.stats(f), w * h)
+            add(f'stats/{fmt}/stride4/{size}', lambda f=frame: camera.stats(f, stride=4), w * h)
+
+        for fmt in ('GRAYSCALE', 'YUV422'):
+            frames = [Frame(synthetic_image(w, h, BYTES_PER_PIXEL[fmt], shift), w, h, getattr(PixelFormat, fmt))
+                      for shift in (0, 3)]
+            detector = MotionDetector()
+            state = [0]
+
+            def detect(d=detector, fs=frames, s=state):
+                s[0] ^= 1
+                d.detect(fs[s[0]])
+                d.boxes()
+            add(f'motion/{fmt}/{size}', detect, w * h)
+        del images
+    return write_report(report, out)
+
+
+# ---------------------------------------------------------------------------------------------------------
+# Reporting
+# ---------------------------------------------------------------------------------------------------------
+
+def print_summary_table(report):
+    """Print the median FPS of a device report as a table of frame sizes x configurations."""
+    points = [p for p in report['points'] if 'frame_size' in p]
+    if not points:
+        return
+    print(f"\nBenchmark {report['meta']['machine']} with {report['meta'].get('sensor')} (median FPS):")
+    columns = []
+    rows = []
+    table = {}
+    for p in points:
+        column = f"{p['pixel_format']}/fb{p['fb_count']}/{p['grab_mode']}"
+        if column not in columns:
+            columns.append(column)
+        if p['frame_size'] not in rows:
+            rows.append(p['frame_size'])
+        fps = p.get('fps')
+        table[(p['frame_size'], column)] = fps['p50'] if fps else p.get('error', 'N/A')[:12]
+    width = max(len(c) for c in columns) + 2
+
+    def cell(value):
+        value = str(value)
+        return value + ' ' * (width - len(value))
+    print(f"{'Frame Size':<12}" + ''.join(cell(c) for c in columns))
+    for r in rows:
+        print(f"{r:<12}" + ''.join(cell(table.get((r, c), '')) for c in columns))
+
+
+def compare(old, new, threshold=5):
+    """Compare two reports (dicts or JSON file names) point by point and print changes above threshold percent."""
+    def load(r):
+        if isinstance(r, str):
+            with open(r) as f:
+                return json.load(f)
+        return r
+
+    def metric(p):
+        # Higher is better for FPS and throughput
+        if p.get('fps'):
+            return 'fps p50', p['fps']['p50'], True
+        if 'p50' in p:
+            return 'p50 us', p['p50'], False
+        return None, None, None
+
+    old, new = load(old), load(new)
+    before = {p['key']: p for p in old['points']}
+    print(f"{old['meta'].get('version')} -> {new['meta'].get('version')}")
+    for p in new['points']:
+        q = before.get(p['key'])
+        if q is None:
+            continue
+        name, a, higher_better = metric(q)
+        _, b, _ = metric(p)
+        if not a or b is None:
+            continue
+        change = (b - a) * 100 / a
+        if abs(change) >= threshold:
+            better = (change > 0) == higher_better
+            print(f"{p['key']:<40} {name}: {a} -> {b} ({change:+.1f}%, {'better' if better else 'worse'})")
+
+
+if __name__ == "__main__":
+    gc.enable()
+    run_host(out='benchmark_host.json')
+    run_device(out='benchmark_device.json')
@@ -0,0 +1,39 @@
+"""
+Records frames of a camera into a file, which the host build replays instead of the synthetic sensor.
+
+Record on the board (e.g. onto an SD card) or on the host, then replay the file on the unix port:
+
+    import record
+    with Camera(pixel_format=PixelFormat.JPEG, frame_size=FrameSize.VGA) as cam:
+        record.record(cam, 'walk.mcr', frames=300)
+
+    MICROPY_CAMERA_REPLAY=walk.mcr micropython benchmark.py
+
+The file starts with a 16 byte header ("MPCR", version, pixel format, width, height), followed by
+the frames, each with its timestamp and length. All frames have the pixel format and size of the header.
+PreEventBuffer.dump writes the same format.
+"""
+from camera import Camera, FrameSize, PixelFormat
+import struct
+import time
+
+MAGIC = b'MPCR'
+VERSION = 1
+
+def record(cam, path, frames=100):
+    """Captures frames into path and returns the number of dropped sensor frames."""
+    with open(path, 'wb') as f:
+        f.write(MAGIC + struct.pack('<BBHHHI', VERSION, cam.get_pixel_format(), 0,
+                                    cam.get_pixel_width(), cam.get_pixel_height(), 0))
+        cam.frame_stats(reset=True)
+        for _ in range(frames):
+            with cam.capture() as frame:
+                f.write(struct.pack('<qI', frame.timestamp, len(frame)))
+                f.write(frame)
+    return cam.frame_stats()['dropped']
+
+if __name__ == "__main__":
+    with Camera(pixel_format=PixelFormat.JPEG, frame_size=FrameSize.VGA) as cam:
+        start = time.ticks_ms()
+        dropped = record(cam, 'recording.mcr')
+        print("Recorded 100 frames in", time.ticks_diff(time.ticks_ms(), start), "ms,", dropped, "dropped")
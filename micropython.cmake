@@ -7,11 +7,22 @@ add_library(usermod_mp_camera INTERFACE)
 target_sources(usermod_mp_camera INTERFACE
     ${CMAKE_CURRENT_LIST_DIR}/src/modcamera.c
     ${CMAKE_CURRENT_LIST_DIR}/src/modcamera_api.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/modcamera_frame.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/modcamera_stream.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/modcamera_analysis.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/camera_conv.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/camera_motion.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/camera_stats.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/camera_exposure.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/camera_avi.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/camera_ring.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/camera_jpeg.c
 )
 
 idf_component_get_property(camera_dir esp32-camera COMPONENT_DIR)
 target_include_directories(usermod_mp_camera INTERFACE
     ${camera_dir}/driver/include
+    ${camera_dir}/conversions/include
 )
 
 #     # Set MP_CAMERA_DRIVER_VERSION if available
@@ -0,0 +1,133 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Christopher Nadler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "camera_avi.h"
+
+#define DEFAULT_US_PER_FRAME (33333)
+
+// Offsets of the chunks in the header
+#define HDRL_OFFSET     (12)
+#define AVIH_OFFSET     (24)
+#define STRL_OFFSET     (88)
+#define STRH_OFFSET     (100)
+#define STRF_OFFSET     (164)
+#define JUNK_OFFSET     (212)
+#define MOVI_OFFSET     (CAMERA_AVI_HEADER_SIZE - 12)
+
+#define AVIF_HASINDEX   (0x10)
+#define AVIIF_KEYFRAME  (0x10)
+
+static inline void put_u16(uint8_t *p, uint16_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static inline void put_u32(uint8_t *p, uint32_t v) {
+    put_u16(p, v);
+    put_u16(p + 2, v >> 16);
+}
+
+static inline uint8_t *put_chunk(uint8_t *p, const char *fourcc, uint32_t size) {
+    memcpy(p, fourcc, 4);
+    put_u32(p + 4, size);
+    return p + 8;
+}
+
+// LIST chunk of size bytes from the list type (incl.) to the end of the list
+static inline uint8_t *put_list(uint8_t *p, const char *type, uint32_t size) {
+    p = put_chunk(p, "LIST", size);
+    memcpy(p, type, 4);
+    return p + 4;
+}
+
+uint64_t camera_avi_file_size(const camera_avi_info_t *info) {
+    return (uint64_t)CAMERA_AVI_HEADER_SIZE + info->movi_size
+           + CAMERA_AVI_CHUNK_HEADER_SIZE + (uint64_t)info->frames * CAMERA_AVI_INDEX_ENTRY_SIZE;
+}
+
+void camera_avi_header(const camera_avi_info_t *info, uint8_t dst[CAMERA_AVI_HEADER_SIZE]) {
+    uint32_t us_per_frame = info->us_per_frame ? info->us_per_frame : DEFAULT_US_PER_FRAME;
+    uint64_t file_size = camera_avi_file_size(info);
+    memset(dst, 0, CAMERA_AVI_HEADER_SIZE);
+
+    memcpy(dst, "RIFF", 4);
+    put_u32(dst + 4, file_size > UINT32_MAX + 8ULL ? UINT32_MAX : (uint32_t)(file_size - 8));
+    memcpy(dst + 8, "AVI ", 4);
+    put_list(dst + HDRL_OFFSET, "hdrl", JUNK_OFFSET - HDRL_OFFSET - 8);
+
+    // Main header
+    uint8_t *p = put_chunk(dst + AVIH_OFFSET, "avih", STRL_OFFSET - AVIH_OFFSET - 8);
+    put_u32(p, us_per_frame);
+    put_u32(p + 4, (uint32_t)((uint64_t)info->max_len * 1000000 / us_per_frame));
+    put_u32(p + 12, AVIF_HASINDEX);
+    put_u32(p + 16, info->frames);
+    put_u32(p + 24, 1);                 // Streams
+    put_u32(p + 28, info->max_len);     // Suggested buffer size
+    put_u32(p + 32, info->width);
+    put_u32(p + 36, info->height);
+
+    // Stream header, the rate is 1000000 / us_per_frame
+    put_list(dst + STRL_OFFSET, "strl", JUNK_OFFSET - STRL_OFFSET - 8);
+    p = put_chunk(dst + STRH_OFFSET, "strh", STRF_OFFSET - STRH_OFFSET - 8);
+    memcpy(p, "vidsMJPG", 8);
+    put_u32(p + 20, us_per_frame);      // Scale
+    put_u32(p + 24, 1000000);           // Rate
+    put_u32(p + 32, info->frames);      // Length
+    put_u32(p + 36, info->max_len);
+    put_u32(p + 40, UINT32_MAX);        // Quality: default
+    put_u16(p + 52, info->width);       // Frame rectangle
+    put_u16(p + 54, info->height);
+
+    // Stream format (BITMAPINFOHEADER)
+    p = put_chunk(dst + STRF_OFFSET, "strf", JUNK_OFFSET - STRF_OFFSET - 8);
+    put_u32(p, JUNK_OFFSET - STRF_OFFSET - 8);
+    put_u32(p + 4, info->width);
+    put_u32(p + 8, info->height);
+    put_u16(p + 12, 1);                 // Planes
+    put_u16(p + 14, 24);                // Bits per pixel of the decoded image
+    memcpy(p + 16, "MJPG", 4);
+    put_u32(p + 20, (uint32_t)info->width * info->height * 3);
+
+    // Padding, so the frame data starts at CAMERA_AVI_HEADER_SIZE
+    put_chunk(dst + JUNK_OFFSET, "JUNK", MOVI_OFFSET - JUNK_OFFSET - 8);
+    put_list(dst + MOVI_OFFSET, "movi", 4 + info->movi_size);
+}
+
+void camera_avi_chunk_header(uint32_t len, uint8_t dst[CAMERA_AVI_CHUNK_HEADER_SIZE]) {
+    put_chunk(dst, "00dc", len);
+}
+
+void camera_avi_index_header(const camera_avi_info_t *info, uint8_t dst[CAMERA_AVI_CHUNK_HEADER_SIZE]) {
+    put_chunk(dst, "idx1", info->frames * CAMERA_AVI_INDEX_ENTRY_SIZE);
+}
+
+void camera_avi_index_entry(uint32_t offset, uint32_t len, uint8_t dst[CAMERA_AVI_INDEX_ENTRY_SIZE]) {
+    // Offsets are relative to the 'movi' list type, which precedes the first chunk
+    memcpy(dst, "00dc", 4);
+    put_u32(dst + 4, AVIIF_KEYFRAME);
+    put_u32(dst + 8, 4 + offset);
+    put_u32(dst + 12, len);
+}
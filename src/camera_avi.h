@@ -0,0 +1,92 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Christopher Nadler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MICROPY_INCLUDED_CAMERA_AVI_H
+#define MICROPY_INCLUDED_CAMERA_AVI_H
+
+// Layout of AVI files with a single MJPEG video stream, as written by AVIRecorder (see modcamera_stream.c).
+// Like camera_conv.c, this file does not depend on MicroPython or on a camera driver.
+//
+// File layout:
+//   header (CAMERA_AVI_HEADER_SIZE bytes): RIFF 'AVI ', LIST 'hdrl' (avih, LIST 'strl' (strh, strf)), JUNK, LIST 'movi'
+//   frames: '00dc' chunks of the JPEG data, padded to an even length
+//   index:  idx1 chunk with one CAMERA_AVI_INDEX_ENTRY_SIZE entry per frame
+// The header is padded, so the frame data starts at a sector boundary. Frame counts and sizes are only known
+// at the end, the header is written again when the recording is finished.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CAMERA_AVI_HEADER_SIZE      (512)
+#define CAMERA_AVI_CHUNK_HEADER_SIZE (8)
+#define CAMERA_AVI_INDEX_ENTRY_SIZE (16)
+
+/**
+ * @brief Parameters of the header of a recording.
+ */
+typedef struct _camera_avi_info_t {
+    uint16_t    width;
+    uint16_t    height;
+    uint32_t    frames;
+    uint32_t    us_per_frame;   // Mean frame period, 0 defaults to 30 fps
+    uint32_t    max_len;        // Length of the largest frame
+    uint32_t    movi_size;      // Size of all frame chunks incl. chunk headers and padding
+} camera_avi_info_t;
+
+/**
+ * @brief Returns the size of the chunk of a frame incl. chunk header and padding.
+ */
+static inline uint32_t camera_avi_chunk_size(uint32_t len) {
+    return CAMERA_AVI_CHUNK_HEADER_SIZE + len + (len & 1);
+}
+
+/**
+ * @brief Returns the size of the complete file incl. index.
+ */
+extern uint64_t camera_avi_file_size(const camera_avi_info_t *info);
+
+/**
+ * @brief Writes the file header.
+ */
+extern void camera_avi_header(const camera_avi_info_t *info, uint8_t dst[CAMERA_AVI_HEADER_SIZE]);
+
+/**
+ * @brief Writes the header of a frame chunk. The data follows, with a zero byte after data of odd length.
+ */
+extern void camera_avi_chunk_header(uint32_t len, uint8_t dst[CAMERA_AVI_CHUNK_HEADER_SIZE]);
+
+/**
+ * @brief Writes the header of the idx1 chunk, which is followed by the entries of all frames.
+ */
+extern void camera_avi_index_header(const camera_avi_info_t *info, uint8_t dst[CAMERA_AVI_CHUNK_HEADER_SIZE]);
+
+/**
+ * @brief Writes the index entry of a frame.
+ *
+ * @param offset Offset of the frame chunk from the first frame chunk.
+ * @param len Length of the frame data.
+ */
+extern void camera_avi_index_entry(uint32_t offset, uint32_t len, uint8_t dst[CAMERA_AVI_INDEX_ENTRY_SIZE]);
+
+#endif // MICROPY_INCLUDED_CAMERA_AVI_H
@@ -0,0 +1,476 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Christopher Nadler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "camera_conv.h"
+
+// The word-at-a-time kernels load two or four pixels into a uint32_t and pick them apart with shifts.
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error camera_conv.c assumes a little endian target
+#endif
+
+#define CONV_NUM_FORMATS    (CAMERA_CONV_RGB555 + 1)
+#define CLAMP_OFFSET        (256)
+
+// Lookup tables, filled once on first use
+static bool tables_ready = false;
+static uint8_t expand5[32];             // 5 bit -> 8 bit
+static uint8_t expand6[64];             // 6 bit -> 8 bit
+static uint8_t clamp_table[768];        // index + CLAMP_OFFSET -> 0..255
+static int16_t yuv_vr[256];             // V contribution to R
+static int16_t yuv_ub[256];             // U contribution to B
+static int16_t yuv_ug[256];             // U contribution to G
+static int16_t yuv_vg[256];             // V contribution to G
+static uint16_t luma565_hi[256];        // High byte of a RGB565 pixel -> luma * 256
+static uint16_t luma565_lo[256];        // Low byte of a RGB565 pixel -> luma * 256
+static uint16_t gray_to_565[256];
+static uint16_t rgb444_hi[256];         // High byte of a RGB444 pixel -> RGB565 bits
+static uint16_t rgb444_lo[256];         // Low byte of a RGB444 pixel -> RGB565 bits
+
+static void init_tables(void) {
+    if (tables_ready) {
+        return;
+    }
+    for (int i = 0; i < 32; i++) {
+        expand5[i] = (i << 3) | (i >> 2);
+    }
+    for (int i = 0; i < 64; i++) {
+        expand6[i] = (i << 2) | (i >> 4);
+    }
+    for (int i = 0; i < 768; i++) {
+        int v = i - CLAMP_OFFSET;
+        clamp_table[i] = v < 0 ? 0 : (v > 255 ? 255 : v);
+    }
+    // BT.601 full range (JFIF) coefficients in 16.16 fixed point
+    for (int i = 0; i < 256; i++) {
+        int c = i - 128;
+        yuv_vr[i] = (91881 * c + 32768) >> 16;
+        yuv_ub[i] = (116130 * c + 32768) >> 16;
+        yuv_ug[i] = (-22554 * c + 32768) >> 16;
+        yuv_vg[i] = (-46802 * c + 32768) >> 16;
+    }
+    // Luma = (77 R + 150 G + 29 B + 128) >> 8. The 8 bit expansion of R and B depends on one byte only,
+    // the expansion of G is the sum of independent bits from both bytes, so the luma splits into two tables.
+    for (int i = 0; i < 256; i++) {
+        int r = expand5[i >> 3];
+        int g_hi = ((i & 0x07) << 5) + ((i & 0x07) >> 1);
+        int g_lo = (i >> 5) << 2;
+        int b = expand5[i & 0x1F];
+        luma565_hi[i] = 77 * r + 150 * g_hi + 128;
+        luma565_lo[i] = 150 * g_lo + 29 * b;
+        gray_to_565[i] = ((i & 0xF8) << 8) | ((i & 0xFC) << 3) | (i >> 3);
+        int r4 = i & 0x0F;
+        int g4 = i >> 4;
+        int b4 = i & 0x0F;
+        rgb444_hi[i] = ((r4 << 1) | (r4 >> 3)) << 11;
+        rgb444_lo[i] = (((g4 << 2) | (g4 >> 2)) << 5) | ((b4 << 1) | (b4 >> 3));
+    }
+    tables_ready = true;
+}
+
+static inline uint32_t load32(const uint8_t *p) {
+    uint32_t w;
+    memcpy(&w, p, sizeof(w));
+    return w;
+}
+
+static inline void store32(uint8_t *p, uint32_t w) {
+    memcpy(p, &w, sizeof(w));
+}
+
+static inline void store565(uint8_t *dst, uint16_t p) {
+    dst[0] = p >> 8;
+    dst[1] = p & 0xFF;
+}
+
+static inline uint16_t pack565(uint8_t r, uint8_t g, uint8_t b) {
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+}
+
+// Kernels
+typedef void (*conv_kernel_t)(const uint8_t *src, uint8_t *dst, size_t pixels);
+
+static void rgb565_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels) {
+    size_t i = 0;
+    for (; i + 2 <= pixels; i += 2, src += 4, dst += 6) {
+        uint32_t w = load32(src);
+        uint8_t h0 = w, l0 = w >> 8, h1 = w >> 16, l1 = w >> 24;
+        dst[0] = expand5[h0 >> 3];
+        dst[1] = expand6[((h0 & 0x07) << 3) | (l0 >> 5)];
+        dst[2] = expand5[l0 & 0x1F];
+        dst[3] = expand5[h1 >> 3];
+        dst[4] = expand6[((h1 & 0x07) << 3) | (l1 >> 5)];
+        dst[5] = expand5[l1 & 0x1F];
+    }
+    if (i < pixels) {
+        dst[0] = expand5[src[0] >> 3];
+        dst[1] = expand6[((src[0] & 0x07) << 3) | (src[1] >> 5)];
+        dst[2] = expand5[src[1] & 0x1F];
+    }
+}
+
+static void rgb565_to_grayscale(const uint8_t *src, uint8_t *dst, size_t pixels) {
+    size_t i = 0;
+    for (; i + 4 <= pixels; i += 4, src += 8, dst += 4) {
+        uint32_t w0 = load32(src);
+        uint32_t w1 = load32(src + 4);
+        uint32_t y0 = (luma565_hi[w0 & 0xFF] + luma565_lo[(w0 >> 8) & 0xFF]) >> 8;
+        uint32_t y1 = (luma565_hi[(w0 >> 16) & 0xFF] + luma565_lo[w0 >> 24]) >> 8;
+        uint32_t y2 = (luma565_hi[w1 & 0xFF] + luma565_lo[(w1 >> 8) & 0xFF]) >> 8;
+        uint32_t y3 = (luma565_hi[(w1 >> 16) & 0xFF] + luma565_lo[w1 >> 24]) >> 8;
+        store32(dst, y0 | (y1 << 8) | (y2 << 16) | (y3 << 24));
+    }
+    for (; i < pixels; i++, src += 2) {
+        *dst++ = (luma565_hi[src[0]] + luma565_lo[src[1]]) >> 8;
+    }
+}
+
+static void rgb888_to_rgb565(const uint8_t *src, uint8_t *dst, size_t pixels) {
+    for (size_t i = 0; i < pixels; i++, src += 3, dst += 2) {
+        dst[0] = (src[0] & 0xF8) | (src[1] >> 5);
+        dst[1] = ((src[1] << 3) & 0xE0) | (src[2] >> 3);
+    }
+}
+
+static void rgb888_to_grayscale(const uint8_t *src, uint8_t *dst, size_t pixels) {
+    for (size_t i = 0; i < pixels; i++, src += 3) {
+        *dst++ = (77 * src[0] + 150 * src[1] + 29 * src[2] + 128) >> 8;
+    }
+}
+
+static void yuv422_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels) {
+    const uint8_t *clamp = clamp_table + CLAMP_OFFSET;
+    for (size_t i = 0; i + 2 <= pixels; i += 2, src += 4, dst += 6) {
+        uint32_t w = load32(src);
+        int y0 = w & 0xFF, u = (w >> 8) & 0xFF, y1 = (w >> 16) & 0xFF, v = w >> 24;
+        int r = yuv_vr[v];
+        int g = yuv_ug[u] + yuv_vg[v];
+        int b = yuv_ub[u];
+        dst[0] = clamp[y0 + r];
+        dst[1] = clamp[y0 + g];
+        dst[2] = clamp[y0 + b];
+        dst[3] = clamp[y1 + r];
+        dst[4] = clamp[y1 + g];
+        dst[5] = clamp[y1 + b];
+    }
+}
+
+static void yuv422_to_rgb565(const uint8_t *src, uint8_t *dst, size_t pixels) {
+    const uint8_t *clamp = clamp_table + CLAMP_OFFSET;
+    for (size_t i = 0; i + 2 <= pixels; i += 2, src += 4, dst += 4) {
+        uint32_t w = load32(src);
+        int y0 = w & 0xFF, u = (w >> 8) & 0xFF, y1 = (w >> 16) & 0xFF, v = w >> 24;
+        int r = yuv_vr[v];
+        int g = yuv_ug[u] + yuv_vg[v];
+        int b = yuv_ub[u];
+        store565(dst, pack565(clamp[y0 + r], clamp[y0 + g], clamp[y0 + b]));
+        store565(dst + 2, pack565(clamp[y1 + r], clamp[y1 + g], clamp[y1 + b]));
+    }
+}
+
+static void yuv422_to_grayscale(const uint8_t *src, uint8_t *dst, size_t pixels) {
+    size_t i = 0;
+    for (; i + 4 <= pixels; i += 4, src += 8, dst += 4) {
+        uint32_t w0 = load32(src);
+        uint32_t w1 = load32(src + 4);
+        store32(dst, (w0 & 0xFF) | ((w0 >> 8) & 0xFF00) | ((w1 & 0xFF) << 16) | ((w1 << 8) & 0xFF000000));
+    }
+    for (; i < pixels; i++, src += 2) {
+        *dst++ = src[0];
+    }
+}
+
+static void grayscale_to_rgb565(const uint8_t *src, uint8_t *dst, size_t pixels) {
+    for (size_t i = 0; i < pixels; i++, dst += 2) {
+        store565(dst, gray_to_565[*src++]);
+    }
+}
+
+static void grayscale_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels) {
+    for (size_t i = 0; i < pixels; i++, dst += 3) {
+        dst[0] = dst[1] = dst[2] = *src++;
+    }
+}
+
+static void rgb444_to_rgb565(const uint8_t *src, uint8_t *dst, size_t pixels) {
+    for (size_t i = 0; i < pixels; i++, src += 2, dst += 2) {
+        store565(dst, rgb444_hi[src[0]] | rgb444_lo[src[1]]);
+    }
+}
+
+static void rgb444_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels) {
+    for (size_t i = 0; i < pixels; i++, src += 2, dst += 3) {
+        dst[0] = (src[0] & 0x0F) * 17;
+        dst[1] = (src[1] >> 4) * 17;
+        dst[2] = (src[1] & 0x0F) * 17;
+    }
+}
+
+static void rgb555_to_rgb565(const uint8_t *src, uint8_t *dst, size_t pixels) {
+    size_t i = 0;
+    for (; i + 2 <= pixels; i += 2, src += 4, dst += 4) {
+        // Swap both big endian pixels into native lanes, widen green in both lanes at once and swap back
+        uint32_t w = load32(src);
+        w = ((w & 0x00FF00FF) << 8) | ((w >> 8) & 0x00FF00FF);
+        w = ((w & 0x7FE07FE0) << 1) | (w & 0x001F001F) | ((w >> 4) & 0x00200020);
+        store32(dst, ((w & 0x00FF00FF) << 8) | ((w >> 8) & 0x00FF00FF));
+    }
+    if (i < pixels) {
+        uint16_t p = (src[0] << 8) | src[1];
+        store565(dst, ((p & 0x7FE0) << 1) | (p & 0x001F) | ((p >> 4) & 0x0020));
+    }
+}
+
+static void rgb555_to_rgb888(const uint8_t *src, uint8_t *dst, size_t pixels) {
+    for (size_t i = 0; i < pixels; i++, src += 2, dst += 3) {
+        dst[0] = expand5[(src[0] >> 2) & 0x1F];
+        dst[1] = expand5[((src[0] & 0x03) << 3) | (src[1] >> 5)];
+        dst[2] = expand5[src[1] & 0x1F];
+    }
+}
+
+// Conversion table [src_format][dst_format]. Same format conversions are handled as a copy.
+static const conv_kernel_t conv_kernels[CONV_NUM_FORMATS][CONV_NUM_FORMATS] = {
+    [CAMERA_CONV_RGB565] = {
+        [CAMERA_CONV_RGB888] = rgb565_to_rgb888,
+        [CAMERA_CONV_GRAYSCALE] = rgb565_to_grayscale,
+    },
+    [CAMERA_CONV_RGB888] = {
+        [CAMERA_CONV_RGB565] = rgb888_to_rgb565,
+        [CAMERA_CONV_GRAYSCALE] = rgb888_to_grayscale,
+    },
+    [CAMERA_CONV_YUV422] = {
+        [CAMERA_CONV_RGB565] = yuv422_to_rgb565,
+        [CAMERA_CONV_RGB888] = yuv422_to_rgb888,
+        [CAMERA_CONV_GRAYSCALE] = yuv422_to_grayscale,
+    },
+    [CAMERA_CONV_GRAYSCALE] = {
+        [CAMERA_CONV_RGB565] = grayscale_to_rgb565,
+        [CAMERA_CONV_RGB888] = grayscale_to_rgb888,
+    },
+    [CAMERA_CONV_RGB444] = {
+        [CAMERA_CONV_RGB565] = rgb444_to_rgb565,
+        [CAMERA_CONV_RGB888] = rgb444_to_rgb888,
+    },
+    [CAMERA_CONV_RGB555] = {
+        [CAMERA_CONV_RGB565] = rgb555_to_rgb565,
+        [CAMERA_CONV_RGB888] = rgb555_to_rgb888,
+    },
+};
+
+size_t camera_conv_bytes_per_pixel(camera_conv_format_t format) {
+    switch (format) {
+        case CAMERA_CONV_GRAYSCALE:
+            return 1;
+        case CAMERA_CONV_RGB565:
+        case CAMERA_CONV_YUV422:
+        case CAMERA_CONV_RGB444:
+        case CAMERA_CONV_RGB555:
+            return 2;
+        case CAMERA_CONV_RGB888:
+            return 3;
+        default:
+            return 0;
+    }
+}
+
+bool camera_conv_supported(camera_conv_format_t src_format, camera_conv_format_t dst_format) {
+    if ((unsigned)src_format >= CONV_NUM_FORMATS || (unsigned)dst_format >= CONV_NUM_FORMATS) {
+        return false;
+    }
+    if (src_format == dst_format) {
+        return camera_conv_bytes_per_pixel(src_format) != 0;
+    }
+    return conv_kernels[src_format][dst_format] != NULL;
+}
+
+size_t camera_conv_convert(camera_conv_format_t src_format, const uint8_t *src,
+    camera_conv_format_t dst_format, uint8_t *dst, size_t pixels) {
+    if (!camera_conv_supported(src_format, dst_format)) {
+        return 0;
+    }
+    size_t dst_len = pixels * camera_conv_bytes_per_pixel(dst_format);
+    if (src_format == dst_format) {
+        memcpy(dst, src, dst_len);
+        return dst_len;
+    }
+    init_tables();
+    conv_kernels[src_format][dst_format](src, dst, pixels);
+    return dst_len;
+}
+
+// Cropping and binning. Sums of bin x bin pixels are divided by shifting, so bin must be a power of two.
+
+static inline size_t bin_shift(size_t bin) {
+    return bin == 4 ? 4 : bin == 2 ? 2 : 0;   // log2(bin * bin)
+}
+
+static void crop_grayscale(const uint8_t *src, size_t stride, size_t out_w, size_t out_h, size_t bin, uint8_t *dst) {
+    size_t shift = bin_shift(bin);
+    uint32_t round = (1u << shift) >> 1;
+    for (size_t oy = 0; oy < out_h; oy++, src += stride * bin) {
+        if (bin == 1) {
+            memcpy(dst, src, out_w);
+            dst += out_w;
+            continue;
+        }
+        const uint8_t *col = src;
+        for (size_t ox = 0; ox < out_w; ox++, col += bin) {
+            uint32_t sum = 0;
+            const uint8_t *row = col;
+            for (size_t by = 0; by < bin; by++, row += stride) {
+                for (size_t bx = 0; bx < bin; bx++) {
+                    sum += row[bx];
+                }
+            }
+            *dst++ = (sum + round) >> shift;
+        }
+    }
+}
+
+static void crop_rgb565(const uint8_t *src, size_t stride, size_t out_w, size_t out_h, size_t bin, uint8_t *dst) {
+    size_t shift = bin_shift(bin);
+    uint32_t round = (1u << shift) >> 1;
+    for (size_t oy = 0; oy < out_h; oy++, src += stride * bin) {
+        if (bin == 1) {
+            memcpy(dst, src, out_w * 2);
+            dst += out_w * 2;
+            continue;
+        }
+        const uint8_t *col = src;
+        for (size_t ox = 0; ox < out_w; ox++, col += bin * 2) {
+            uint32_t r = 0, g = 0, b = 0;
+            const uint8_t *row = col;
+            for (size_t by = 0; by < bin; by++, row += stride) {
+                for (size_t bx = 0; bx < bin * 2; bx += 2) {
+                    uint16_t p = (row[bx] << 8) | row[bx + 1];
+                    r += p >> 11;
+                    g += (p >> 5) & 0x3F;
+                    b += p & 0x1F;
+                }
+            }
+            store565(dst, (((r + round) >> shift) << 11) | (((g + round) >> shift) << 5) | ((b + round) >> shift));
+            dst += 2;
+        }
+    }
+}
+
+static void crop_rgb888(const uint8_t *src, size_t stride, size_t out_w, size_t out_h, size_t bin, uint8_t *dst) {
+    size_t shift = bin_shift(bin);
+    uint32_t round = (1u << shift) >> 1;
+    for (size_t oy = 0; oy < out_h; oy++, src += stride * bin) {
+        if (bin == 1) {
+            memcpy(dst, src, out_w * 3);
+            dst += out_w * 3;
+            continue;
+        }
+        const uint8_t *col = src;
+        for (size_t ox = 0; ox < out_w; ox++, col += bin * 3) {
+            uint32_t sum[3] = { 0, 0, 0 };
+            const uint8_t *row = col;
+            for (size_t by = 0; by < bin; by++, row += stride) {
+                for (size_t bx = 0; bx < bin * 3; bx += 3) {
+                    sum[0] += row[bx];
+                    sum[1] += row[bx + 1];
+                    sum[2] += row[bx + 2];
+                }
+            }
+            *dst++ = (sum[0] + round) >> shift;
+            *dst++ = (sum[1] + round) >> shift;
+            *dst++ = (sum[2] + round) >> shift;
+        }
+    }
+}
+
+// Works on pairs of output pixels: each gets its own luma, the chroma is averaged over both blocks
+static void crop_yuv422(const uint8_t *src, size_t stride, size_t out_w, size_t out_h, size_t bin, uint8_t *dst) {
+    size_t shift = bin_shift(bin);
+    uint32_t round = (1u << shift) >> 1;
+    for (size_t oy = 0; oy < out_h; oy++, src += stride * bin) {
+        if (bin == 1) {
+            memcpy(dst, src, out_w * 2);
+            dst += out_w * 2;
+            continue;
+        }
+        const uint8_t *col = src;
+        for (size_t ox = 0; ox < out_w; ox += 2, col += bin * 4) {
+            uint32_t y0 = 0, y1 = 0, u = 0, v = 0;
+            const uint8_t *row = col;
+            for (size_t by = 0; by < bin; by++, row += stride) {
+                // bin source pixels (bin / 2 macro pixels) per output pixel
+                for (size_t bx = 0; bx < bin * 2; bx += 4) {
+                    y0 += row[bx] + row[bx + 2];
+                    y1 += row[bin * 2 + bx] + row[bin * 2 + bx + 2];
+                    u += row[bx + 1] + row[bin * 2 + bx + 1];
+                    v += row[bx + 3] + row[bin * 2 + bx + 3];
+                }
+            }
+            // Each sum of chroma has bin * bin samples, the same as the luma of one output pixel
+            dst[0] = (y0 + round) >> shift;
+            dst[1] = (u + round) >> shift;
+            dst[2] = (y1 + round) >> shift;
+            dst[3] = (v + round) >> shift;
+            dst += 4;
+        }
+    }
+}
+
+bool camera_conv_crop_supported(camera_conv_format_t format, size_t bin) {
+    if (bin != 1 && bin != 2 && bin != 4) {
+        return false;
+    }
+    return format == CAMERA_CONV_GRAYSCALE || format == CAMERA_CONV_RGB565
+           || format == CAMERA_CONV_RGB888 || format == CAMERA_CONV_YUV422;
+}
+
+size_t camera_conv_crop(camera_conv_format_t format, const uint8_t *src, size_t src_width,
+    size_t x, size_t y, size_t w, size_t h, size_t bin, uint8_t *dst) {
+    if (!camera_conv_crop_supported(format, bin)) {
+        return 0;
+    }
+    size_t bpp = camera_conv_bytes_per_pixel(format);
+    size_t out_w = w / bin;
+    size_t out_h = h / bin;
+    if (format == CAMERA_CONV_YUV422 && ((x & 1) || (out_w & 1))) {
+        return 0;
+    }
+    size_t stride = src_width * bpp;
+    src += y * stride + x * bpp;
+    switch (format) {
+        case CAMERA_CONV_GRAYSCALE:
+            crop_grayscale(src, stride, out_w, out_h, bin, dst);
+            break;
+        case CAMERA_CONV_RGB565:
+            crop_rgb565(src, stride, out_w, out_h, bin, dst);
+            break;
+        case CAMERA_CONV_RGB888:
+            crop_rgb888(src, stride, out_w, out_h, bin, dst);
+            break;
+        default:
+            crop_yuv422(src, stride, out_w, out_h, bin, dst);
+            break;
+    }
+    return out_w * out_h * bpp;
+}
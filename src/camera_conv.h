@@ -0,0 +1,115 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Christopher Nadler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MICROPY_INCLUDED_CAMERA_CONV_H
+#define MICROPY_INCLUDED_CAMERA_CONV_H
+
+// Pixel format conversion kernels.
+// This file does not depend on MicroPython or on a camera driver, so it can be built and tested on any host.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Pixel formats known to the conversion engine.
+ * @details The values match the HAL pixel format values, so they can be casted directly.
+ * Byte layouts are the ones delivered by the sensors:
+ * - RGB565:    RRRRRGGG GGGBBBBB (big endian)
+ * - RGB555:    xRRRRRGG GGGBBBBB (big endian)
+ * - RGB444:    xxxxRRRR GGGGBBBB (big endian)
+ * - RGB888:    R, G, B
+ * - YUV422:    Y0, U, Y1, V
+ * - GRAYSCALE: Y
+ */
+typedef enum {
+    CAMERA_CONV_RGB565    = 0,
+    CAMERA_CONV_YUV422    = 1,
+    CAMERA_CONV_YUV420    = 2,
+    CAMERA_CONV_GRAYSCALE = 3,
+    CAMERA_CONV_JPEG      = 4,
+    CAMERA_CONV_RGB888    = 5,
+    CAMERA_CONV_RAW       = 6,
+    CAMERA_CONV_RGB444    = 7,
+    CAMERA_CONV_RGB555    = 8,
+} camera_conv_format_t;
+
+/**
+ * @brief Returns the number of bytes per pixel of a format.
+ *
+ * @param format Pixel format.
+ * @return Bytes per pixel or 0 if the format has no fixed pixel size (e.g. JPEG).
+ */
+extern size_t camera_conv_bytes_per_pixel(camera_conv_format_t format);
+
+/**
+ * @brief Returns true, if the engine can convert src_format into dst_format.
+ *
+ * @param src_format Source pixel format.
+ * @param dst_format Destination pixel format.
+ */
+extern bool camera_conv_supported(camera_conv_format_t src_format, camera_conv_format_t dst_format);
+
+/**
+ * @brief Converts a raw frame from one pixel format into another.
+ * @details src and dst must not overlap. For YUV422 sources the pixel count must be even.
+ *
+ * @param src_format Source pixel format.
+ * @param src Source pixels.
+ * @param dst_format Destination pixel format.
+ * @param dst Destination buffer with room for pixels * camera_conv_bytes_per_pixel(dst_format) bytes.
+ * @param pixels Number of pixels to convert.
+ * @return Number of bytes written to dst or 0 if the conversion is not supported.
+ */
+extern size_t camera_conv_convert(camera_conv_format_t src_format, const uint8_t *src,
+    camera_conv_format_t dst_format, uint8_t *dst, size_t pixels);
+
+/**
+ * @brief Returns true, if camera_conv_crop supports the format and binning factor.
+ *
+ * @param format Pixel format (RGB565, RGB888, GRAYSCALE or YUV422).
+ * @param bin Binning factor (1, 2 or 4).
+ */
+extern bool camera_conv_crop_supported(camera_conv_format_t format, size_t bin);
+
+/**
+ * @brief Crops a region out of a raw frame and bins it (averages bin x bin pixels) in one pass.
+ * @details The output has (w / bin) x (h / bin) pixels in the source format. Remainders of w and h are skipped.
+ * For YUV422, x and the output width must be even. The region must lie within the frame.
+ *
+ * @param format Pixel format of src and dst.
+ * @param src Source frame.
+ * @param src_width Width of the source frame in pixels.
+ * @param x Left edge of the region.
+ * @param y Top edge of the region.
+ * @param w Width of the region.
+ * @param h Height of the region.
+ * @param bin Binning factor (1, 2 or 4).
+ * @param dst Destination buffer with room for (w / bin) * (h / bin) pixels.
+ * @return Number of bytes written to dst or 0 if not supported.
+ */
+extern size_t camera_conv_crop(camera_conv_format_t format, const uint8_t *src, size_t src_width,
+    size_t x, size_t y, size_t w, size_t h, size_t bin, uint8_t *dst);
+
+#endif // MICROPY_INCLUDED_CAMERA_CONV_H
@@ -0,0 +1,120 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Christopher Nadler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "camera_exposure.h"
+
+// White balance presets of the sensors, ordered from warm (incandescent) to cold light (overcast)
+static const uint8_t wb_ladder[] = { 4, 3, 1, 2 };
+#define WB_LADDER_LEN (sizeof(wb_ladder) / sizeof(wb_ladder[0]))
+#define WB_LADDER_DEFAULT (2)           // Sunny
+#define MAX_STEP_RATIO (4.0f)           // Limits the change of the exposure per update
+
+static void split_exposure(const camera_exposure_t *ctrl, camera_exposure_output_t *out) {
+    float exposure = ctrl->exposure;
+    if (exposure <= ctrl->max_exposure) {
+        out->aec_value = exposure < 1 ? 1 : (uint16_t)(exposure + 0.5f);
+        out->agc_gain = 0;
+    } else {
+        int gain = (int)(exposure / ctrl->max_exposure + 0.5f) - 1;
+        out->aec_value = ctrl->max_exposure;
+        out->agc_gain = gain > ctrl->max_gain ? ctrl->max_gain : gain;
+    }
+}
+
+void camera_exposure_init(camera_exposure_t *ctrl, int aec_value, int agc_gain, int wb_mode) {
+    ctrl->luma = -1;
+    ctrl->exposure = (float)(aec_value < 1 ? 1 : aec_value) * (agc_gain + 1);
+    ctrl->wb_index = WB_LADDER_DEFAULT;
+    for (size_t i = 0; i < WB_LADDER_LEN; i++) {
+        if (wb_ladder[i] == wb_mode) {
+            ctrl->wb_index = i;
+        }
+    }
+    ctrl->converged = false;
+    ctrl->updates = 0;
+    ctrl->settle_start_ms = 0;
+    ctrl->settle_start_update = 0;
+    ctrl->convergence_ms = 0;
+    ctrl->convergence_updates = 0;
+}
+
+bool camera_exposure_update(camera_exposure_t *ctrl, const camera_stats_t *stats, uint32_t now_ms,
+    camera_exposure_output_t *out) {
+    if (ctrl->updates == 0) {
+        ctrl->settle_start_ms = now_ms;
+    }
+    ctrl->updates++;
+
+    // Exposure
+    ctrl->luma = ctrl->luma < 0 ? stats->luma : ctrl->damping * ctrl->luma + (1 - ctrl->damping) * stats->luma;
+    float luma = ctrl->luma < 1 ? 1 : ctrl->luma;
+    // Hysteresis: once converged, the luma may drift up to twice the tolerance before the exposure is touched.
+    // This keeps the coarse analog gain steps from oscillating around the target.
+    float error = ctrl->target - luma;
+    float tolerance = ctrl->converged ? 2 * ctrl->tolerance : ctrl->tolerance;
+    bool exposure_ok = error <= tolerance && error >= -tolerance;
+    float max_total = (float)ctrl->max_exposure * (ctrl->max_gain + 1);
+    split_exposure(ctrl, out);
+    uint16_t old_aec = out->aec_value;
+    uint8_t old_agc = out->agc_gain;
+    if (!exposure_ok) {
+        float ratio = ctrl->target / luma;
+        ratio = ratio > MAX_STEP_RATIO ? MAX_STEP_RATIO : (ratio < 1 / MAX_STEP_RATIO ? 1 / MAX_STEP_RATIO : ratio);
+        float exposure = ctrl->exposure * (1 + ctrl->gain * (ratio - 1));
+        ctrl->exposure = exposure < 1 ? 1 : (exposure > max_total ? max_total : exposure);
+        split_exposure(ctrl, out);
+        // At the limits of the sensor the exposure cannot get any better
+        exposure_ok = (ratio > 1 && ctrl->exposure >= max_total) || (ratio < 1 && ctrl->exposure <= 1);
+    }
+    out->exposure_changed = out->aec_value != old_aec || out->agc_gain != old_agc;
+
+    // Gray world white balance: red (V) above blue (U) means warm light
+    bool wb_ok = true;
+    out->wb_changed = false;
+    if (ctrl->awb && stats->channels == 3) {
+        int imbalance = stats->format == CAMERA_CONV_YUV422
+            ? (int)stats->mean[2] - stats->mean[1]
+            : (int)stats->mean[0] - stats->mean[2];
+        if (imbalance > ctrl->wb_tolerance && ctrl->wb_index > 0) {
+            ctrl->wb_index--;
+            out->wb_changed = true;
+        } else if (imbalance < -ctrl->wb_tolerance && ctrl->wb_index < (int)WB_LADDER_LEN - 1) {
+            ctrl->wb_index++;
+            out->wb_changed = true;
+        }
+        wb_ok = !out->wb_changed;
+    }
+    out->wb_mode = wb_ladder[ctrl->wb_index];
+
+    bool converged = exposure_ok && wb_ok;
+    if (converged && !ctrl->converged) {
+        ctrl->convergence_ms = now_ms - ctrl->settle_start_ms;
+        ctrl->convergence_updates = ctrl->updates - ctrl->settle_start_update;
+    } else if (!converged && ctrl->converged) {
+        ctrl->settle_start_ms = now_ms;
+        ctrl->settle_start_update = ctrl->updates - 1;
+    }
+    ctrl->converged = converged;
+    return converged;
+}
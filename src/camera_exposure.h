@@ -0,0 +1,95 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Christopher Nadler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MICROPY_INCLUDED_CAMERA_EXPOSURE_H
+#define MICROPY_INCLUDED_CAMERA_EXPOSURE_H
+
+// Software auto exposure / auto white balance controller working on frame statistics.
+// Like camera_conv.c, this file does not depend on MicroPython or on a camera driver:
+// the caller applies the returned sensor settings.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "camera_stats.h"
+
+/**
+ * @brief Controller configuration and state.
+ * @details The exposure is modelled as aec_value * (agc_gain + 1). Each update moves it by gain times the
+ * ratio between target and measured luma, exposure time first and analog gain only above max_exposure.
+ * White balance steps through the sensor presets ordered by the color temperature they correct for
+ * until the gray world means of red and blue (or U and V) are balanced.
+ */
+typedef struct _camera_exposure_t {
+    // Configuration
+    uint8_t     target;             // Target mean luma
+    uint8_t     tolerance;          // Luma error which counts as converged
+    uint8_t     wb_tolerance;       // Red/blue imbalance which counts as balanced
+    bool        awb;                // Drive the white balance presets
+    float       gain;               // Fraction of the exposure error corrected per update (0..1]
+    float       damping;            // Weight of the previous luma in the filtered luma [0..1)
+    uint16_t    max_exposure;       // Upper limit of aec_value
+    uint8_t     max_gain;           // Upper limit of agc_gain
+    // State
+    float       luma;               // Filtered luma, < 0 before the first update
+    float       exposure;           // aec_value * (agc_gain + 1)
+    int8_t      wb_index;           // Index into the preset ladder
+    bool        converged;
+    uint32_t    updates;
+    uint32_t    settle_start_ms;    // Time the controller left the converged state
+    uint32_t    settle_start_update;
+    uint32_t    convergence_ms;     // Duration of the last convergence
+    uint32_t    convergence_updates;
+} camera_exposure_t;
+
+/**
+ * @brief Sensor settings of an update.
+ */
+typedef struct _camera_exposure_output_t {
+    uint16_t    aec_value;
+    uint8_t     agc_gain;
+    uint8_t     wb_mode;            // 1 sunny, 2 cloudy, 3 office, 4 home
+    bool        exposure_changed;
+    bool        wb_changed;
+} camera_exposure_output_t;
+
+/**
+ * @brief Initializes the state from the current sensor settings. The configuration must be set before.
+ */
+extern void camera_exposure_init(camera_exposure_t *ctrl, int aec_value, int agc_gain, int wb_mode);
+
+/**
+ * @brief Feeds the statistics of a frame to the controller.
+ *
+ * @param ctrl Controller.
+ * @param stats Statistics of the frame (see camera_stats_compute).
+ * @param now_ms Time of the frame in milliseconds, used to measure the convergence time.
+ * @param out Receives the sensor settings to apply.
+ * @return true, if luma and white balance are within tolerance.
+ */
+extern bool camera_exposure_update(camera_exposure_t *ctrl, const camera_stats_t *stats, uint32_t now_ms,
+    camera_exposure_output_t *out);
+
+#endif // MICROPY_INCLUDED_CAMERA_EXPOSURE_H
@@ -0,0 +1,499 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Christopher Nadler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "camera_jpeg.h"
+
+// Huffman tables of ITU T.81 Annex K.3 to K.6: number of codes of each length 1..16, followed by the symbols
+static const uint8_t dc_luma_bits[16] = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+static const uint8_t dc_chroma_bits[16] = { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+static const uint8_t dc_values[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+static const uint8_t ac_luma_bits[16] = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7D };
+static const uint8_t ac_luma_values[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xA1, 0x08, 0x23, 0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0A, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7,
+    0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5,
+    0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2,
+    0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+    0xF9, 0xFA,
+};
+static const uint8_t ac_chroma_bits[16] = { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 };
+static const uint8_t ac_chroma_values[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xA1, 0xB1, 0xC1, 0x09, 0x23, 0x33, 0x52, 0xF0,
+    0x15, 0x62, 0x72, 0xD1, 0x0A, 0x16, 0x24, 0x34, 0xE1, 0x25, 0xF1, 0x17, 0x18, 0x19, 0x1A, 0x26,
+    0x27, 0x28, 0x29, 0x2A, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5,
+    0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3,
+    0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA,
+    0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+    0xF9, 0xFA,
+};
+
+// Quantization tables of Annex K.1 and K.2 in natural order
+static const uint8_t luma_quant[64] = {
+    16, 11, 10, 16, 24, 40, 51, 61,
+    12, 12, 14, 19, 26, 58, 60, 55,
+    14, 13, 16, 24, 40, 57, 69, 56,
+    14, 17, 22, 29, 51, 87, 80, 62,
+    18, 22, 37, 56, 68, 109, 103, 77,
+    24, 35, 55, 64, 81, 104, 113, 92,
+    49, 64, 78, 87, 103, 121, 120, 101,
+    72, 92, 95, 98, 112, 100, 103, 99,
+};
+static const uint8_t chroma_quant[64] = {
+    17, 18, 24, 47, 99, 99, 99, 99,
+    18, 21, 26, 66, 99, 99, 99, 99,
+    24, 26, 56, 99, 99, 99, 99, 99,
+    47, 66, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+};
+
+// Natural index of the zigzag positions
+static const uint8_t zigzag[64] = {
+    0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+typedef struct {
+    uint16_t    code[256];
+    uint8_t     size[256];
+} huffman_t;
+
+typedef struct {
+    uint16_t    code[12];
+    uint8_t     size[12];
+} huffman_dc_t;
+
+typedef struct {
+    uint16_t    quant[2][64];       // Quantizers of luma and chroma in natural order, scaled by 8 like the DCT output
+    huffman_dc_t dc[2];
+    huffman_t   ac[2];
+    int         pred[3];            // DC predictions of the components
+    // Output
+    camera_jpeg_write_t write;
+    void        *ctx;
+    uint8_t     *chunk;
+    size_t      chunk_len;
+    size_t      pos;
+    size_t      total;
+    uint32_t    acc;
+    uint8_t     n_bits;
+    bool        failed;
+} encoder_t;
+
+static void flush_chunk(encoder_t *enc) {
+    if (!enc->failed && enc->write && !enc->write(enc->ctx, enc->chunk, enc->pos)) {
+        enc->failed = true;
+    }
+    enc->total += enc->pos;
+    enc->pos = 0;
+}
+
+static inline void put_byte(encoder_t *enc, uint8_t byte) {
+    if (enc->pos == enc->chunk_len) {
+        if (!enc->write) {
+            enc->failed = true;     // The output does not fit into chunk
+            return;
+        }
+        flush_chunk(enc);
+    }
+    enc->chunk[enc->pos++] = byte;
+}
+
+static void put_bytes(encoder_t *enc, const uint8_t *data, size_t len) {
+    while (len--) {
+        put_byte(enc, *data++);
+    }
+}
+
+static void put_marker(encoder_t *enc, uint8_t marker, size_t len) {
+    put_byte(enc, 0xFF);
+    put_byte(enc, marker);
+    put_byte(enc, len >> 8);
+    put_byte(enc, len & 0xFF);
+}
+
+// Appends up to 16 bits to the entropy coded data, 0xFF bytes are stuffed with 0x00
+static inline void put_bits(encoder_t *enc, uint32_t bits, uint8_t n) {
+    enc->acc = (enc->acc << n) | (bits & ((1u << n) - 1));
+    enc->n_bits += n;
+    while (enc->n_bits >= 8) {
+        uint8_t byte = enc->acc >> (enc->n_bits - 8);
+        put_byte(enc, byte);
+        if (byte == 0xFF) {
+            put_byte(enc, 0x00);
+        }
+        enc->n_bits -= 8;
+    }
+}
+
+// Assigns the codes of Annex C to the symbols
+static void build_huffman(uint16_t *codes, uint8_t *sizes, const uint8_t *bits, const uint8_t *values) {
+    uint16_t code = 0;
+    size_t k = 0;
+    for (int len = 1; len <= 16; len++) {
+        for (int i = 0; i < bits[len - 1]; i++) {
+            codes[values[k]] = code++;
+            sizes[values[k]] = len;
+            k++;
+        }
+        code <<= 1;
+    }
+}
+
+int camera_jpeg_table_quality(int quality) {
+    quality = quality < 0 ? 0 : (quality > 100 ? 100 : quality);
+    int level = 63 - quality * 63 / 100;    // get_mapped_jpeg_quality
+    return 100 - level * 99 / 63;
+}
+
+// IJG scaling of the standard tables
+static void scale_quant(uint16_t *dst, const uint8_t *base, int table_quality) {
+    int scale = table_quality < 50 ? 5000 / table_quality : 200 - 2 * table_quality;
+    for (int i = 0; i < 64; i++) {
+        int q = (base[i] * scale + 50) / 100;
+        dst[i] = 8 * (q < 1 ? 1 : (q > 255 ? 255 : q));
+    }
+}
+
+// Integer DCT of ITU T.81 Annex A.3.3 as factored by Loeffler, Ligtenberg and Moschytz (like jfdctint.c of the IJG).
+// The output is scaled by 8.
+#define CONST_BITS  (13)
+#define PASS1_BITS  (2)
+#define FIX_0_298631336 (2446)
+#define FIX_0_390180644 (3196)
+#define FIX_0_541196100 (4433)
+#define FIX_0_765366865 (6270)
+#define FIX_0_899976223 (7373)
+#define FIX_1_175875602 (9633)
+#define FIX_1_501321110 (12299)
+#define FIX_1_847759065 (15137)
+#define FIX_1_961570560 (16069)
+#define FIX_2_053119869 (16819)
+#define FIX_2_562915447 (20995)
+#define FIX_3_072711026 (25172)
+#define DESCALE(x, n) (((x) + (1 << ((n) - 1))) >> (n))
+
+// The first pass (rows) keeps PASS1_BITS more precision, the second pass (columns) removes it
+static void fdct_1d(int32_t *d, int stride, bool first_pass) {
+    int shift = first_pass ? CONST_BITS - PASS1_BITS : CONST_BITS + PASS1_BITS;
+    int32_t tmp0 = d[0] + d[7 * stride];
+    int32_t tmp7 = d[0] - d[7 * stride];
+    int32_t tmp1 = d[stride] + d[6 * stride];
+    int32_t tmp6 = d[stride] - d[6 * stride];
+    int32_t tmp2 = d[2 * stride] + d[5 * stride];
+    int32_t tmp5 = d[2 * stride] - d[5 * stride];
+    int32_t tmp3 = d[3 * stride] + d[4 * stride];
+    int32_t tmp4 = d[3 * stride] - d[4 * stride];
+
+    int32_t tmp10 = tmp0 + tmp3;
+    int32_t tmp13 = tmp0 - tmp3;
+    int32_t tmp11 = tmp1 + tmp2;
+    int32_t tmp12 = tmp1 - tmp2;
+    if (first_pass) {
+        d[0] = (tmp10 + tmp11) * (1 << PASS1_BITS);
+        d[4 * stride] = (tmp10 - tmp11) * (1 << PASS1_BITS);
+    } else {
+        d[0] = DESCALE(tmp10 + tmp11, PASS1_BITS);
+        d[4 * stride] = DESCALE(tmp10 - tmp11, PASS1_BITS);
+    }
+    int32_t z1 = (tmp12 + tmp13) * FIX_0_541196100;
+    d[2 * stride] = DESCALE(z1 + tmp13 * FIX_0_765366865, shift);
+    d[6 * stride] = DESCALE(z1 - tmp12 * FIX_1_847759065, shift);
+
+    z1 = tmp4 + tmp7;
+    int32_t z2 = tmp5 + tmp6;
+    int32_t z3 = tmp4 + tmp6;
+    int32_t z4 = tmp5 + tmp7;
+    int32_t z5 = (z3 + z4) * FIX_1_175875602;
+    tmp4 *= FIX_0_298631336;
+    tmp5 *= FIX_2_053119869;
+    tmp6 *= FIX_3_072711026;
+    tmp7 *= FIX_1_501321110;
+    z1 *= -FIX_0_899976223;
+    z2 *= -FIX_2_562915447;
+    z3 = z3 * -FIX_1_961570560 + z5;
+    z4 = z4 * -FIX_0_390180644 + z5;
+    d[7 * stride] = DESCALE(tmp4 + z1 + z3, shift);
+    d[5 * stride] = DESCALE(tmp5 + z2 + z4, shift);
+    d[3 * stride] = DESCALE(tmp6 + z2 + z3, shift);
+    d[stride] = DESCALE(tmp7 + z1 + z4, shift);
+}
+
+static void fdct(int32_t *block) {
+    for (int row = 0; row < 8; row++) {
+        fdct_1d(block + 8 * row, 1, true);
+    }
+    for (int col = 0; col < 8; col++) {
+        fdct_1d(block + col, 8, false);
+    }
+}
+
+static inline uint8_t category(int value) {
+    unsigned int magnitude = value < 0 ? -value : value;
+    uint8_t n = 0;
+    while (magnitude) {
+        n++;
+        magnitude >>= 1;
+    }
+    return n;
+}
+
+// Transforms, quantizes and entropy codes a block of level shifted samples
+static void encode_block(encoder_t *enc, int32_t *block, int component) {
+    int table = component > 0;
+    const uint16_t *quant = enc->quant[table];
+    const huffman_t *ac = &enc->ac[table];
+    fdct(block);
+
+    int dc = block[0];
+    dc = dc >= 0 ? (dc + quant[0] / 2) / quant[0] : -((-dc + quant[0] / 2) / quant[0]);
+    int diff = dc - enc->pred[component];
+    enc->pred[component] = dc;
+    uint8_t n = category(diff);
+    put_bits(enc, enc->dc[table].code[n], enc->dc[table].size[n]);
+    if (n) {
+        put_bits(enc, diff < 0 ? diff - 1 : diff, n);
+    }
+
+    int run = 0;
+    for (int k = 1; k < 64; k++) {
+        int i = zigzag[k];
+        int q = quant[i];
+        int v = block[i];
+        v = v >= 0 ? (v + q / 2) / q : -((-v + q / 2) / q);
+        if (v == 0) {
+            run++;
+            continue;
+        }
+        while (run > 15) {
+            put_bits(enc, ac->code[0xF0], ac->size[0xF0]);     // 16 zeros
+            run -= 16;
+        }
+        n = category(v);
+        uint8_t symbol = (run << 4) | n;
+        put_bits(enc, ac->code[symbol], ac->size[symbol]);
+        put_bits(enc, v < 0 ? v - 1 : v, n);
+        run = 0;
+    }
+    if (run) {
+        put_bits(enc, ac->code[0x00], ac->size[0x00]);     // End of block
+    }
+}
+
+static void put_headers(encoder_t *enc, size_t width, size_t height, int components, uint8_t luma_sampling) {
+    static const uint8_t app0[] = { 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0 };
+    int tables = components > 1 ? 2 : 1;
+    put_byte(enc, 0xFF);
+    put_byte(enc, 0xD8);    // SOI
+    put_marker(enc, 0xE0, 2 + sizeof(app0));
+    put_bytes(enc, app0, sizeof(app0));
+    put_marker(enc, 0xDB, 2 + tables * 65);
+    for (int table = 0; table < tables; table++) {
+        put_byte(enc, table);
+        for (int k = 0; k < 64; k++) {
+            put_byte(enc, enc->quant[table][zigzag[k]] / 8);
+        }
+    }
+    put_marker(enc, 0xC0, 8 + 3 * components);    // SOF0
+    put_byte(enc, 8);
+    put_byte(enc, height >> 8);
+    put_byte(enc, height & 0xFF);
+    put_byte(enc, width >> 8);
+    put_byte(enc, width & 0xFF);
+    put_byte(enc, components);
+    for (int c = 0; c < components; c++) {
+        put_byte(enc, c + 1);
+        put_byte(enc, c ? 0x11 : luma_sampling);
+        put_byte(enc, c > 0);
+    }
+    put_marker(enc, 0xC4, 2 + tables * (2 * 17 + 12 + 162));  // DHT
+    for (int table = 0; table < tables; table++) {
+        put_byte(enc, table);
+        put_bytes(enc, table ? dc_chroma_bits : dc_luma_bits, 16);
+        put_bytes(enc, dc_values, 12);
+        put_byte(enc, 0x10 | table);
+        put_bytes(enc, table ? ac_chroma_bits : ac_luma_bits, 16);
+        put_bytes(enc, table ? ac_chroma_values : ac_luma_values, 162);
+    }
+    put_marker(enc, 0xDA, 6 + 2 * components);   // SOS
+    put_byte(enc, components);
+    for (int c = 0; c < components; c++) {
+        put_byte(enc, c + 1);
+        put_byte(enc, c ? 0x11 : 0x00);
+    }
+    put_byte(enc, 0);
+    put_byte(enc, 63);
+    put_byte(enc, 0);
+}
+
+// Loads the n pixels of a row starting at x (repeating the last pixel at the right edge) as Y, Cb and Cr
+static void load_row(camera_conv_format_t format, const uint8_t *row, size_t x, size_t n, size_t width,
+    int16_t *y, int16_t *cb, int16_t *cr) {
+    for (size_t i = 0; i < n; i++) {
+        size_t sx = x + i < width ? x + i : width - 1;
+        switch (format) {
+            case CAMERA_CONV_GRAYSCALE:
+                y[i] = row[sx];
+                break;
+            case CAMERA_CONV_YUV422: {
+                const uint8_t *pair = row + 2 * (sx & ~(size_t)1);
+                y[i] = pair[2 * (sx & 1)];
+                cb[i] = pair[1];
+                cr[i] = pair[3];
+                break;
+            }
+            default: {
+                // RGB565, big endian
+                uint8_t hi = row[2 * sx];
+                uint8_t lo = row[2 * sx + 1];
+                int r = (hi & 0xF8) | (hi >> 5);
+                int g = ((hi & 0x07) << 5) | ((lo & 0xE0) >> 3) | ((hi & 0x06) >> 1);
+                int b = ((lo & 0x1F) << 3) | ((lo & 0x1C) >> 2);
+                y[i] = (77 * r + 150 * g + 29 * b + 128) >> 8;
+                cb[i] = (-43 * r - 85 * g + 128 * b + 32895) >> 8;
+                cr[i] = (128 * r - 107 * g - 21 * b + 32895) >> 8;
+                break;
+            }
+        }
+    }
+}
+
+// Encodes the MCU at (x, y): 1, 2 or 4 luma blocks and, for color frames, a Cb and a Cr block
+static void encode_mcu(encoder_t *enc, camera_conv_format_t format, const uint8_t *src, size_t width, size_t height,
+    size_t x, size_t y, int mcu_w, int mcu_h, int components) {
+    size_t stride = width * (format == CAMERA_CONV_GRAYSCALE ? 1 : 2);
+    int16_t luma[16][16];
+    int32_t chroma[2][64] = { { 0 } };
+    int16_t cb[16], cr[16];
+    int shift_x = mcu_w == 16;
+    int shift_y = mcu_h == 16;
+    for (int ly = 0; ly < mcu_h; ly++) {
+        size_t sy = y + ly < height ? y + ly : height - 1;
+        load_row(format, src + sy * stride, x, mcu_w, width, luma[ly], cb, cr);
+        if (components > 1) {
+            // Chroma is averaged over the subsampled pixels
+            int32_t *cb_row = chroma[0] + 8 * (ly >> shift_y);
+            int32_t *cr_row = chroma[1] + 8 * (ly >> shift_y);
+            for (int lx = 0; lx < mcu_w; lx++) {
+                cb_row[lx >> shift_x] += cb[lx];
+                cr_row[lx >> shift_x] += cr[lx];
+            }
+        }
+    }
+
+    int32_t block[64];
+    for (int by = 0; by < mcu_h; by += 8) {
+        for (int bx = 0; bx < mcu_w; bx += 8) {
+            for (int i = 0; i < 64; i++) {
+                block[i] = luma[by + i / 8][bx + i % 8] - 128;
+            }
+            encode_block(enc, block, 0);
+        }
+    }
+    if (components > 1) {
+        int shift = shift_x + shift_y;
+        int32_t offset = 128 << shift;
+        for (int c = 0; c < 2; c++) {
+            for (int i = 0; i < 64; i++) {
+                chroma[c][i] = (chroma[c][i] - offset + ((1 << shift) >> 1)) >> shift;
+            }
+            encode_block(enc, chroma[c], c + 1);
+        }
+    }
+}
+
+bool camera_jpeg_supported(camera_conv_format_t format) {
+    return format == CAMERA_CONV_RGB565 || format == CAMERA_CONV_YUV422 || format == CAMERA_CONV_GRAYSCALE;
+}
+
+size_t camera_jpeg_encode(camera_conv_format_t format, const uint8_t *src, size_t width, size_t height,
+    int quality, camera_jpeg_subsampling_t subsampling, uint8_t *chunk, size_t chunk_len,
+    camera_jpeg_write_t write, void *ctx) {
+    if (!camera_jpeg_supported(format) || width == 0 || height == 0 || width > 0xFFFF || height > 0xFFFF
+        || (format == CAMERA_CONV_YUV422 && (width & 1)) || chunk_len < 64) {
+        return 0;
+    }
+    int components = format == CAMERA_CONV_GRAYSCALE ? 1 : 3;
+    int mcu_w = 8, mcu_h = 8;
+    uint8_t luma_sampling = 0x11;
+    if (components > 1 && subsampling == CAMERA_JPEG_SUBSAMPLING_422) {
+        mcu_w = 16;
+        luma_sampling = 0x21;
+    } else if (components > 1 && subsampling == CAMERA_JPEG_SUBSAMPLING_420) {
+        mcu_w = 16;
+        mcu_h = 16;
+        luma_sampling = 0x22;
+    } else if (components > 1 && subsampling != CAMERA_JPEG_SUBSAMPLING_444) {
+        return 0;
+    }
+
+    encoder_t enc;
+    int table_quality = camera_jpeg_table_quality(quality);
+    scale_quant(enc.quant[0], luma_quant, table_quality);
+    scale_quant(enc.quant[1], chroma_quant, table_quality);
+    build_huffman(enc.dc[0].code, enc.dc[0].size, dc_luma_bits, dc_values);
+    build_huffman(enc.dc[1].code, enc.dc[1].size, dc_chroma_bits, dc_values);
+    build_huffman(enc.ac[0].code, enc.ac[0].size, ac_luma_bits, ac_luma_values);
+    build_huffman(enc.ac[1].code, enc.ac[1].size, ac_chroma_bits, ac_chroma_values);
+    memset(enc.pred, 0, sizeof(enc.pred));
+    enc.write = write;
+    enc.ctx = ctx;
+    enc.chunk = chunk;
+    enc.chunk_len = chunk_len;
+    enc.pos = 0;
+    enc.total = 0;
+    enc.acc = 0;
+    enc.n_bits = 0;
+    enc.failed = false;
+
+    put_headers(&enc, width, height, components, luma_sampling);
+    for (size_t y = 0; y < height && !enc.failed; y += mcu_h) {
+        for (size_t x = 0; x < width; x += mcu_w) {
+            encode_mcu(&enc, format, src, width, height, x, y, mcu_w, mcu_h, components);
+        }
+    }
+    if (enc.n_bits) {
+        put_bits(&enc, 0x7F, 8 - enc.n_bits);     // Pad with ones
+    }
+    put_byte(&enc, 0xFF);
+    put_byte(&enc, 0xD9);   // EOI
+    flush_chunk(&enc);
+    return enc.failed ? 0 : enc.total;
+}
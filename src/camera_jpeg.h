@@ -0,0 +1,82 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Christopher Nadler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MICROPY_INCLUDED_CAMERA_JPEG_H
+#define MICROPY_INCLUDED_CAMERA_JPEG_H
+
+// Baseline JPEG encoder for sensors without hardware JPEG, with an integer DCT and the standard Huffman tables.
+// Like camera_conv.c, this file does not depend on MicroPython or on a camera driver.
+//
+// The output is produced in chunks, so a frame can be sent while it is encoded, without a buffer for the whole
+// JPEG. The encoder allocates nothing and needs about 3 KB of stack.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "camera_conv.h"
+
+// Size of the markers and tables in front of the entropy coded data (color frames, grayscale frames need less)
+#define CAMERA_JPEG_HEADER_SIZE (607)
+
+typedef enum {
+    CAMERA_JPEG_SUBSAMPLING_444 = 444,
+    CAMERA_JPEG_SUBSAMPLING_422 = 422,
+    CAMERA_JPEG_SUBSAMPLING_420 = 420,
+} camera_jpeg_subsampling_t;
+
+/**
+ * @brief Receives a chunk of the output.
+ * @return false to abort the encoding.
+ */
+typedef bool (*camera_jpeg_write_t)(void *ctx, const uint8_t *data, size_t len);
+
+/**
+ * @brief Returns true, if frames of the pixel format can be encoded (RGB565, YUV422 or GRAYSCALE).
+ */
+extern bool camera_jpeg_supported(camera_conv_format_t format);
+
+/**
+ * @brief Maps the API quality (0..100) onto the quality of the standard quantization tables (1..100).
+ * @details Like get_mapped_jpeg_quality for the sensors, the quality is first mapped onto the 64 levels
+ * (0 = best, 63 = worst) of the hardware encoders, so both encoders have the same steps.
+ */
+extern int camera_jpeg_table_quality(int quality);
+
+/**
+ * @brief Encodes a frame.
+ * @details GRAYSCALE frames are encoded with a single component, subsampling only applies to color frames.
+ * YUV422 frames need an even width.
+ *
+ * @param format Pixel format of src.
+ * @param quality API quality (0..100), see camera_jpeg_table_quality.
+ * @param chunk Output buffer of chunk_len bytes (at least 64), passed to write whenever it is full.
+ * @param write Receives the chunks. If NULL, chunk must hold the complete output.
+ * @return Length of the JPEG, 0 if the format is not supported, write failed or the output did not fit into chunk.
+ */
+extern size_t camera_jpeg_encode(camera_conv_format_t format, const uint8_t *src, size_t width, size_t height,
+    int quality, camera_jpeg_subsampling_t subsampling, uint8_t *chunk, size_t chunk_len,
+    camera_jpeg_write_t write, void *ctx);
+
+#endif // MICROPY_INCLUDED_CAMERA_JPEG_H
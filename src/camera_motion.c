@@ -0,0 +1,201 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Christopher Nadler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "camera_motion.h"
+
+static int scale_shift(size_t scale) {
+    switch (scale) {
+        case 1: return 0;
+        case 2: return 1;
+        case 4: return 2;
+        case 8: return 3;
+        default: return -1;
+    }
+}
+
+bool camera_motion_supported(camera_conv_format_t format) {
+    return format == CAMERA_CONV_GRAYSCALE || format == CAMERA_CONV_YUV422;
+}
+
+size_t camera_motion_reference_size(size_t width, size_t height, size_t scale) {
+    int shift = scale_shift(scale);
+    if (shift < 0) {
+        return 0;
+    }
+    return (width >> shift) * (height >> shift);
+}
+
+bool camera_motion_init(camera_motion_t *motion, size_t width, size_t height, size_t scale,
+    size_t cols, size_t rows, uint8_t *reference) {
+    int shift = scale_shift(scale);
+    if (shift < 0 || width > UINT16_MAX || height > UINT16_MAX) {
+        return false;
+    }
+    size_t ref_width = width >> shift;
+    size_t ref_height = height >> shift;
+    if (cols == 0 || rows == 0 || cols > CAMERA_MOTION_MAX_GRID || rows > CAMERA_MOTION_MAX_GRID
+        || cols > ref_width || rows > ref_height) {
+        return false;
+    }
+    motion->reference = reference;
+    motion->width = width;
+    motion->height = height;
+    motion->ref_width = ref_width;
+    motion->ref_height = ref_height;
+    motion->shift = shift;
+    motion->cols = cols;
+    motion->rows = rows;
+    motion->has_reference = false;
+    return true;
+}
+
+// Downsamples, diffs and updates one band of reference rows. step is the distance of luma samples in bytes,
+// it is a constant at both call sites, so the compiler generates a kernel per format.
+static inline void detect_band(camera_motion_t *motion, const uint8_t *src, size_t step,
+    size_t y0, size_t y1, uint32_t *sad) {
+    const size_t shift = motion->shift;
+    const size_t scale = 1 << shift;
+    const size_t area_shift = 2 * shift;
+    const uint32_t round = (1 << area_shift) >> 1;
+    const size_t stride = motion->width * step;
+    const int learn = motion->learn;
+    const bool has_reference = motion->has_reference;
+
+    for (size_t y = y0; y < y1; y++) {
+        const uint8_t *row = src + (y << shift) * stride;
+        uint8_t *ref = motion->reference + y * motion->ref_width;
+        size_t x = 0;
+        for (size_t bx = 0; bx < motion->cols; bx++) {
+            size_t x1 = (bx + 1) * motion->ref_width / motion->cols;
+            uint32_t block_sad = 0;
+            for (; x < x1; x++) {
+                const uint8_t *p = row + (x << shift) * step;
+                uint32_t sum = 0;
+                for (size_t dy = 0; dy < scale; dy++, p += stride) {
+                    for (size_t dx = 0; dx < scale; dx++) {
+                        sum += p[dx * step];
+                    }
+                }
+                int cur = (sum + round) >> area_shift;
+                int old = ref[x];
+                int diff = cur - old;
+                block_sad += diff < 0 ? -diff : diff;
+                ref[x] = has_reference ? old + diff * learn / 256 : cur;
+            }
+            sad[bx] += block_sad;
+        }
+    }
+}
+
+size_t camera_motion_detect(camera_motion_t *motion, camera_conv_format_t format, const uint8_t *src, uint8_t *mask) {
+    uint32_t sad[CAMERA_MOTION_MAX_GRID];
+    size_t moving = 0;
+    for (size_t by = 0; by < motion->rows; by++) {
+        size_t y0 = by * motion->ref_height / motion->rows;
+        size_t y1 = (by + 1) * motion->ref_height / motion->rows;
+        memset(sad, 0, motion->cols * sizeof(sad[0]));
+        if (format == CAMERA_CONV_YUV422) {
+            detect_band(motion, src, 2, y0, y1, sad);
+        } else {
+            detect_band(motion, src, 1, y0, y1, sad);
+        }
+        uint8_t *mask_row = mask + by * motion->cols;
+        for (size_t bx = 0; bx < motion->cols; bx++) {
+            size_t pixels = ((bx + 1) * motion->ref_width / motion->cols - bx * motion->ref_width / motion->cols) * (y1 - y0);
+            mask_row[bx] = motion->has_reference && sad[bx] > motion->threshold * pixels;
+            moving += mask_row[bx];
+        }
+    }
+    motion->has_reference = true;
+    return moving;
+}
+
+size_t camera_motion_boxes(const camera_motion_t *motion, uint8_t *mask, uint16_t *queue,
+    camera_motion_box_t *boxes, size_t max_boxes) {
+    const int cols = motion->cols;
+    const int rows = motion->rows;
+    const int cells = cols * rows;
+    size_t count = 0;
+
+    for (int start = 0; start < cells; start++) {
+        if (mask[start] != 1) {
+            continue;
+        }
+        // Flood fill, visited blocks are marked with 2
+        int head = 0, tail = 0;
+        int min_x = cols, min_y = rows, max_x = 0, max_y = 0;
+        queue[tail++] = start;
+        mask[start] = 2;
+        while (head < tail) {
+            int cell = queue[head++];
+            int cx = cell % cols;
+            int cy = cell / cols;
+            min_x = cx < min_x ? cx : min_x;
+            max_x = cx > max_x ? cx : max_x;
+            min_y = cy < min_y ? cy : min_y;
+            max_y = cy > max_y ? cy : max_y;
+            for (int ny = cy - 1; ny <= cy + 1; ny++) {
+                for (int nx = cx - 1; nx <= cx + 1; nx++) {
+                    if (nx >= 0 && ny >= 0 && nx < cols && ny < rows && mask[ny * cols + nx] == 1) {
+                        mask[ny * cols + nx] = 2;
+                        queue[tail++] = ny * cols + nx;
+                    }
+                }
+            }
+        }
+
+        camera_motion_box_t box;
+        size_t x0 = min_x * motion->ref_width / cols;
+        size_t x1 = (max_x + 1) * motion->ref_width / cols;
+        size_t y0 = min_y * motion->ref_height / rows;
+        size_t y1 = (max_y + 1) * motion->ref_height / rows;
+        box.x = x0 << motion->shift;
+        box.y = y0 << motion->shift;
+        box.w = (x1 - x0) << motion->shift;
+        box.h = (y1 - y0) << motion->shift;
+        box.blocks = tail;
+
+        if (count < max_boxes) {
+            boxes[count++] = box;
+        } else if (max_boxes) {
+            // Replace the smallest region
+            size_t smallest = 0;
+            for (size_t i = 1; i < max_boxes; i++) {
+                if (boxes[i].blocks < boxes[smallest].blocks) {
+                    smallest = i;
+                }
+            }
+            if (box.blocks > boxes[smallest].blocks) {
+                boxes[smallest] = box;
+            }
+        }
+    }
+
+    for (int i = 0; i < cells; i++) {
+        mask[i] = mask[i] != 0;
+    }
+    return count;
+}
@@ -0,0 +1,117 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Christopher Nadler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MICROPY_INCLUDED_CAMERA_MOTION_H
+#define MICROPY_INCLUDED_CAMERA_MOTION_H
+
+// Block based motion detection on the luma of GRAYSCALE and YUV422 frames.
+// Like camera_conv.c, this file does not depend on MicroPython or on a camera driver.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "camera_conv.h"
+
+#define CAMERA_MOTION_MAX_GRID (32)
+
+/**
+ * @brief Motion detector state.
+ * @details The reference frame is the luma of the frames downsampled by scale (averaging scale x scale pixels).
+ * The reference is split into cols x rows blocks. A block moves, if the mean absolute difference
+ * of its pixels to the reference exceeds threshold.
+ */
+typedef struct _camera_motion_t {
+    uint8_t *reference;         // ref_width * ref_height bytes, provided by the caller
+    uint16_t width;             // Frame width
+    uint16_t height;            // Frame height
+    uint16_t ref_width;
+    uint16_t ref_height;
+    uint8_t shift;              // log2(scale)
+    uint8_t cols;
+    uint8_t rows;
+    uint8_t threshold;          // Mean absolute difference per pixel of a moving block
+    uint16_t learn;             // Weight of the current frame in the new reference in 1/256 (256 replaces it)
+    bool has_reference;
+} camera_motion_t;
+
+/**
+ * @brief Bounding box of connected moving blocks in frame pixels.
+ */
+typedef struct _camera_motion_box_t {
+    uint16_t x;
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+    uint16_t blocks;            // Number of moving blocks in the box
+} camera_motion_box_t;
+
+/**
+ * @brief Returns true, if motion detection supports the pixel format (GRAYSCALE or YUV422).
+ */
+extern bool camera_motion_supported(camera_conv_format_t format);
+
+/**
+ * @brief Returns the size of the reference buffer for a frame size.
+ *
+ * @param width Frame width.
+ * @param height Frame height.
+ * @param scale Downsampling factor (1, 2, 4 or 8).
+ * @return Size in bytes or 0 if the scale is not supported.
+ */
+extern size_t camera_motion_reference_size(size_t width, size_t height, size_t scale);
+
+/**
+ * @brief Initializes a detector without a reference. The next detected frame becomes the reference.
+ * @details threshold and learn are not touched and can be set before or after the call.
+ *
+ * @param reference Buffer of camera_motion_reference_size() bytes.
+ * @return false, if the scale or the grid (1..CAMERA_MOTION_MAX_GRID, at most one block per reference pixel) is invalid.
+ */
+extern bool camera_motion_init(camera_motion_t *motion, size_t width, size_t height, size_t scale,
+    size_t cols, size_t rows, uint8_t *reference);
+
+/**
+ * @brief Compares a frame to the reference and updates the reference in one pass.
+ *
+ * @param format Pixel format of src (GRAYSCALE or YUV422).
+ * @param src Frame of width x height pixels.
+ * @param mask Receives cols x rows bytes, 1 for moving blocks and 0 otherwise.
+ * @return Number of moving blocks. 0 for the first frame, which only sets the reference.
+ */
+extern size_t camera_motion_detect(camera_motion_t *motion, camera_conv_format_t format, const uint8_t *src, uint8_t *mask);
+
+/**
+ * @brief Finds the bounding boxes of 8-connected moving blocks.
+ * @details If there are more regions than max_boxes, the ones with the most blocks are kept.
+ *
+ * @param mask Mask of camera_motion_detect. It is modified during the call and restored afterwards.
+ * @param queue Scratch buffer of cols x rows entries.
+ * @param boxes Receives up to max_boxes boxes.
+ * @return Number of boxes written.
+ */
+extern size_t camera_motion_boxes(const camera_motion_t *motion, uint8_t *mask, uint16_t *queue,
+    camera_motion_box_t *boxes, size_t max_boxes);
+
+#endif // MICROPY_INCLUDED_CAMERA_MOTION_H
@@ -0,0 +1,252 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Christopher Nadler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "camera_pattern.h"
+#include "camera_jpeg.h"
+
+// Pixels rendered at once into the RGB888 line buffer before they are packed into the output format
+#define CHUNK_PIXELS (64)
+
+static const uint8_t colorbar_rgb[8][3] = {
+    { 255, 255, 255 }, { 255, 255, 0 }, { 0, 255, 255 }, { 0, 255, 0 },
+    { 255, 0, 255 }, { 255, 0, 0 }, { 0, 0, 255 }, { 0, 0, 0 },
+};
+
+static inline uint8_t clamp8(int v) {
+    return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+// Position on a path bouncing between 0 and range
+static inline uint32_t bounce(uint32_t t, uint32_t range) {
+    if (range == 0) {
+        return 0;
+    }
+    t %= 2 * range;
+    return t < range ? t : 2 * range - t;
+}
+
+// Geometry of the moving scene, computed once per frame
+typedef struct {
+    uint32_t box_x;
+    uint32_t box_y;
+    uint32_t box_size;
+    uint32_t diag;      // width + height - 2, at least 1
+} scene_t;
+
+static void scene_init(const camera_pattern_t *p, scene_t *scene) {
+    uint32_t size = (p->width < p->height ? p->width : p->height) / 4;
+    scene->box_size = size < 8 ? 8 : size;
+    uint32_t range_x = p->width > scene->box_size ? p->width - scene->box_size : 0;
+    uint32_t range_y = p->height > scene->box_size ? p->height - scene->box_size : 0;
+    // About 80 frames from one edge to the other
+    scene->box_x = bounce(p->frame * (p->width / 80 + 1), range_x);
+    scene->box_y = bounce(p->frame * (p->height / 80 + 1), range_y);
+    scene->diag = p->width + p->height > 2 ? p->width + p->height - 2 : 1;
+}
+
+// Renders n pixels of row y starting at column x as RGB888
+static void render_rgb(const camera_pattern_t *p, const scene_t *scene, size_t x, size_t y, size_t n, uint8_t *rgb) {
+    size_t sy = p->vflip ? p->height - 1 - y : y;
+    for (size_t i = 0; i < n; i++, rgb += 3) {
+        size_t sx = p->hmirror ? p->width - 1 - (x + i) : x + i;
+        uint8_t r, g, b;
+        if (p->colorbar) {
+            const uint8_t *bar = colorbar_rgb[sx * 8 / p->width];
+            r = bar[0];
+            g = bar[1];
+            b = bar[2];
+        } else if (sx - scene->box_x < scene->box_size && sy - scene->box_y < scene->box_size) {
+            r = g = b = 240;
+        } else {
+            r = sx * 255 / (p->width > 1 ? p->width - 1 : 1);
+            g = sy * 255 / (p->height > 1 ? p->height - 1 : 1);
+            b = 255 - (sx + sy) * 255 / scene->diag;
+        }
+        rgb[0] = clamp8((r * p->gain >> 8) + p->offset);
+        rgb[1] = clamp8((g * p->gain >> 8) + p->offset);
+        rgb[2] = clamp8((b * p->gain >> 8) + p->offset);
+    }
+}
+
+// BT.601 full range (JFIF), as in camera_conv.c
+static inline uint8_t rgb_to_y(const uint8_t *rgb) {
+    return (77 * rgb[0] + 150 * rgb[1] + 29 * rgb[2] + 128) >> 8;
+}
+
+static inline uint8_t rgb_to_u(const uint8_t *rgb) {
+    return (-43 * rgb[0] - 85 * rgb[1] + 128 * rgb[2] + 32895) >> 8;
+}
+
+static inline uint8_t rgb_to_v(const uint8_t *rgb) {
+    return (128 * rgb[0] - 107 * rgb[1] - 21 * rgb[2] + 32895) >> 8;
+}
+
+// Packs n RGB888 pixels of row y (starting at an even column) into a raw format with a fixed pixel size
+static uint8_t *pack(camera_conv_format_t format, const uint8_t *rgb, size_t n, size_t y, uint8_t *dst) {
+    switch (format) {
+        case CAMERA_CONV_RGB565:
+            for (size_t i = 0; i < n; i++, rgb += 3) {
+                uint16_t v = ((rgb[0] & 0xF8) << 8) | ((rgb[1] & 0xFC) << 3) | (rgb[2] >> 3);
+                *dst++ = v >> 8;
+                *dst++ = v & 0xFF;
+            }
+            break;
+        case CAMERA_CONV_RGB555:
+            for (size_t i = 0; i < n; i++, rgb += 3) {
+                uint16_t v = ((rgb[0] >> 3) << 10) | ((rgb[1] >> 3) << 5) | (rgb[2] >> 3);
+                *dst++ = v >> 8;
+                *dst++ = v & 0xFF;
+            }
+            break;
+        case CAMERA_CONV_RGB444:
+            for (size_t i = 0; i < n; i++, rgb += 3) {
+                *dst++ = rgb[0] >> 4;
+                *dst++ = (rgb[1] & 0xF0) | (rgb[2] >> 4);
+            }
+            break;
+        case CAMERA_CONV_RGB888:
+            memcpy(dst, rgb, n * 3);
+            dst += n * 3;
+            break;
+        case CAMERA_CONV_GRAYSCALE:
+            for (size_t i = 0; i < n; i++, rgb += 3) {
+                *dst++ = rgb_to_y(rgb);
+            }
+            break;
+        case CAMERA_CONV_YUV422:
+            // Y0 U Y1 V, the chroma of a pair is taken from its first pixel
+            for (size_t i = 0; i < n; i += 2, rgb += 6) {
+                *dst++ = rgb_to_y(rgb);
+                *dst++ = rgb_to_u(rgb);
+                if (i + 1 < n) {
+                    *dst++ = rgb_to_y(rgb + 3);
+                    *dst++ = rgb_to_v(rgb);
+                }
+            }
+            break;
+        case CAMERA_CONV_RAW:
+            // BGGR Bayer mosaic
+            for (size_t i = 0; i < n; i++, rgb += 3) {
+                *dst++ = (y & 1) ? ((i & 1) ? rgb[0] : rgb[1]) : ((i & 1) ? rgb[1] : rgb[2]);
+            }
+            break;
+        default:
+            break;
+    }
+    return dst;
+}
+
+static size_t render_raw(const camera_pattern_t *p, const scene_t *scene, uint8_t *dst) {
+    uint8_t rgb[CHUNK_PIXELS * 3];
+    uint8_t *out = dst;
+    for (size_t y = 0; y < p->height; y++) {
+        for (size_t x = 0; x < p->width; x += CHUNK_PIXELS) {
+            size_t n = p->width - x < CHUNK_PIXELS ? p->width - x : CHUNK_PIXELS;
+            render_rgb(p, scene, x, y, n, rgb);
+            out = pack(p->format, rgb, n, y, out);
+        }
+    }
+    return out - dst;
+}
+
+// Planar Y, U, V with the chroma of each 2x2 block taken from its top left pixel
+static size_t render_yuv420(const camera_pattern_t *p, const scene_t *scene, uint8_t *dst) {
+    size_t cw = (p->width + 1) / 2;
+    size_t ch = (p->height + 1) / 2;
+    uint8_t *luma = dst;
+    uint8_t *u = dst + (size_t)p->width * p->height;
+    uint8_t *v = u + cw * ch;
+    uint8_t rgb[CHUNK_PIXELS * 3];
+    for (size_t y = 0; y < p->height; y++) {
+        for (size_t x = 0; x < p->width; x += CHUNK_PIXELS) {
+            size_t n = p->width - x < CHUNK_PIXELS ? p->width - x : CHUNK_PIXELS;
+            render_rgb(p, scene, x, y, n, rgb);
+            for (size_t i = 0; i < n; i++) {
+                *luma++ = rgb_to_y(rgb + 3 * i);
+            }
+            if (!(y & 1)) {
+                for (size_t i = 0; i < n; i += 2) {
+                    *u++ = rgb_to_u(rgb + 3 * i);
+                    *v++ = rgb_to_v(rgb + 3 * i);
+                }
+            }
+        }
+    }
+    return (size_t)p->width * p->height + 2 * cw * ch;
+}
+
+// JPEG: the scene is rendered as YUV422 and encoded with 4:2:2 subsampling, like the hardware encoders of the sensors.
+// The size limit matches the frame buffer sizing of the driver (see fb_size in modcamera.c). A frame which does
+// not fit (e.g. at quality 100) is encoded again at a lower quality instead of being lost.
+
+static size_t render_jpeg(const camera_pattern_t *p, const scene_t *scene, uint8_t *dst, size_t len) {
+    camera_pattern_t yuv = *p;
+    yuv.format = CAMERA_CONV_YUV422;
+    uint8_t *raw = malloc((size_t)p->width * p->height * 2);
+    if (raw == NULL) {
+        return 0;
+    }
+    render_raw(&yuv, scene, raw);
+    size_t size = 0;
+    for (int quality = p->quality; size == 0 && quality >= 0; quality -= 10) {
+        size = camera_jpeg_encode(CAMERA_CONV_YUV422, raw, p->width, p->height, quality,
+            CAMERA_JPEG_SUBSAMPLING_422, dst, len, NULL, NULL);
+    }
+    free(raw);
+    return size;
+}
+
+size_t camera_pattern_max_size(size_t width, size_t height, camera_conv_format_t format) {
+    size_t pixels = width * height;
+    switch (format) {
+        case CAMERA_CONV_JPEG:
+            return CAMERA_JPEG_HEADER_SIZE + pixels / 5;
+        case CAMERA_CONV_YUV420:
+            return pixels + 2 * ((width + 1) / 2) * ((height + 1) / 2);
+        case CAMERA_CONV_RAW:
+            return pixels;
+        default:
+            return pixels * camera_conv_bytes_per_pixel(format);
+    }
+}
+
+size_t camera_pattern_render(const camera_pattern_t *pattern, uint8_t *dst, size_t len) {
+    size_t size = camera_pattern_max_size(pattern->width, pattern->height, pattern->format);
+    if (size == 0 || len < size) {
+        return 0;
+    }
+    scene_t scene;
+    scene_init(pattern, &scene);
+    switch (pattern->format) {
+        case CAMERA_CONV_JPEG:
+            return render_jpeg(pattern, &scene, dst, len);
+        case CAMERA_CONV_YUV420:
+            return render_yuv420(pattern, &scene, dst);
+        default:
+            return render_raw(pattern, &scene, dst);
+    }
+}
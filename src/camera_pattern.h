@@ -0,0 +1,71 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Christopher Nadler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MICROPY_INCLUDED_CAMERA_PATTERN_H
+#define MICROPY_INCLUDED_CAMERA_PATTERN_H
+
+// Synthetic test patterns in all pixel formats, the image source of the host camera (see modcamera_host.c).
+// Like camera_conv.c, this file does not depend on MicroPython or on a camera driver.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "camera_conv.h"
+
+/**
+ * @brief Scene rendered by camera_pattern_render.
+ * @details Without colorbar, the scene is a diagonal gradient with a box moving across it, so consecutive frames
+ * differ (e.g. for motion detection). The scene only depends on the parameters, so frames can be reproduced.
+ */
+typedef struct _camera_pattern_t {
+    uint16_t    width;
+    uint16_t    height;
+    camera_conv_format_t format;
+    uint32_t    frame;          // Frame number, moves the box
+    bool        colorbar;       // Eight vertical color bars instead of the moving scene
+    bool        hmirror;
+    bool        vflip;
+    uint16_t    gain;           // Brightness scale in 1/256 (256 = unchanged)
+    int16_t     offset;         // Added to each channel after scaling
+    uint8_t     quality;        // JPEG quality (0..100)
+} camera_pattern_t;
+
+/**
+ * @brief Returns the size of the largest frame camera_pattern_render can produce, 0 if the format is not supported.
+ * @details Raw formats have a fixed size. YUV420 is planar (Y, U, V) and RAW is an 8 bit BGGR Bayer mosaic.
+ */
+extern size_t camera_pattern_max_size(size_t width, size_t height, camera_conv_format_t format);
+
+/**
+ * @brief Renders a frame.
+ *
+ * @param pattern Scene and pixel format.
+ * @param dst Frame buffer.
+ * @param len Size of dst, at least camera_pattern_max_size.
+ * @return Length of the frame in bytes, 0 if the format is not supported or dst is too small.
+ */
+extern size_t camera_pattern_render(const camera_pattern_t *pattern, uint8_t *dst, size_t len);
+
+#endif // MICROPY_INCLUDED_CAMERA_PATTERN_H
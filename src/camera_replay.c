@@ -0,0 +1,180 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Christopher Nadler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "camera_replay.h"
+#include "camera_pattern.h"
+
+// Frame period of recordings with a single frame or a single timestamp
+#define DEFAULT_PERIOD_US (33333)
+
+static inline uint16_t get_u16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t get_u32(const uint8_t *p) {
+    return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+static inline int64_t get_i64(const uint8_t *p) {
+    return (int64_t)(get_u32(p) | ((uint64_t)get_u32(p + 4) << 32));
+}
+
+static bool parse_header(camera_replay_t *replay) {
+    const uint8_t *h = replay->data;
+    if (replay->size < CAMERA_REPLAY_HEADER_SIZE || memcmp(h, CAMERA_REPLAY_MAGIC, 4) != 0
+        || h[4] != CAMERA_REPLAY_VERSION || h[5] > CAMERA_CONV_RGB555) {
+        return false;
+    }
+    replay->format = (camera_conv_format_t)h[5];
+    replay->width = get_u16(h + 8);
+    replay->height = get_u16(h + 10);
+    return replay->width && replay->height;
+}
+
+// Counts the complete frames, or stores their index if the arrays are allocated
+static bool index_frames(camera_replay_t *replay) {
+    // Raw frames have a fixed size, the same as the frames of the synthetic sensor
+    size_t raw_len = replay->format == CAMERA_CONV_JPEG ? 0 : camera_pattern_max_size(replay->width, replay->height, replay->format);
+    size_t pos = CAMERA_REPLAY_HEADER_SIZE;
+    uint32_t count = 0;
+    int64_t first_us = 0;
+    int64_t last_us = 0;
+    while (replay->size - pos >= CAMERA_REPLAY_RECORD_SIZE) {
+        const uint8_t *record = replay->data + pos;
+        int64_t timestamp_us = get_i64(record);
+        uint32_t len = get_u32(record + 8);
+        if (len > replay->size - pos - CAMERA_REPLAY_RECORD_SIZE) {
+            break;
+        }
+        if (len == 0 || (raw_len && len != raw_len) || (count && timestamp_us < last_us)) {
+            return false;
+        }
+        if (count == 0) {
+            first_us = timestamp_us;
+        }
+        if (replay->offset) {
+            replay->offset[count] = pos + CAMERA_REPLAY_RECORD_SIZE;
+            replay->len[count] = len;
+            replay->time_us[count] = timestamp_us - first_us;
+        }
+        if (len > replay->max_len) {
+            replay->max_len = len;
+        }
+        last_us = timestamp_us;
+        count++;
+        pos += CAMERA_REPLAY_RECORD_SIZE + len;
+    }
+    replay->count = count;
+    int64_t period_us = count > 1 && last_us > first_us ? (last_us - first_us) / (count - 1) : DEFAULT_PERIOD_US;
+    replay->loop_us = last_us - first_us + period_us;
+    return count > 0;
+}
+
+int camera_replay_open(camera_replay_t *replay, const char *path) {
+    memset(replay, 0, sizeof(*replay));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return errno;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        int err = errno;
+        close(fd);
+        return err;
+    }
+    if (st.st_size < CAMERA_REPLAY_HEADER_SIZE) {
+        close(fd);
+        return EINVAL;
+    }
+    // Private read-only mapping: frames are handed out zero copy, the page cache holds the file only once
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int err = errno;
+    close(fd);
+    if (data == MAP_FAILED) {
+        return err;
+    }
+    replay->data = data;
+    replay->size = st.st_size;
+    if (!parse_header(replay) || !index_frames(replay)) {
+        camera_replay_close(replay);
+        return EINVAL;
+    }
+    replay->offset = malloc(replay->count * sizeof(*replay->offset));
+    replay->len = malloc(replay->count * sizeof(*replay->len));
+    replay->time_us = malloc(replay->count * sizeof(*replay->time_us));
+    if (!replay->offset || !replay->len || !replay->time_us) {
+        camera_replay_close(replay);
+        return ENOMEM;
+    }
+    index_frames(replay);
+    return 0;
+}
+
+void camera_replay_close(camera_replay_t *replay) {
+    if (replay->data) {
+        munmap((void *)replay->data, replay->size);
+    }
+    free(replay->offset);
+    free(replay->len);
+    free(replay->time_us);
+    memset(replay, 0, sizeof(*replay));
+}
+
+int64_t camera_replay_frame_time(const camera_replay_t *replay, uint32_t frame) {
+    return (int64_t)(frame / replay->count) * replay->loop_us + replay->time_us[frame % replay->count];
+}
+
+uint32_t camera_replay_frames_started(const camera_replay_t *replay, int64_t elapsed_us) {
+    if (elapsed_us < 0) {
+        return 0;
+    }
+    uint32_t loops = elapsed_us / replay->loop_us;
+    int64_t time_us = elapsed_us % replay->loop_us;
+    // Frames of the current loop which started up to time_us (time_us[0] is 0, so at least one)
+    uint32_t lo = 1;
+    uint32_t hi = replay->count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (replay->time_us[mid] <= time_us) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return loops * replay->count + lo;
+}
+
+const uint8_t *camera_replay_frame(const camera_replay_t *replay, uint32_t frame, size_t *len) {
+    uint32_t i = frame % replay->count;
+    *len = replay->len[i];
+    return replay->data + replay->offset[i];
+}
@@ -0,0 +1,121 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Christopher Nadler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MICROPY_INCLUDED_CAMERA_REPLAY_H
+#define MICROPY_INCLUDED_CAMERA_REPLAY_H
+
+// Recorded frame sequences, the second image source of the host camera (see modcamera_host.c).
+// Like camera_conv.c, this file does not depend on MicroPython. It needs mmap, so it is only built on POSIX hosts.
+// The inline writers of the file format are used on all ports (see PreEventBuffer in modcamera_stream.c).
+//
+// File format (little endian), e.g. written by examples/record.py:
+//   header:  "MPCR", u8 version (1), u8 pixel format, u16 0, u16 width, u16 height, u32 0
+//   frames:  i64 timestamp_us, u32 length, length bytes of frame data
+// Timestamps are the capture timestamps of the frames and must not decrease.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "camera_conv.h"
+
+#define CAMERA_REPLAY_MAGIC         "MPCR"
+#define CAMERA_REPLAY_VERSION       (1)
+#define CAMERA_REPLAY_HEADER_SIZE   (16)
+#define CAMERA_REPLAY_RECORD_SIZE   (12)
+
+/**
+ * @brief Memory-mapped recording.
+ * @details The recording repeats endlessly. Frame k of the replay is frame k % count of the file and starts
+ * at camera_replay_frame_time(k), one loop lasts the recording plus one mean frame period.
+ */
+typedef struct _camera_replay_t {
+    const uint8_t   *data;          // Mapped file
+    size_t          size;
+    camera_conv_format_t format;
+    uint16_t        width;
+    uint16_t        height;
+    uint32_t        count;          // Number of frames
+    size_t          *offset;        // Offset of the data of each frame
+    uint32_t        *len;           // Length of each frame
+    int64_t         *time_us;       // Start of each frame relative to the first one
+    int64_t         loop_us;        // Duration of one loop
+    size_t          max_len;        // Length of the largest frame
+} camera_replay_t;
+
+/**
+ * @brief Maps a recording and indexes its frames. A truncated last frame (interrupted recording) is ignored.
+ * @return 0 on success, an errno value otherwise (EINVAL if the file is not a valid recording).
+ */
+extern int camera_replay_open(camera_replay_t *replay, const char *path);
+
+/**
+ * @brief Unmaps the recording. Frames returned by camera_replay_frame are invalid afterwards.
+ */
+extern void camera_replay_close(camera_replay_t *replay);
+
+/**
+ * @brief Returns the start of replay frame k relative to the start of frame 0.
+ */
+extern int64_t camera_replay_frame_time(const camera_replay_t *replay, uint32_t frame);
+
+/**
+ * @brief Returns the number of replay frames which started at elapsed_us after the start of frame 0.
+ */
+extern uint32_t camera_replay_frames_started(const camera_replay_t *replay, int64_t elapsed_us);
+
+/**
+ * @brief Returns the data of replay frame k, it points into the mapped file.
+ */
+extern const uint8_t *camera_replay_frame(const camera_replay_t *replay, uint32_t frame, size_t *len);
+
+/**
+ * @brief Writes the file header of a recording.
+ */
+static inline void camera_replay_put_header(uint8_t dst[CAMERA_REPLAY_HEADER_SIZE], camera_conv_format_t format,
+    uint16_t width, uint16_t height) {
+    memset(dst, 0, CAMERA_REPLAY_HEADER_SIZE);
+    memcpy(dst, CAMERA_REPLAY_MAGIC, 4);
+    dst[4] = CAMERA_REPLAY_VERSION;
+    dst[5] = format;
+    dst[8] = width;
+    dst[9] = width >> 8;
+    dst[10] = height;
+    dst[11] = height >> 8;
+}
+
+/**
+ * @brief Writes the header of a frame record, the len bytes of frame data follow.
+ */
+static inline void camera_replay_put_record(uint8_t dst[CAMERA_REPLAY_RECORD_SIZE], int64_t timestamp_us, uint32_t len) {
+    for (int i = 0; i < 8; i++) {
+        dst[i] = (uint64_t)timestamp_us >> (8 * i);
+    }
+    for (int i = 0; i < 4; i++) {
+        dst[8 + i] = len >> (8 * i);
+    }
+}
+
+#endif // MICROPY_INCLUDED_CAMERA_REPLAY_H
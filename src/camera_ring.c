@@ -0,0 +1,96 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Christopher Nadler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "camera_ring.h"
+
+void camera_ring_init(camera_ring_t *ring, uint8_t *buf, size_t size, camera_ring_entry_t *entries, size_t capacity) {
+    ring->buf = buf;
+    ring->size = size;
+    ring->entries = entries;
+    ring->capacity = capacity;
+    camera_ring_clear(ring);
+}
+
+void camera_ring_clear(camera_ring_t *ring) {
+    ring->head = 0;
+    ring->count = 0;
+    ring->write = 0;
+    ring->bytes = 0;
+    ring->evicted = 0;
+}
+
+static void evict_oldest(camera_ring_t *ring) {
+    ring->bytes -= ring->entries[ring->head].len;
+    ring->head = (ring->head + 1) % ring->capacity;
+    ring->count--;
+    ring->evicted++;
+}
+
+uint8_t *camera_ring_push(camera_ring_t *ring, size_t len, int64_t timestamp_us, uint32_t sequence) {
+    if (len > ring->size || ring->capacity == 0) {
+        return NULL;
+    }
+    if (ring->count == ring->capacity) {
+        evict_oldest(ring);
+    }
+    size_t pos;
+    for (;;) {
+        if (ring->count == 0) {
+            pos = 0;
+            break;
+        }
+        size_t tail = ring->entries[ring->head].offset;
+        if (tail < ring->write) {
+            // Frames in [tail, write), free space after them and before them
+            if (ring->write + len <= ring->size) {
+                pos = ring->write;
+                break;
+            }
+            if (len <= tail) {
+                pos = 0;
+                break;
+            }
+        } else if (ring->write + len <= tail) {
+            // Frames in [tail, size) and [0, write), free space in between
+            pos = ring->write;
+            break;
+        }
+        evict_oldest(ring);
+    }
+    camera_ring_entry_t *entry = &ring->entries[(ring->head + ring->count) % ring->capacity];
+    entry->offset = pos;
+    entry->len = len;
+    entry->timestamp_us = timestamp_us;
+    entry->sequence = sequence;
+    ring->count++;
+    ring->write = pos + len;
+    ring->bytes += len;
+    return ring->buf + pos;
+}
+
+void camera_ring_evict_before(camera_ring_t *ring, int64_t min_timestamp_us) {
+    while (ring->count && ring->entries[ring->head].timestamp_us < min_timestamp_us) {
+        evict_oldest(ring);
+    }
+}
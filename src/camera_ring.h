@@ -0,0 +1,92 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Christopher Nadler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MICROPY_INCLUDED_CAMERA_RING_H
+#define MICROPY_INCLUDED_CAMERA_RING_H
+
+// Ring buffer of variable size frames, e.g. the frames before an event (see PreEventBuffer in modcamera_stream.c).
+// Like camera_conv.c, this file does not depend on MicroPython or on a camera driver.
+//
+// Every frame is stored contiguously, so it can be written out without copying. A frame which does not fit
+// between the newest frame and the end of the buffer starts at the beginning. The oldest frames are evicted
+// until there is room, so adding a frame costs one copy and O(1) per evicted frame.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Position and capture information of a frame in the ring.
+ */
+typedef struct _camera_ring_entry_t {
+    size_t      offset;
+    size_t      len;
+    int64_t     timestamp_us;
+    uint32_t    sequence;
+} camera_ring_entry_t;
+
+typedef struct _camera_ring_t {
+    uint8_t     *buf;
+    size_t      size;
+    camera_ring_entry_t *entries;   // Circular queue of the frames, oldest first
+    size_t      capacity;           // Maximum number of frames
+    size_t      head;               // Index of the oldest frame
+    size_t      count;
+    size_t      write;              // End of the newest frame
+    size_t      bytes;              // Sum of the frame lengths
+    uint32_t    evicted;            // Frames evicted since the last clear
+} camera_ring_t;
+
+/**
+ * @brief Initializes an empty ring.
+ *
+ * @param buf Frame data of up to size bytes.
+ * @param entries Buffer of capacity entries.
+ */
+extern void camera_ring_init(camera_ring_t *ring, uint8_t *buf, size_t size, camera_ring_entry_t *entries, size_t capacity);
+
+/**
+ * @brief Removes all frames.
+ */
+extern void camera_ring_clear(camera_ring_t *ring);
+
+/**
+ * @brief Adds a frame, evicting the oldest frames until there is room for it.
+ * @return Destination of the len bytes of the frame data, NULL if len is larger than the ring.
+ */
+extern uint8_t *camera_ring_push(camera_ring_t *ring, size_t len, int64_t timestamp_us, uint32_t sequence);
+
+/**
+ * @brief Evicts the frames with a timestamp before min_timestamp_us.
+ */
+extern void camera_ring_evict_before(camera_ring_t *ring, int64_t min_timestamp_us);
+
+/**
+ * @brief Returns frame i, 0 is the oldest one.
+ */
+static inline const camera_ring_entry_t *camera_ring_get(const camera_ring_t *ring, size_t i) {
+    return &ring->entries[(ring->head + i) % ring->capacity];
+}
+
+#endif // MICROPY_INCLUDED_CAMERA_RING_H
@@ -0,0 +1,163 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Christopher Nadler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "camera_stats.h"
+
+bool camera_stats_supported(camera_conv_format_t format) {
+    return format == CAMERA_CONV_RGB565 || format == CAMERA_CONV_RGB888
+        || format == CAMERA_CONV_GRAYSCALE || format == CAMERA_CONV_YUV422;
+}
+
+typedef struct {
+    uint32_t sum[3];
+    uint8_t min[3];
+    uint8_t max[3];
+} channel_acc_t;
+
+static inline void accumulate(channel_acc_t *acc, size_t channel, uint8_t value) {
+    acc->sum[channel] += value;
+    acc->min[channel] = value < acc->min[channel] ? value : acc->min[channel];
+    acc->max[channel] = value > acc->max[channel] ? value : acc->max[channel];
+}
+
+// Samples one pixel and returns its luma. format is a constant at all call sites,
+// so the compiler generates a kernel per format.
+static inline uint8_t sample(camera_conv_format_t format, const uint8_t *row, size_t x, channel_acc_t *acc) {
+    switch (format) {
+        case CAMERA_CONV_RGB565: {
+            const uint8_t *p = row + x * 2;
+            uint8_t r5 = p[0] >> 3, g6 = ((p[0] & 0x07) << 3) | (p[1] >> 5), b5 = p[1] & 0x1F;
+            uint8_t r = (r5 << 3) | (r5 >> 2), g = (g6 << 2) | (g6 >> 4), b = (b5 << 3) | (b5 >> 2);
+            accumulate(acc, 0, r);
+            accumulate(acc, 1, g);
+            accumulate(acc, 2, b);
+            return (77 * r + 150 * g + 29 * b + 128) >> 8;
+        }
+        case CAMERA_CONV_RGB888: {
+            const uint8_t *p = row + x * 3;
+            accumulate(acc, 0, p[0]);
+            accumulate(acc, 1, p[1]);
+            accumulate(acc, 2, p[2]);
+            return (77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8;
+        }
+        case CAMERA_CONV_YUV422: {
+            // Y0 U Y1 V: both pixels of a pair share U and V
+            const uint8_t *pair = row + (x & ~(size_t)1) * 2;
+            uint8_t y = pair[(x & 1) * 2];
+            accumulate(acc, 0, y);
+            accumulate(acc, 1, pair[1]);
+            accumulate(acc, 2, pair[3]);
+            return y;
+        }
+        default: {
+            uint8_t y = row[x];
+            accumulate(acc, 0, y);
+            return y;
+        }
+    }
+}
+
+static inline void stats_kernel(camera_conv_format_t format, const uint8_t *src, size_t width, size_t height,
+    size_t stride, size_t cols, size_t rows, uint32_t *histogram, channel_acc_t *acc, uint8_t *grid) {
+    const size_t line = width * camera_conv_bytes_per_pixel(format);
+    uint32_t sums[CAMERA_STATS_MAX_GRID];
+    uint32_t counts[CAMERA_STATS_MAX_GRID];
+
+    for (size_t by = 0; by < rows; by++) {
+        size_t y0 = by * height / rows;
+        size_t y1 = (by + 1) * height / rows;
+        memset(sums, 0, cols * sizeof(sums[0]));
+        memset(counts, 0, cols * sizeof(counts[0]));
+        // Rows and columns are sampled on a global lattice, so the blocks do not change the sampling
+        for (size_t y = (y0 + stride - 1) / stride * stride; y < y1; y += stride) {
+            const uint8_t *row = src + y * line;
+            size_t x = 0;
+            for (size_t bx = 0; bx < cols; bx++) {
+                size_t x1 = (bx + 1) * width / cols;
+                uint32_t sum = 0, count = 0;
+                for (; x < x1; x += stride) {
+                    uint8_t luma = sample(format, row, x, acc);
+                    histogram[luma]++;
+                    sum += luma;
+                    count++;
+                }
+                sums[bx] += sum;
+                counts[bx] += count;
+            }
+        }
+        if (grid) {
+            for (size_t bx = 0; bx < cols; bx++) {
+                grid[by * cols + bx] = counts[bx] ? (sums[bx] + counts[bx] / 2) / counts[bx] : 0;
+            }
+        }
+    }
+}
+
+bool camera_stats_compute(camera_conv_format_t format, const uint8_t *src, size_t width, size_t height,
+    size_t stride, size_t cols, size_t rows, camera_stats_t *stats, uint8_t *grid) {
+    if (!camera_stats_supported(format) || stride == 0 || cols == 0 || rows == 0
+        || cols > CAMERA_STATS_MAX_GRID || rows > CAMERA_STATS_MAX_GRID
+        || width / cols < stride || height / rows < stride) {
+        return false;
+    }
+
+    channel_acc_t acc;
+    memset(&acc, 0, sizeof(acc));
+    memset(acc.min, 0xFF, sizeof(acc.min));
+    memset(stats->histogram, 0, sizeof(stats->histogram));
+
+    switch (format) {
+        case CAMERA_CONV_RGB565:
+            stats_kernel(CAMERA_CONV_RGB565, src, width, height, stride, cols, rows, stats->histogram, &acc, grid);
+            break;
+        case CAMERA_CONV_RGB888:
+            stats_kernel(CAMERA_CONV_RGB888, src, width, height, stride, cols, rows, stats->histogram, &acc, grid);
+            break;
+        case CAMERA_CONV_YUV422:
+            stats_kernel(CAMERA_CONV_YUV422, src, width, height, stride, cols, rows, stats->histogram, &acc, grid);
+            break;
+        default:
+            stats_kernel(CAMERA_CONV_GRAYSCALE, src, width, height, stride, cols, rows, stats->histogram, &acc, grid);
+            break;
+    }
+
+    uint32_t samples = 0;
+    uint32_t luma_sum = 0;
+    for (size_t i = 0; i < 256; i++) {
+        samples += stats->histogram[i];
+        luma_sum += stats->histogram[i] * i;
+    }
+    stats->samples = samples;
+    stats->format = format;
+    stats->channels = format == CAMERA_CONV_GRAYSCALE ? 1 : 3;
+    stats->luma = samples ? (luma_sum + samples / 2) / samples : 0;
+    for (size_t c = 0; c < stats->channels; c++) {
+        stats->mean[c] = samples ? (acc.sum[c] + samples / 2) / samples : 0;
+        stats->min[c] = samples ? acc.min[c] : 0;
+        stats->max[c] = acc.max[c];
+    }
+    return true;
+}
@@ -0,0 +1,76 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Christopher Nadler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MICROPY_INCLUDED_CAMERA_STATS_H
+#define MICROPY_INCLUDED_CAMERA_STATS_H
+
+// Image statistics (luma histogram, channel statistics and block means) of raw frames in one pass.
+// Like camera_conv.c, this file does not depend on MicroPython or on a camera driver.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "camera_conv.h"
+
+#define CAMERA_STATS_MAX_GRID (32)
+
+/**
+ * @brief Statistics of the sampled pixels of a frame.
+ * @details Channels are R, G, B for RGB565 and RGB888 (expanded to 8 bits), Y, U, V for YUV422 and Y for GRAYSCALE.
+ * Luma is computed with the BT.601 weights for RGB formats.
+ */
+typedef struct _camera_stats_t {
+    uint32_t    histogram[256];     // Luma histogram
+    uint32_t    samples;            // Number of sampled pixels
+    camera_conv_format_t format;
+    uint8_t     channels;
+    uint8_t     luma;               // Mean luma
+    uint8_t     mean[3];
+    uint8_t     min[3];
+    uint8_t     max[3];
+} camera_stats_t;
+
+/**
+ * @brief Returns true, if statistics support the pixel format (RGB565, RGB888, GRAYSCALE or YUV422).
+ */
+extern bool camera_stats_supported(camera_conv_format_t format);
+
+/**
+ * @brief Computes the statistics of a frame and the mean luma of cols x rows blocks in one pass.
+ * @details Only every stride-th pixel of every stride-th row is sampled.
+ *
+ * @param format Pixel format of src.
+ * @param src Frame of width x height pixels.
+ * @param stride Sampling distance in pixels (>= 1). Blocks must be at least stride pixels wide and high.
+ * @param cols Number of block columns (1..CAMERA_STATS_MAX_GRID).
+ * @param rows Number of block rows (1..CAMERA_STATS_MAX_GRID).
+ * @param stats Receives the statistics.
+ * @param grid Receives cols x rows block means (row by row) or NULL.
+ * @return false, if the format, stride or grid is not supported.
+ */
+extern bool camera_stats_compute(camera_conv_format_t format, const uint8_t *src, size_t width, size_t height,
+    size_t stride, size_t cols, size_t rows, camera_stats_t *stats, uint8_t *grid);
+
+#endif // MICROPY_INCLUDED_CAMERA_STATS_H
@@ -1,4 +1,5 @@
+# Make-based ports (e.g. unix) build the host HAL with the synthetic sensor, the esp32 port builds with micropython.cmake
 CAMERA_MOD_DIR := $(USERMOD_DIR)
-SRC_USERMOD_C += $(addprefix $(CAMERA_MOD_DIR)/, modcamera_api.c)
-SRC_USERMOD_LIB_C += $(addprefix $(CAMERA_MOD_DIR)/, modcamera.c)
-CFLAGS_USERMOD += -I$(CAMERA_MOD_DIR)
\ No newline at end of file
+SRC_USERMOD_C += $(addprefix $(CAMERA_MOD_DIR)/, modcamera_api.c modcamera_frame.c modcamera_stream.c modcamera_analysis.c modcamera_host.c)
+SRC_USERMOD_LIB_C += $(addprefix $(CAMERA_MOD_DIR)/, camera_conv.c camera_motion.c camera_stats.c camera_exposure.c camera_pattern.c camera_replay.c camera_avi.c camera_ring.c camera_jpeg.c)
+CFLAGS_USERMOD += -I$(CAMERA_MOD_DIR) -DMICROPY_CAMERA_HOST=1
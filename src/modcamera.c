@@ -26,8 +26,13 @@
  */
 
 #include "modcamera.h"
+#include "camera_conv.h"
+#include "camera_jpeg.h"
+#include "img_converters.h"
 #include "esp_err.h"
 #include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "mphalport.h"
 
 #define TAG "MPY_CAMERA"
@@ -36,6 +41,16 @@
 #error Camera only works on boards configured with spiram
 #endif
 
+#if MICROPY_CAMERA_PERF
+#define PERF_NOW() esp_timer_get_time()
+#define PERF_RECORD(self, hist, start_us) mp_camera_perf_record(&(self)->perf.hist, esp_timer_get_time() - (start_us))
+#define PERF_COUNT(self, counter) ((self)->perf.counter++)
+#else
+#define PERF_NOW() ((int64_t)0)
+#define PERF_RECORD(self, hist, start_us) ((void)(start_us))
+#define PERF_COUNT(self, counter)
+#endif
+
 // Helper functions
 static int map(int value, int fromLow, int fromHigh, int toLow, int toHigh) {
     if (fromHigh == fromLow) {
@@ -63,9 +78,9 @@ static void set_check_xclk_freq(mp_camera_obj_t *self, int32_t xclk_freq_hz) {
 }
 
 static void set_check_fb_count(mp_camera_obj_t *self, mp_int_t fb_count) {
-    if (fb_count > 2) {
-        self->camera_config.fb_count = 2;
-        mp_warning(NULL, "Frame buffer size limited to 2");
+    if (fb_count > MICROPY_CAMERA_MAX_FB_COUNT) {
+        self->camera_config.fb_count = MICROPY_CAMERA_MAX_FB_COUNT;
+        mp_warning(NULL, "Frame buffer count limited to %d", MICROPY_CAMERA_MAX_FB_COUNT);
     } else if (fb_count < 1) {
         self->camera_config.fb_count = 1;
         mp_warning(NULL, "Frame buffer size must be >0. Setting it to 1");
@@ -91,6 +106,213 @@ static void set_check_pixel_format(mp_camera_obj_t *self, mp_camera_pixformat_t
     }
 }
 
+static void return_frame(mp_camera_obj_t *self, hal_camera_frame_slot_t *slot) {
+    PERF_RECORD(self, hold, slot->handed_out_us);
+    esp_camera_fb_return(slot->fb);
+    slot->fb = NULL;
+    slot->held = false;
+}
+
+static camera_fb_t *take_ready_fb(mp_camera_obj_t *self) {
+    portENTER_CRITICAL(&self->ready_lock);
+    camera_fb_t *fb = self->ready_fb;
+    self->ready_fb = NULL;
+    portEXIT_CRITICAL(&self->ready_lock);
+    if (fb && self->watcher) {
+        xTaskNotifyGive(self->watcher);     // Let the watcher grab the next frame right away
+    }
+    return fb;
+}
+
+static void return_all_frames(mp_camera_obj_t *self) {
+    for (size_t i = 0; i < MICROPY_CAMERA_MAX_FB_COUNT; i++) {
+        if (self->frames[i].fb) {
+            return_frame(self, &self->frames[i]);
+        }
+    }
+    camera_fb_t *fb = take_ready_fb(self);
+    if (fb) {
+        esp_camera_fb_return(fb);
+    }
+}
+
+static inline int64_t fb_timestamp_us(camera_fb_t *fb) {
+    return (int64_t)fb->timestamp.tv_sec * 1000000 + fb->timestamp.tv_usec;
+}
+
+// Numbers a grabbed frame by the sensor frames passed since the last one. The frame period is the
+// smoothed interval of consecutive frames; intervals of n periods count n - 1 frames as dropped.
+static void account_frame(mp_camera_obj_t *self, camera_fb_t *fb) {
+    int64_t timestamp_us = fb_timestamp_us(fb);
+    int64_t interval_us = timestamp_us - self->last_timestamp_us;
+    uint32_t frames = 1;
+    if (self->last_timestamp_us && interval_us > 0 && interval_us < INT32_MAX) {
+        uint32_t period = self->frame_period_us;
+        if (period == 0 || interval_us < period * 3 / 4) {
+            // First interval, or frames were dropped within the first one
+            self->frame_period_us = interval_us;
+        } else if (interval_us < period * 3 / 2) {
+            self->frame_period_us = period + ((int32_t)interval_us - (int32_t)period) / 8;
+        } else {
+            frames = (interval_us + period / 2) / period;
+        }
+    }
+    self->last_timestamp_us = timestamp_us;
+    self->sensor_seq += frames;
+    self->dropped += frames - 1;
+    self->captured++;
+}
+
+static void apply_pending_settings(mp_camera_obj_t *self);
+
+// Frames started before the last deferred settings batch was written have (partly) old settings
+static inline bool frame_is_stale(mp_camera_obj_t *self, camera_fb_t *fb) {
+    return fb_timestamp_us(fb) < self->settings_since_us;
+}
+
+// Prefer the frame the watcher already grabbed, it is the latest one
+static camera_fb_t *grab_frame(mp_camera_obj_t *self) {
+    PERF_COUNT(self, captures);
+    camera_fb_t *fb = take_ready_fb(self);
+    if (fb && frame_is_stale(self, fb)) {
+        esp_camera_fb_return(fb);
+        fb = NULL;
+    }
+    if (!fb) {
+        int64_t start_us = PERF_NOW();
+        fb = esp_camera_fb_get();
+        while (fb && frame_is_stale(self, fb)) {
+            esp_camera_fb_return(fb);
+            fb = esp_camera_fb_get();
+        }
+        PERF_RECORD(self, fb_get, start_us);
+    }
+    if (fb) {
+        account_frame(self, fb);
+        // The frame is complete, so the batch takes effect from the frame boundary on
+        apply_pending_settings(self);
+    } else {
+        PERF_COUNT(self, failed);
+    }
+    return fb;
+}
+
+static void frame_watcher_task(void *arg) {
+    mp_camera_obj_t *self = arg;
+    while (self->watching) {
+        if (self->ready_fb && !esp_camera_available_frames()) {
+            // Wait for a newer frame or for the ready frame to be handed out (with fb_count = 1 the driver needs it back first)
+            ulTaskNotifyTake(pdTRUE, 1);
+            continue;
+        }
+        camera_fb_t *fb = esp_camera_fb_get();
+        if (!fb) {
+            continue;
+        }
+        portENTER_CRITICAL(&self->ready_lock);
+        camera_fb_t *old_fb = self->ready_fb;
+        self->ready_fb = fb;
+        if (old_fb) {
+            self->coalesced++;
+        }
+        bool schedule = !self->dispatch_pending;
+        self->dispatch_pending = true;
+        portEXIT_CRITICAL(&self->ready_lock);
+
+        if (old_fb) {
+            esp_camera_fb_return(old_fb);
+        }
+        if (schedule && !mp_sched_schedule(self->dispatch, MP_OBJ_FROM_PTR(self))) {
+            // Scheduler queue is full, retry with the next frame
+            portENTER_CRITICAL(&self->ready_lock);
+            self->dispatch_pending = false;
+            portEXIT_CRITICAL(&self->ready_lock);
+        }
+    }
+    xSemaphoreGive(self->watcher_done);
+    vTaskDelete(NULL);
+}
+
+static void start_watcher(mp_camera_obj_t *self) {
+    self->watching = true;
+    self->dispatch_pending = false;
+    self->watcher_done = xSemaphoreCreateBinary();
+    if (!self->watcher_done || xTaskCreate(frame_watcher_task, "camera_watcher", 3 * 1024, self,
+        uxTaskPriorityGet(NULL), &self->watcher) != pdPASS) {
+        self->watching = false;
+        self->watcher = NULL;
+        if (self->watcher_done) {
+            vSemaphoreDelete(self->watcher_done);
+            self->watcher_done = NULL;
+        }
+        mp_raise_OSError(MP_ENOMEM);
+    }
+}
+
+// Waits for the watcher to finish, it might be blocked until the driver delivers the next frame
+static void stop_watcher(mp_camera_obj_t *self) {
+    if (!self->watcher) {
+        return;
+    }
+    self->watching = false;
+    xTaskNotifyGive(self->watcher);
+    xSemaphoreTake(self->watcher_done, portMAX_DELAY);
+    vSemaphoreDelete(self->watcher_done);
+    self->watcher = NULL;
+    self->watcher_done = NULL;
+}
+
+static hal_camera_frame_slot_t *find_frame(mp_camera_obj_t *self, uint32_t seq) {
+    for (size_t i = 0; i < MICROPY_CAMERA_MAX_FB_COUNT; i++) {
+        if (self->frames[i].fb && self->frames[i].seq == seq) {
+            return &self->frames[i];
+        }
+    }
+    return NULL;
+}
+
+// Heap header and DMA alignment of each frame buffer allocation
+#define FB_ALLOC_OVERHEAD (64)
+
+// Same sizing as the camera driver: JPEG buffers get a fifth of the pixel count, raw buffers the frame in output format
+static size_t fb_size(mp_camera_framesize_t frame_size, mp_camera_pixformat_t pixel_format) {
+    if (frame_size >= FRAMESIZE_INVALID) {
+        mp_raise_ValueError(MP_ERROR_TEXT("Invalid frame_size"));
+    }
+    size_t pixels = (size_t)resolution[frame_size].width * resolution[frame_size].height;
+    if (pixel_format == PIXFORMAT_JPEG) {
+        return pixels / 5;
+    }
+    size_t bytes_per_pixel = camera_conv_bytes_per_pixel((camera_conv_format_t)pixel_format);
+    return pixels * (bytes_per_pixel ? bytes_per_pixel : 2);
+}
+
+void mp_camera_hal_plan_memory(mp_camera_obj_t *self, mp_camera_framesize_t frame_size, mp_camera_pixformat_t pixel_format, mp_int_t fb_count, mp_camera_memory_plan_t *plan) {
+    plan->fb_size = fb_size(frame_size, pixel_format);
+    plan->required = fb_count * (plan->fb_size + FB_ALLOC_OVERHEAD) + MICROPY_CAMERA_PSRAM_RESERVE;
+    plan->available = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    plan->largest_block = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+    if (self->initialized) {
+        plan->available += self->camera_config.fb_count * (self->fb_alloc_size + FB_ALLOC_OVERHEAD);
+        plan->largest_block = MAX(plan->largest_block, self->fb_alloc_size);
+    }
+    plan->max_fb_count = 0;
+    if (plan->fb_size <= plan->largest_block && plan->available > MICROPY_CAMERA_PSRAM_RESERVE) {
+        plan->max_fb_count = MIN((plan->available - MICROPY_CAMERA_PSRAM_RESERVE) / (plan->fb_size + FB_ALLOC_OVERHEAD), MICROPY_CAMERA_MAX_FB_COUNT);
+    }
+    plan->fits = fb_count <= plan->max_fb_count;
+}
+
+// Reject configurations which do not fit, before the driver runs out of memory in the middle of its initialization
+static void check_memory(mp_camera_obj_t *self, mp_camera_framesize_t frame_size, mp_camera_pixformat_t pixel_format, mp_int_t fb_count) {
+    mp_camera_memory_plan_t plan;
+    mp_camera_hal_plan_memory(self, frame_size, pixel_format, fb_count, &plan);
+    if (!plan.fits) {
+        mp_raise_msg_varg(&mp_type_MemoryError, MP_ERROR_TEXT("%d frame buffers need %u bytes of PSRAM, %u bytes available (max. fb_count %d)"),
+            (int)fb_count, (unsigned int)plan.required, (unsigned int)plan.available, plan.max_fb_count);
+    }
+}
+
 static bool init_camera(mp_camera_obj_t *self) {
     // Correct the quality before it is passed to esp32 driver and then "undo" the correction in the camera_config
     int8_t api_jpeg_quality = self->camera_config.jpeg_quality;
@@ -98,6 +320,9 @@ static bool init_camera(mp_camera_obj_t *self) {
     esp_err_t err = esp_camera_init(&self->camera_config);
     self->camera_config.jpeg_quality = api_jpeg_quality;
     check_esp_err(err);
+    self->fb_alloc_size = fb_size(self->camera_config.frame_size, self->camera_config.pixel_format);
+    // The capabilities do not change while the camera runs, so they are looked up once
+    self->sensor_info = esp_camera_sensor_get_info(&esp_camera_sensor_get()->id);
     return true;
 }
 
@@ -158,7 +383,25 @@ void mp_camera_hal_construct(
         self->camera_config.ledc_channel = LEDC_CHANNEL_0;
 
         self->initialized = false;
-        self->captured_buffer = NULL;
+        self->fb_alloc_size = 0;
+        self->sensor_info = NULL;
+        memset(self->frames, 0, sizeof(self->frames));
+        self->watcher = NULL;
+        self->watcher_done = NULL;
+        self->watching = false;
+        self->dispatch = MP_OBJ_NULL;
+        self->ready_fb = NULL;
+        self->coalesced = 0;
+        portMUX_INITIALIZE(&self->ready_lock);
+        self->sensor_seq = 0;
+        self->last_timestamp_us = 0;
+        self->frame_period_us = 0;
+        self->captured = 0;
+        self->dropped = 0;
+        memset(&self->perf, 0, sizeof(self->perf));
+        self->perf.since_us = PERF_NOW();
+        self->pending_settings.mask = 0;
+        self->settings_since_us = 0;
     }
 
 void mp_camera_hal_init(mp_camera_obj_t *self) {
@@ -170,17 +413,20 @@ void mp_camera_hal_init(mp_camera_obj_t *self) {
             mp_warning(NULL, "It is recomended to use a frame buffer size of 1 for non-JPEG pixel format");
         }
     #endif
+    check_memory(self, self->camera_config.frame_size, self->camera_config.pixel_format, self->camera_config.fb_count);
     ESP_LOGI(TAG, "Initializing camera");
+    int64_t start_us = PERF_NOW();
     self->initialized = init_camera(self);
+    PERF_RECORD(self, init, start_us);
     ESP_LOGI(TAG, "Camera initialized successfully");
 }
 
 void mp_camera_hal_deinit(mp_camera_obj_t *self) {
     if (self->initialized) {
-        if (self->captured_buffer) {
-            esp_camera_return_all();
-            self->captured_buffer = NULL;
-        }
+        stop_watcher(self);
+        self->dispatch = MP_OBJ_NULL;
+        return_all_frames(self);
+        self->pending_settings.mask = 0;
         esp_err_t err = esp_camera_deinit();
         check_esp_err(err);
         self->initialized = false;
@@ -188,37 +434,333 @@ void mp_camera_hal_deinit(mp_camera_obj_t *self) {
     }
 }
 
-void mp_camera_hal_reconfigure(mp_camera_obj_t *self, mp_camera_framesize_t frame_size, mp_camera_pixformat_t pixel_format, mp_camera_grabmode_t grab_mode, mp_int_t fb_count) {
+// Raw formats the driver receives and stores with the same layout of two bytes per pixel
+static bool is_raw16_format(mp_camera_pixformat_t pixel_format) {
+    return pixel_format == PIXFORMAT_RGB565 || pixel_format == PIXFORMAT_YUV422;
+}
+
+// The driver sizes its DMA transfers and frame buffers at init. JPEG frames of any frame size fit as long as
+// they are not larger than the allocated buffers, raw frames only if the frame size and pixel layout stay the same.
+static bool sensor_can_switch(mp_camera_obj_t *self, mp_camera_framesize_t frame_size, mp_camera_pixformat_t pixel_format, mp_camera_grabmode_t grab_mode, mp_int_t fb_count) {
+    camera_config_t *config = &self->camera_config;
+    if (grab_mode != config->grab_mode || fb_count != config->fb_count) {
+        return false;
+    }
+    if (pixel_format == PIXFORMAT_JPEG && config->pixel_format == PIXFORMAT_JPEG) {
+        return fb_size(frame_size, pixel_format) <= self->fb_alloc_size;
+    }
+    return frame_size == config->frame_size && is_raw16_format(pixel_format) && is_raw16_format(config->pixel_format);
+}
+
+// Drops the frames which were captured with the previous sensor setting: the queued ones and the one in flight
+static void flush_frames(mp_camera_obj_t *self) {
+    while (esp_camera_available_frames()) {
+        camera_fb_t *fb = esp_camera_fb_get();
+        if (fb) {
+            esp_camera_fb_return(fb);
+        }
+    }
+    camera_fb_t *fb = esp_camera_fb_get();
+    if (fb) {
+        esp_camera_fb_return(fb);
+    }
+}
+
+static bool switch_sensor(mp_camera_obj_t *self, mp_camera_framesize_t frame_size, mp_camera_pixformat_t pixel_format) {
+    sensor_t *sensor = esp_camera_sensor_get();
+    bool watching = self->watcher != NULL;
+    stop_watcher(self);
+    return_all_frames(self);
+    bool switched = true;
+    if (pixel_format != self->camera_config.pixel_format) {
+        switched = sensor->set_pixformat && sensor->set_pixformat(sensor, pixel_format) == 0;
+    }
+    if (switched && frame_size != self->camera_config.frame_size) {
+        switched = sensor->set_framesize && sensor->set_framesize(sensor, frame_size) == 0;
+    }
+    if (switched) {
+        self->camera_config.frame_size = frame_size;
+        self->camera_config.pixel_format = pixel_format;
+        flush_frames(self);
+        self->last_timestamp_us = 0;
+        self->frame_period_us = 0;
+    }
+    if (watching) {
+        start_watcher(self);
+    }
+    return switched;
+}
+
+mp_camera_reconfigure_t mp_camera_hal_reconfigure(mp_camera_obj_t *self, mp_camera_framesize_t frame_size, mp_camera_pixformat_t pixel_format, mp_camera_grabmode_t grab_mode, mp_int_t fb_count) {
     check_init(self);
     ESP_LOGI(TAG, "Reconfiguring camera with frame size: %d, pixel format: %d, grab mode: %d, fb count: %d", (int)frame_size, (int)pixel_format, (int)grab_mode, (int)fb_count);
     
-    // Set frame_size before deinit to ensure it's properly stored in camera_config and the sensor
-    mp_camera_hal_set_frame_size(self, frame_size);
+    int64_t start_us = PERF_NOW();
+
+    if (frame_size > mp_camera_hal_get_max_frame_size(self)) {
+        mp_warning(NULL, "Frame size will be scaled down to maximal frame size supported by the camera sensor");
+        frame_size = mp_camera_hal_get_max_frame_size(self);
+    }
+    mp_int_t new_fb_count = MIN(MAX(fb_count, 1), MICROPY_CAMERA_MAX_FB_COUNT);
+    camera_config_t *config = &self->camera_config;
+    if (frame_size == config->frame_size && pixel_format == config->pixel_format
+        && grab_mode == config->grab_mode && new_fb_count == config->fb_count) {
+        return MP_CAMERA_RECONFIGURE_NONE;
+    }
+    if (sensor_can_switch(self, frame_size, pixel_format, grab_mode, new_fb_count) && switch_sensor(self, frame_size, pixel_format)) {
+        PERF_RECORD(self, switch_sensor, start_us);
+        ESP_LOGI(TAG, "Camera reconfigured by the sensor");
+        return MP_CAMERA_RECONFIGURE_SENSOR;
+    }
+
+    // Validate the new configuration while the running one is still intact
+    check_memory(self, frame_size, pixel_format, new_fb_count);
+
     set_check_pixel_format(self, pixel_format);
     set_check_grab_mode(self, grab_mode);
     set_check_fb_count(self, fb_count);
+    config->frame_size = frame_size;
 
+    bool watching = self->watcher != NULL;
+    stop_watcher(self);
+    return_all_frames(self);
     check_esp_err(esp_camera_deinit());
     self->initialized = false;
+    // The frame rate depends on the configuration, so the period has to be estimated again
+    self->last_timestamp_us = 0;
+    self->frame_period_us = 0;
     self->initialized = init_camera(self);
+    if (watching) {
+        start_watcher(self);
+    }
+    PERF_RECORD(self, reconfigure, start_us);
     ESP_LOGI(TAG, "Camera reconfigured successfully");
+    return MP_CAMERA_RECONFIGURE_RESTART;
 }
 
-mp_obj_t mp_camera_hal_capture(mp_camera_obj_t *self) {
-    check_init(self);
-    if (self->captured_buffer) {
-        esp_camera_fb_return(self->captured_buffer);
-        self->captured_buffer = NULL;
+static bool conversion_supported(mp_camera_pixformat_t src_format, mp_camera_pixformat_t dst_format) {
+    if (src_format == PIXFORMAT_JPEG) {
+        return dst_format == PIXFORMAT_RGB565;
+    }
+    if (dst_format == PIXFORMAT_JPEG) {
+        return camera_jpeg_supported((camera_conv_format_t)src_format);    // Sensors without JPEG support
+    }
+    return camera_conv_supported((camera_conv_format_t)src_format, (camera_conv_format_t)dst_format);
+}
+
+// out has been allocated before the frame was grabbed (see alloc_conversion)
+static mp_obj_t convert_frame(mp_camera_obj_t *self, camera_fb_t *fb, mp_camera_pixformat_t out_format,
+    uint8_t *out, size_t out_len) {
+    int64_t start_us = PERF_NOW();
+    uint16_t width = fb->width;
+    uint16_t height = fb->height;
+    int64_t timestamp_us = fb_timestamp_us(fb);
+    if (out_format == PIXFORMAT_JPEG) {
+        // The output grows while it is encoded from the frame buffer, so give the buffer back if that raises
+        mp_obj_t jpeg;
+        nlr_buf_t nlr;
+        if (nlr_push(&nlr) == 0) {
+            jpeg = mp_camera_frame_new_jpeg(fb->buf, width, height, fb->format, self->camera_config.jpeg_quality,
+                CAMERA_JPEG_SUBSAMPLING_420, timestamp_us, self->sensor_seq);
+            nlr_pop();
+        } else {
+            esp_camera_fb_return(fb);
+            nlr_jump(nlr.ret_val);
+        }
+        esp_camera_fb_return(fb);
+        PERF_RECORD(self, hold, start_us);
+        if (jpeg == MP_OBJ_NULL) {
+            mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("Failed to convert image"));
+        }
+        return jpeg;
+    }
+    bool converted;
+    if (width * height * camera_conv_bytes_per_pixel((camera_conv_format_t)out_format) != out_len) {
+        converted = false;  // The frame does not match the frame size, so it does not fit into out
+    } else if (fb->format == PIXFORMAT_JPEG) {
+        converted = jpg2rgb565(fb->buf, fb->len, out, JPG_SCALE_NONE);
+    } else {
+        converted = camera_conv_convert((camera_conv_format_t)fb->format, fb->buf,
+            (camera_conv_format_t)out_format, out, width * height) == out_len;
+    }
+    // The frame buffer is not needed anymore, so give it back to the driver as soon as possible
+    esp_camera_fb_return(fb);
+    PERF_RECORD(self, hold, start_us);
+    if (!converted) {
+        m_del(uint8_t, out, out_len);
+        mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("Failed to convert image"));
     }
+    return mp_camera_frame_new(NULL, 0, out, out_len, width, height, out_format, timestamp_us, self->sensor_seq);
+}
+
+static int8_t check_out_format(mp_camera_obj_t *self, int8_t out_format) {
+    MP_STATIC_ASSERT((int)PIXFORMAT_RGB555 == (int)CAMERA_CONV_RGB555 && (int)PIXFORMAT_JPEG == (int)CAMERA_CONV_JPEG);
+    if (out_format == self->camera_config.pixel_format) {
+        return -1;
+    }
+    if (out_format >= 0 && !conversion_supported(self->camera_config.pixel_format, out_format)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("Unsupported conversion"));
+    }
+    return out_format;
+}
+
+// Allocates the output of a conversion before the frame is grabbed, so a MemoryError does not keep the frame buffer.
+// Returns NULL, if there is nothing to convert.
+static uint8_t *alloc_conversion(mp_camera_obj_t *self, int8_t out_format, size_t *out_len) {
+    if (out_format < 0 || out_format == PIXFORMAT_JPEG) {
+        *out_len = 0;
+        return NULL;
+    }
+    *out_len = mp_camera_hal_get_pixel_width(self) * mp_camera_hal_get_pixel_height(self)
+        * camera_conv_bytes_per_pixel((camera_conv_format_t)out_format);
+    return m_new(uint8_t, *out_len);
+}
+
+// Frames which are not held are only valid until the next capture.
+// Returns a free slot for the next frame or NULL, if all frame buffers are held.
+static hal_camera_frame_slot_t *recycle_frames(mp_camera_obj_t *self) {
+    hal_camera_frame_slot_t *slot = NULL;
+    int held = 0;
+    for (size_t i = 0; i < MICROPY_CAMERA_MAX_FB_COUNT; i++) {
+        if (self->frames[i].fb && !self->frames[i].held) {
+            return_frame(self, &self->frames[i]);
+        }
+        if (self->frames[i].fb) {
+            held++;
+        } else if (!slot) {
+            slot = &self->frames[i];
+        }
+    }
+    return held < self->camera_config.fb_count ? slot : NULL;
+}
+
+// Number of frames handed out, held or not
+static int frames_handed_out(mp_camera_obj_t *self) {
+    int count = 0;
+    for (size_t i = 0; i < MICROPY_CAMERA_MAX_FB_COUNT; i++) {
+        if (self->frames[i].fb) {
+            count++;
+        }
+    }
+    return count;
+}
+
+static hal_camera_frame_slot_t *get_free_slot(mp_camera_obj_t *self) {
+    hal_camera_frame_slot_t *slot = recycle_frames(self);
+    if (!slot) {
+        mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("All frame buffers are held. Release a frame first"));
+    }
+    return slot;
+}
+
+static mp_obj_t hand_out_frame(mp_camera_obj_t *self, hal_camera_frame_slot_t *slot, camera_fb_t *fb, bool hold) {
+    slot->fb = fb;
+    slot->seq = ++self->frame_seq;
+    slot->held = hold;
+    slot->handed_out_us = PERF_NOW();
+    return mp_camera_frame_new(self, slot->seq, fb->buf, fb->len, fb->width, fb->height, fb->format,
+        fb_timestamp_us(fb), self->sensor_seq);
+}
+
+mp_obj_t mp_camera_hal_capture(mp_camera_obj_t *self, int8_t out_format, bool hold) {
+    check_init(self);
+    out_format = check_out_format(self, out_format);
+    hal_camera_frame_slot_t *slot = get_free_slot(self);
+    size_t out_len;
+    uint8_t *out = alloc_conversion(self, out_format, &out_len);
     
     ESP_LOGI(TAG, "Capturing image");
-    self->captured_buffer = esp_camera_fb_get();
-    if (!self->captured_buffer) {
+    camera_fb_t *fb = grab_frame(self);
+    if (!fb) {
         ESP_LOGE(TAG, "Failed to capture image");
+        m_del(uint8_t, out, out_len);
         return mp_const_none;
     }
-    return mp_obj_new_memoryview('b', self->captured_buffer->len, self->captured_buffer->buf);
+    if (out_format >= 0) {
+        return convert_frame(self, fb, out_format, out, out_len);
+    }
+    return hand_out_frame(self, slot, fb, hold);
+}
+
+void mp_camera_hal_set_frame_callback(mp_camera_obj_t *self, mp_obj_t dispatch) {
+    stop_watcher(self);
+    self->dispatch = dispatch;
+    if (dispatch != MP_OBJ_NULL) {
+        check_init(self);
+        start_watcher(self);
+    }
+}
 
+mp_obj_t mp_camera_hal_take_ready_frame(mp_camera_obj_t *self) {
+    portENTER_CRITICAL(&self->ready_lock);
+    self->dispatch_pending = false;
+    portEXIT_CRITICAL(&self->ready_lock);
+    if (!self->initialized || !self->ready_fb) {
+        return mp_const_none;
+    }
+    hal_camera_frame_slot_t *slot = recycle_frames(self);
+    if (!slot) {
+        return mp_const_none;   // Leave the ready frame for the next capture
+    }
+    camera_fb_t *fb = take_ready_fb(self);
+    if (!fb) {
+        return mp_const_none;
+    }
+    if (frame_is_stale(self, fb)) {
+        esp_camera_fb_return(fb);   // The watcher grabs the next one
+        return mp_const_none;
+    }
+    PERF_COUNT(self, captures);
+    account_frame(self, fb);
+    apply_pending_settings(self);
+    return hand_out_frame(self, slot, fb, false);
+}
+
+mp_obj_t mp_camera_hal_capture_into(mp_camera_obj_t *self, uint8_t *buf, size_t len, int8_t out_format) {
+    check_init(self);
+    out_format = check_out_format(self, out_format);
+    get_free_slot(self);
+
+    camera_fb_t *fb = grab_frame(self);
+    if (!fb) {
+        ESP_LOGE(TAG, "Failed to capture image");
+        return mp_const_none;
+    }
+    int64_t start_us = PERF_NOW();
+    if (out_format == PIXFORMAT_JPEG) {
+        // The length is only known after encoding, the encoder stops when buf is full
+        size_t out_len = camera_jpeg_encode((camera_conv_format_t)fb->format, fb->buf, fb->width, fb->height,
+            self->camera_config.jpeg_quality, CAMERA_JPEG_SUBSAMPLING_420, buf, len, NULL, NULL);
+        esp_camera_fb_return(fb);
+        PERF_RECORD(self, hold, start_us);
+        if (out_len == 0) {
+            mp_raise_ValueError(MP_ERROR_TEXT("Buffer too small"));
+        }
+        return mp_obj_new_int_from_uint(out_len);
+    }
+    size_t out_len = out_format >= 0
+        ? fb->width * fb->height * camera_conv_bytes_per_pixel((camera_conv_format_t)out_format)
+        : fb->len;
+    if (out_len > len) {
+        esp_camera_fb_return(fb);
+        mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("Buffer too small, %u bytes needed"), (unsigned int)out_len);
+    }
+    bool copied = true;
+    if (out_format < 0) {
+        memcpy(buf, fb->buf, out_len);
+    } else if (fb->format == PIXFORMAT_JPEG) {
+        copied = jpg2rgb565(fb->buf, fb->len, buf, JPG_SCALE_NONE);
+    } else {
+        copied = camera_conv_convert((camera_conv_format_t)fb->format, fb->buf,
+            (camera_conv_format_t)out_format, buf, fb->width * fb->height) == out_len;
+    }
+    // Give the frame buffer back right away, so the driver can fill it with the next frame
+    esp_camera_fb_return(fb);
+    PERF_RECORD(self, hold, start_us);
+    if (!copied) {
+        mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("Failed to convert image"));
+    }
+    return mp_obj_new_int_from_uint(out_len);
 }
 
 mp_obj_t mp_camera_hal_frame_available(mp_camera_obj_t *self) {
@@ -226,14 +768,56 @@ mp_obj_t mp_camera_hal_frame_available(mp_camera_obj_t *self) {
     return mp_obj_new_bool(esp_camera_available_frames());
 }
 
+bool mp_camera_hal_frame_ready(mp_camera_obj_t *self) {
+    check_init(self);
+    // Polling must not invalidate frames which are still in use, so count the handed out frames instead of recycling
+    // them. If they occupy all frame buffers, the driver cannot capture. Report ready then, capture recycles the frames
+    // which are not held, or raises if all are held.
+    return frames_handed_out(self) >= self->camera_config.fb_count || self->ready_fb || esp_camera_available_frames() > 0;
+}
+
 bool mp_camera_hal_initialized(mp_camera_obj_t *self){
     return self->initialized;
 }
 
 void mp_camera_hal_free_buffer(mp_camera_obj_t *self) {
-    if (self->captured_buffer) {
-        esp_camera_fb_return(self->captured_buffer);
-        self->captured_buffer = NULL;
+    return_all_frames(self);
+}
+
+bool mp_camera_hal_frame_valid(mp_camera_obj_t *self, uint32_t seq) {
+    return find_frame(self, seq) != NULL;
+}
+
+void mp_camera_hal_get_frame_stats(mp_camera_obj_t *self, mp_camera_frame_stats_t *stats, bool reset) {
+    portENTER_CRITICAL(&self->ready_lock);
+    stats->overwritten = self->coalesced;
+    if (reset) {
+        self->coalesced = 0;
+    }
+    portEXIT_CRITICAL(&self->ready_lock);
+    stats->captured = self->captured;
+    stats->dropped = self->dropped;
+    stats->frame_period_us = self->frame_period_us;
+    stats->sequence = self->sensor_seq;
+    if (reset) {
+        self->captured = 0;
+        self->dropped = 0;
+    }
+}
+
+void mp_camera_hal_get_perf(mp_camera_obj_t *self, mp_camera_perf_t *perf, bool reset) {
+    *perf = self->perf;
+    perf->elapsed_us = esp_timer_get_time() - self->perf.since_us;
+    if (reset) {
+        memset(&self->perf, 0, sizeof(self->perf));
+        self->perf.since_us = PERF_NOW();
+    }
+}
+
+void mp_camera_hal_release_frame(mp_camera_obj_t *self, uint32_t seq) {
+    hal_camera_frame_slot_t *slot = find_frame(self, seq);
+    if (slot) {
+        return_frame(self, slot);
     }
 }
 
@@ -345,30 +929,10 @@ SENSOR_STATUS_GETSET(bool, wpc, wpc, set_wpc);
 SENSOR_STATUS_GETSET(bool, raw_gma, raw_gma, set_raw_gma);
 SENSOR_STATUS_GETSET(bool, lenc, lenc, set_lenc);
 
+// Reuses the frame buffers where possible, e.g. to switch between preview and snapshot resolution
 void mp_camera_hal_set_frame_size(mp_camera_obj_t * self, framesize_t value) {
     check_init(self);
-    sensor_t *sensor = esp_camera_sensor_get();
-    if (!sensor->set_framesize) {
-        mp_raise_ValueError(MP_ERROR_TEXT("No attribute frame_size"));
-    }
-
-    // Validate against sensor's maximum frame size
-    camera_sensor_info_t *sensor_info = esp_camera_sensor_get_info(&sensor->id);
-    if (value > sensor_info->max_size) {
-        mp_warning(NULL, "Frame size will be scaled down to maximal frame size supported by the camera sensor");
-        value = sensor_info->max_size;
-    }
-
-    if (self->captured_buffer) {
-        esp_camera_return_all();
-        self->captured_buffer = NULL;
-    }
-
-    if (sensor->set_framesize(sensor, value) < 0) {
-        mp_raise_ValueError(MP_ERROR_TEXT("Invalid setting for frame_size"));
-    } else {
-        self->camera_config.frame_size = value;
-    }
+    mp_camera_hal_reconfigure(self, value, self->camera_config.pixel_format, self->camera_config.grab_mode, self->camera_config.fb_count);
 }
 
 int mp_camera_hal_get_quality(mp_camera_obj_t * self) {
@@ -380,7 +944,12 @@ void mp_camera_hal_set_quality(mp_camera_obj_t * self, int value) {
     check_init(self);
     sensor_t *sensor = esp_camera_sensor_get();
     if (!sensor->set_quality) {
-        mp_raise_ValueError(MP_ERROR_TEXT("No attribute quality"));
+        // Sensors without JPEG support: the quality is only used by the software encoder
+        if (value < 0 || value > 100) {
+            mp_raise_ValueError(MP_ERROR_TEXT("Invalid setting for quality"));
+        }
+        self->camera_config.jpeg_quality = value;
+        return;
     }
     if (sensor->set_quality(sensor, get_mapped_jpeg_quality(value)) < 0) {
         mp_raise_ValueError(MP_ERROR_TEXT("Invalid setting for quality"));
@@ -389,6 +958,160 @@ void mp_camera_hal_set_quality(mp_camera_obj_t * self, int value) {
     }
 }
 
+// Sensor settings which can be applied as a batch: setting, setter and status field of the sensor, valid range.
+// The ranges are the widest ones of the supported sensors, the sensor driver rejects values outside its own range.
+#define SENSOR_SETTINGS(X) \
+    X(EXPOSURE_CTRL,  exposure_ctrl,  set_exposure_ctrl,  aec,            0, 1) \
+    X(AEC2,           aec2,           set_aec2,           aec2,           0, 1) \
+    X(GAIN_CTRL,      gain_ctrl,      set_gain_ctrl,      agc,            0, 1) \
+    X(WHITEBAL,       whitebal,       set_whitebal,       awb,            0, 1) \
+    X(AWB_GAIN,       awb_gain,       set_awb_gain,       awb_gain,       0, 1) \
+    X(AEC_VALUE,      aec_value,      set_aec_value,      aec_value,      0, 1200) \
+    X(AE_LEVEL,       ae_level,       set_ae_level,       ae_level,       -3, 3) \
+    X(AGC_GAIN,       agc_gain,       set_agc_gain,       agc_gain,       0, 30) \
+    X(GAINCEILING,    gainceiling,    set_gainceiling,    gainceiling,    0, 6) \
+    X(WB_MODE,        wb_mode,        set_wb_mode,        wb_mode,        0, 4) \
+    X(CONTRAST,       contrast,       set_contrast,       contrast,       -3, 3) \
+    X(BRIGHTNESS,     brightness,     set_brightness,     brightness,     -3, 3) \
+    X(SATURATION,     saturation,     set_saturation,     saturation,     -4, 4) \
+    X(SHARPNESS,      sharpness,      set_sharpness,      sharpness,      -3, 3) \
+    X(DENOISE,        denoise,        set_denoise,        denoise,        0, 8) \
+    X(QUALITY,        quality,        set_quality,        quality,        0, 100) \
+    X(SPECIAL_EFFECT, special_effect, set_special_effect, special_effect, 0, 6) \
+    X(COLORBAR,       colorbar,       set_colorbar,       colorbar,       0, 1) \
+    X(HMIRROR,        hmirror,        set_hmirror,        hmirror,        0, 1) \
+    X(VFLIP,          vflip,          set_vflip,          vflip,          0, 1) \
+    X(DCW,            dcw,            set_dcw,            dcw,            0, 1) \
+    X(BPC,            bpc,            set_bpc,            bpc,            0, 1) \
+    X(WPC,            wpc,            set_wpc,            wpc,            0, 1) \
+    X(RAW_GMA,        raw_gma,        set_raw_gma,        raw_gma,        0, 1) \
+    X(LENC,           lenc,           set_lenc,           lenc,           0, 1)
+
+static const struct {
+    const char  *name;
+    int16_t     min;
+    int16_t     max;
+} sensor_settings[MP_CAMERA_SETTING_COUNT] = {
+    #define SETTING_INFO(id, name, setter, field, min, max) [MP_CAMERA_SETTING_##id] = { #name, min, max },
+    SENSOR_SETTINGS(SETTING_INFO)
+    #undef SETTING_INFO
+};
+
+static bool setting_supported(sensor_t *sensor, mp_camera_setting_t setting) {
+    switch (setting) {
+        #define SETTING_SUPPORTED(id, name, setter, field, min, max) case MP_CAMERA_SETTING_##id: return sensor->setter != NULL;
+        SENSOR_SETTINGS(SETTING_SUPPORTED)
+        #undef SETTING_SUPPORTED
+        default:
+            return false;
+    }
+}
+
+// Reads the value cached by the sensor driver, this does not access the sensor
+static int setting_read(mp_camera_obj_t *self, sensor_t *sensor, mp_camera_setting_t setting) {
+    if (setting == MP_CAMERA_SETTING_QUALITY) {
+        return self->camera_config.jpeg_quality;    // The sensor has the mapped value
+    }
+    switch (setting) {
+        #define SETTING_READ(id, name, setter, field, min, max) case MP_CAMERA_SETTING_##id: return sensor->status.field;
+        SENSOR_SETTINGS(SETTING_READ)
+        #undef SETTING_READ
+        default:
+            return 0;
+    }
+}
+
+static bool setting_write(mp_camera_obj_t *self, sensor_t *sensor, mp_camera_setting_t setting, int value) {
+    if (setting == MP_CAMERA_SETTING_QUALITY) {
+        if (sensor->set_quality(sensor, get_mapped_jpeg_quality(value)) < 0) {
+            return false;
+        }
+        self->camera_config.jpeg_quality = value;
+        return true;
+    }
+    switch (setting) {
+        #define SETTING_WRITE(id, name, setter, field, min, max) case MP_CAMERA_SETTING_##id: return sensor->setter(sensor, value) >= 0;
+        SENSOR_SETTINGS(SETTING_WRITE)
+        #undef SETTING_WRITE
+        default:
+            return false;
+    }
+}
+
+// Writes the settings which differ from the current ones in one pass and verifies them afterwards
+static uint32_t write_settings(mp_camera_obj_t *self, const mp_camera_settings_t *settings) {
+    sensor_t *sensor = esp_camera_sensor_get();
+    uint32_t failed = 0;
+    for (size_t i = 0; i < MP_CAMERA_SETTING_COUNT; i++) {
+        if ((settings->mask & (1u << i)) && setting_read(self, sensor, i) != settings->value[i]
+            && !setting_write(self, sensor, i, settings->value[i])) {
+            failed |= 1u << i;
+        }
+    }
+    for (size_t i = 0; i < MP_CAMERA_SETTING_COUNT; i++) {
+        if ((settings->mask & (1u << i)) && setting_read(self, sensor, i) != settings->value[i]) {
+            failed |= 1u << i;
+        }
+    }
+    return failed;
+}
+
+static void apply_pending_settings(mp_camera_obj_t *self) {
+    if (!self->pending_settings.mask) {
+        return;
+    }
+    uint32_t failed = write_settings(self, &self->pending_settings);
+    self->pending_settings.mask = 0;
+    // The driver stamps frames when they start, the one in flight was partly exposed with the old settings
+    self->settings_since_us = esp_timer_get_time();
+    for (size_t i = 0; i < MP_CAMERA_SETTING_COUNT; i++) {
+        if (failed & (1u << i)) {
+            mp_warning(NULL, "Failed to set %s", sensor_settings[i].name);
+        }
+    }
+}
+
+void mp_camera_hal_get_settings(mp_camera_obj_t *self, mp_camera_settings_t *settings) {
+    check_init(self);
+    sensor_t *sensor = esp_camera_sensor_get();
+    settings->mask = 0;
+    for (size_t i = 0; i < MP_CAMERA_SETTING_COUNT; i++) {
+        settings->value[i] = 0;
+        if (setting_supported(sensor, i)) {
+            settings->value[i] = setting_read(self, sensor, i);
+            settings->mask |= 1u << i;
+        }
+    }
+}
+
+uint32_t mp_camera_hal_apply_settings(mp_camera_obj_t *self, const mp_camera_settings_t *settings, bool deferred) {
+    check_init(self);
+    sensor_t *sensor = esp_camera_sensor_get();
+    for (size_t i = 0; i < MP_CAMERA_SETTING_COUNT; i++) {
+        if (!(settings->mask & (1u << i))) {
+            continue;
+        }
+        if (!setting_supported(sensor, i)) {
+            mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("No attribute %s"), sensor_settings[i].name);
+        }
+        if (settings->value[i] < sensor_settings[i].min || settings->value[i] > sensor_settings[i].max) {
+            mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("%s must be between %d and %d"),
+                sensor_settings[i].name, sensor_settings[i].min, sensor_settings[i].max);
+        }
+    }
+    if (!deferred) {
+        return write_settings(self, settings);
+    }
+    // Later batches override the values of earlier ones which are still pending
+    for (size_t i = 0; i < MP_CAMERA_SETTING_COUNT; i++) {
+        if (settings->mask & (1u << i)) {
+            self->pending_settings.value[i] = settings->value[i];
+        }
+    }
+    self->pending_settings.mask |= settings->mask;
+    return 0;
+}
+
 mp_camera_pixformat_t mp_camera_hal_get_pixel_format(mp_camera_obj_t *self) {
     return self->camera_config.pixel_format;
 }
@@ -403,30 +1126,27 @@ int mp_camera_hal_get_fb_count(mp_camera_obj_t *self) {
 
 const char *mp_camera_hal_get_sensor_name(mp_camera_obj_t *self) {
     check_init(self);
-    sensor_t *sensor = esp_camera_sensor_get();
-    camera_sensor_info_t *sensor_info = esp_camera_sensor_get_info(&sensor->id);
-    return sensor_info->name;
+    return self->sensor_info->name;
 }
 
 bool mp_camera_hal_get_supports_jpeg(mp_camera_obj_t *self) {
     check_init(self);
-    sensor_t *sensor = esp_camera_sensor_get();
-    camera_sensor_info_t *sensor_info = esp_camera_sensor_get_info(&sensor->id);
-    return sensor_info->support_jpeg;
+    return self->sensor_info->support_jpeg;
 }
 
 mp_camera_framesize_t mp_camera_hal_get_max_frame_size(mp_camera_obj_t *self) {
     check_init(self);
-    sensor_t *sensor = esp_camera_sensor_get();
-    camera_sensor_info_t *sensor_info = esp_camera_sensor_get_info(&sensor->id);
-    return sensor_info->max_size;
+    return self->sensor_info->max_size;
 }
 
 int mp_camera_hal_get_address(mp_camera_obj_t *self) {
     check_init(self);
-    sensor_t *sensor = esp_camera_sensor_get();
-    camera_sensor_info_t *sensor_info = esp_camera_sensor_get_info(&sensor->id);
-    return sensor_info->sccb_addr;
+    return self->sensor_info->sccb_addr;
+}
+
+int mp_camera_hal_get_sensor_id(mp_camera_obj_t *self) {
+    check_init(self);
+    return self->sensor_info->pid;
 }
 
 int mp_camera_hal_get_pixel_width(mp_camera_obj_t *self) {
@@ -37,9 +37,94 @@
 #include "py/runtime.h"
 #include "py/obj.h"
 
+// Performance counters of the HAL (see mp_camera_hal_get_perf). They cost a timer read and a few additions per
+// frame, so they are enabled by default.
+#ifndef MICROPY_CAMERA_PERF
+#define MICROPY_CAMERA_PERF (1)
+#endif
+
+// Upper bounds of the histogram buckets in microseconds, the last bucket takes everything above
+#define MICROPY_CAMERA_PERF_BUCKETS (10)
+#define MICROPY_CAMERA_PERF_BUCKET_BOUNDS_US { 250, 1000, 5000, 10000, 20000, 50000, 100000, 500000, 1000000 }
+
+/**
+ * @brief Duration histogram with fixed buckets.
+ */
+typedef struct mp_camera_perf_hist {
+    uint32_t    count;
+    uint32_t    max_us;
+    uint64_t    total_us;
+    uint32_t    buckets[MICROPY_CAMERA_PERF_BUCKETS];
+} mp_camera_perf_hist_t;
+
+/**
+ * @brief Performance counters of a camera since the last reset.
+ */
+typedef struct mp_camera_perf {
+    int64_t                 since_us;       // Time of the last reset
+    int64_t                 elapsed_us;     // Time since the last reset, set by mp_camera_hal_get_perf
+    uint32_t                captures;       // Capture calls (capture, capture_into, frame callback)
+    uint32_t                failed;         // Captures which did not get a frame from the driver
+    mp_camera_perf_hist_t   fb_get;         // Time blocked waiting for the driver to deliver a frame
+    mp_camera_perf_hist_t   hold;           // Time from handing a frame buffer out until it is returned to the driver
+    mp_camera_perf_hist_t   init;           // Duration of init
+    mp_camera_perf_hist_t   reconfigure;    // Duration of reconfigurations which restarted the driver
+    mp_camera_perf_hist_t   switch_sensor;  // Duration of reconfigurations applied by the sensor alone
+} mp_camera_perf_t;
+
+/**
+ * @brief Adds a duration to a histogram.
+ */
+extern void mp_camera_perf_record(mp_camera_perf_hist_t *hist, int64_t duration_us);
+
+/**
+ * @brief Sensor settings which can be applied as a batch (see mp_camera_hal_apply_settings).
+ * @details Batches are written in this order, so the automatic controls are switched before their manual values.
+ * The values are part of the snapshot format (see camera.snapshot), so new settings are only added at the end.
+ */
+typedef enum {
+    MP_CAMERA_SETTING_EXPOSURE_CTRL,
+    MP_CAMERA_SETTING_AEC2,
+    MP_CAMERA_SETTING_GAIN_CTRL,
+    MP_CAMERA_SETTING_WHITEBAL,
+    MP_CAMERA_SETTING_AWB_GAIN,
+    MP_CAMERA_SETTING_AEC_VALUE,
+    MP_CAMERA_SETTING_AE_LEVEL,
+    MP_CAMERA_SETTING_AGC_GAIN,
+    MP_CAMERA_SETTING_GAINCEILING,
+    MP_CAMERA_SETTING_WB_MODE,
+    MP_CAMERA_SETTING_CONTRAST,
+    MP_CAMERA_SETTING_BRIGHTNESS,
+    MP_CAMERA_SETTING_SATURATION,
+    MP_CAMERA_SETTING_SHARPNESS,
+    MP_CAMERA_SETTING_DENOISE,
+    MP_CAMERA_SETTING_QUALITY,
+    MP_CAMERA_SETTING_SPECIAL_EFFECT,
+    MP_CAMERA_SETTING_COLORBAR,
+    MP_CAMERA_SETTING_HMIRROR,
+    MP_CAMERA_SETTING_VFLIP,
+    MP_CAMERA_SETTING_DCW,
+    MP_CAMERA_SETTING_BPC,
+    MP_CAMERA_SETTING_WPC,
+    MP_CAMERA_SETTING_RAW_GMA,
+    MP_CAMERA_SETTING_LENC,
+    MP_CAMERA_SETTING_COUNT
+} mp_camera_setting_t;
+
+/**
+ * @brief A batch of sensor settings. Only the settings with their bit (1 << setting) set in mask are applied.
+ */
+typedef struct mp_camera_settings {
+    uint32_t    mask;
+    int32_t     value[MP_CAMERA_SETTING_COUNT];
+} mp_camera_settings_t;
+
 #if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2 || CONFIG_IDF_TARGET_ESP32S3
 // ESP32-Camera specifics-> could go in separate header file, if this project starts implementing more ports.
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_camera.h"
 #include "sensor.h"
 #include "camera_pins.h"
@@ -74,6 +159,16 @@ defined (MICROPY_CAMERA_PIN_PCLK) && defined (MICROPY_CAMERA_PIN_VSYNC) && defin
 #define MICROPY_CAMERA_FB_COUNT     (1)
 #endif
 
+// Upper bound of the frame buffer table. The usable fb_count is limited by the PSRAM budget (see mp_camera_hal_plan_memory)
+#ifndef MICROPY_CAMERA_MAX_FB_COUNT
+#define MICROPY_CAMERA_MAX_FB_COUNT (8)
+#endif
+
+// PSRAM which shall stay free after the frame buffers have been allocated
+#ifndef MICROPY_CAMERA_PSRAM_RESERVE
+#define MICROPY_CAMERA_PSRAM_RESERVE (32 * 1024)
+#endif
+
 #ifndef MICROPY_CAMERA_DEFAULT_FRAME_SIZE
 #define MICROPY_CAMERA_DEFAULT_FRAME_SIZE FRAMESIZE_QQVGA
 #endif
@@ -91,14 +186,224 @@ typedef framesize_t  hal_camera_framesize_t;
 typedef camera_grab_mode_t hal_camera_grabmode_t;
 typedef gainceiling_t hal_camera_gainceiling_t;
 
+// Frame buffer handed out to the user
+typedef struct hal_camera_frame_slot {
+    camera_fb_t         *fb;                // NULL if the slot is free
+    uint32_t            seq;                // Sequence number of the frame object pointing to fb
+    bool                held;               // Held frames are not returned by the next capture
+    int64_t             handed_out_us;      // Time the frame buffer was handed out (for the hold time)
+} hal_camera_frame_slot_t;
+
 typedef struct hal_camera_obj {
     mp_obj_base_t       base;
     camera_config_t     camera_config;
     bool                initialized;
-    camera_fb_t         *captured_buffer;
+    hal_camera_frame_slot_t frames[MICROPY_CAMERA_MAX_FB_COUNT];
+    uint32_t            frame_seq;          // Sequence number of the last frame handed out
+    size_t              fb_alloc_size;      // Size of each frame buffer allocated by the driver
+    const camera_sensor_info_t *sensor_info; // Capabilities of the sensor, looked up at init
+    // Frame watcher (see mp_camera_hal_set_frame_callback)
+    TaskHandle_t        watcher;            // Task grabbing frames in the background, NULL if not watching
+    SemaphoreHandle_t   watcher_done;       // Given by the watcher task when it exits
+    volatile bool       watching;
+    mp_obj_t            dispatch;           // Scheduled with the camera as argument when a frame is ready
+    bool                dispatch_pending;
+    camera_fb_t         *ready_fb;          // Latest frame grabbed by the watcher, not yet handed out
+    uint32_t            coalesced;          // Ready frames replaced by a newer one before they were handed out
+    portMUX_TYPE        ready_lock;
+    // Frame accounting (see mp_camera_hal_get_frame_stats)
+    uint32_t            sensor_seq;         // Estimated sensor frame number of the last grabbed frame
+    int64_t             last_timestamp_us;  // Timestamp of the last grabbed frame, 0 if none since (re)configuration
+    uint32_t            frame_period_us;    // Estimated sensor frame period, 0 if unknown
+    uint32_t            captured;
+    uint32_t            dropped;
+    mp_camera_perf_t    perf;
+    // Sensor settings (see mp_camera_hal_apply_settings)
+    mp_camera_settings_t pending_settings;  // Batch applied at the next frame boundary
+    int64_t             settings_since_us;  // Frames started before this time were exposed with older settings
+} hal_camera_obj_t;
+
+#elif MICROPY_CAMERA_HOST
+// Host build (e.g. unix port) with a synthetic sensor, see modcamera_host.c.
+// The enums mirror the esp32-camera driver, since their values are the values of the API.
+
+#if MICROPY_PY_THREAD
+#include <pthread.h>
+#endif
+
+#include "camera_replay.h"
+
+typedef enum {
+    PIXFORMAT_RGB565,
+    PIXFORMAT_YUV422,
+    PIXFORMAT_YUV420,
+    PIXFORMAT_GRAYSCALE,
+    PIXFORMAT_JPEG,
+    PIXFORMAT_RGB888,
+    PIXFORMAT_RAW,
+    PIXFORMAT_RGB444,
+    PIXFORMAT_RGB555,
+} pixformat_t;
+
+typedef enum {
+    FRAMESIZE_96X96,
+    FRAMESIZE_QQVGA,
+    FRAMESIZE_128X128,
+    FRAMESIZE_QCIF,
+    FRAMESIZE_HQVGA,
+    FRAMESIZE_240X240,
+    FRAMESIZE_QVGA,
+    FRAMESIZE_320X320,
+    FRAMESIZE_CIF,
+    FRAMESIZE_HVGA,
+    FRAMESIZE_VGA,
+    FRAMESIZE_SVGA,
+    FRAMESIZE_XGA,
+    FRAMESIZE_HD,
+    FRAMESIZE_SXGA,
+    FRAMESIZE_UXGA,
+    FRAMESIZE_FHD,
+    FRAMESIZE_P_HD,
+    FRAMESIZE_P_3MP,
+    FRAMESIZE_QXGA,
+    FRAMESIZE_QHD,
+    FRAMESIZE_WQXGA,
+    FRAMESIZE_P_FHD,
+    FRAMESIZE_QSXGA,
+    FRAMESIZE_INVALID
+} framesize_t;
+
+typedef enum {
+    CAMERA_GRAB_WHEN_EMPTY,
+    CAMERA_GRAB_LATEST
+} camera_grab_mode_t;
+
+typedef enum {
+    GAINCEILING_2X,
+    GAINCEILING_4X,
+    GAINCEILING_8X,
+    GAINCEILING_16X,
+    GAINCEILING_32X,
+    GAINCEILING_64X,
+    GAINCEILING_128X,
+} gainceiling_t;
+
+// The synthetic sensor has no pins, the defaults only satisfy the constructor
+#define MICROPY_CAMERA_ALL_REQ_PINS_DEFINED (1)
+#define MICROPY_CAMERA_PIN_D0       (0)
+#define MICROPY_CAMERA_PIN_D1       (0)
+#define MICROPY_CAMERA_PIN_D2       (0)
+#define MICROPY_CAMERA_PIN_D3       (0)
+#define MICROPY_CAMERA_PIN_D4       (0)
+#define MICROPY_CAMERA_PIN_D5       (0)
+#define MICROPY_CAMERA_PIN_D6       (0)
+#define MICROPY_CAMERA_PIN_D7       (0)
+#define MICROPY_CAMERA_PIN_PCLK     (-1)
+#define MICROPY_CAMERA_PIN_VSYNC    (-1)
+#define MICROPY_CAMERA_PIN_HREF     (-1)
+#define MICROPY_CAMERA_PIN_SIOD     (-1)
+#define MICROPY_CAMERA_PIN_SIOC     (-1)
+#define MICROPY_CAMERA_PIN_XCLK     (-1)
+#define MICROPY_CAMERA_PIN_PWDN     (-1)
+#define MICROPY_CAMERA_PIN_RESET    (-1)
+#define MICROPY_CAMERA_XCLK_FREQ    (20)
+#define MICROPY_CAMERA_GRAB_MODE    CAMERA_GRAB_LATEST
+#define MICROPY_CAMERA_FB_COUNT     (2)
+#define MICROPY_CAMERA_MAX_FB_COUNT (8)
+
+#ifndef MICROPY_CAMERA_DEFAULT_FRAME_SIZE
+#define MICROPY_CAMERA_DEFAULT_FRAME_SIZE FRAMESIZE_QQVGA
+#endif
+
+#ifndef MICROPY_CAMERA_DEFAULT_PIXEL_FORMAT
+#define MICROPY_CAMERA_DEFAULT_PIXEL_FORMAT PIXFORMAT_RGB565
+#endif
+
+#ifndef MICROPY_CAMERA_JPEG_QUALITY
+#define MICROPY_CAMERA_JPEG_QUALITY (85)
+#endif
+
+// Frame rate of the synthetic sensor, can be overridden with the environment variable MICROPY_CAMERA_FPS.
+// 0 delivers frames as fast as they can be rendered. Replays (environment variable MICROPY_CAMERA_REPLAY)
+// keep the timing of the recording, unless the frame rate is 0.
+#ifndef MICROPY_CAMERA_HOST_FPS
+#define MICROPY_CAMERA_HOST_FPS (30)
+#endif
+
+// Memory available for frame buffers (see mp_camera_hal_plan_memory)
+#ifndef MICROPY_CAMERA_HOST_FB_MEMORY
+#define MICROPY_CAMERA_HOST_FB_MEMORY (64 * 1024 * 1024)
+#endif
+
+typedef pixformat_t  hal_camera_pixformat_t;
+typedef framesize_t  hal_camera_framesize_t;
+typedef camera_grab_mode_t hal_camera_grabmode_t;
+typedef gainceiling_t hal_camera_gainceiling_t;
+
+typedef struct hal_camera_config {
+    pixformat_t         pixel_format;
+    framesize_t         frame_size;
+    int                 jpeg_quality;       // API quality (0..100)
+    int                 fb_count;
+    camera_grab_mode_t  grab_mode;
+} hal_camera_config_t;
+
+// Frame buffer of the synthetic sensor (counterpart of camera_fb_t)
+typedef struct hal_camera_fb {
+    uint8_t             *buf;               // malloc'ed at init outside of the GC heap, or into the replayed recording
+    size_t              len;
+    uint16_t            width;
+    uint16_t            height;
+    pixformat_t         format;
+    int64_t             timestamp_us;       // Start of the frame
+    uint32_t            sensor_seq;         // Sensor frame number
+    bool                in_use;             // Taken from the sensor and not returned yet
+} hal_camera_fb_t;
+
+typedef struct hal_camera_frame_slot {
+    hal_camera_fb_t     *fb;                // NULL if the slot is free
+    uint32_t            seq;
+    bool                held;
+    int64_t             handed_out_us;
+} hal_camera_frame_slot_t;
+
+typedef struct hal_camera_obj {
+    mp_obj_base_t       base;
+    hal_camera_config_t camera_config;
+    bool                initialized;
+    hal_camera_frame_slot_t frames[MICROPY_CAMERA_MAX_FB_COUNT];
+    uint32_t            frame_seq;
+    size_t              fb_alloc_size;
+    // Synthetic sensor
+    hal_camera_fb_t     fbs[MICROPY_CAMERA_MAX_FB_COUNT];
+    uint32_t            sensor_period_us;   // Configured frame period, 0 if frames are rendered on demand
+    int64_t             sensor_start_us;    // Start of sensor frame 0
+    uint32_t            next_frame;         // Oldest sensor frame which has not been delivered yet
+    int32_t             settings[MP_CAMERA_SETTING_COUNT];
+    camera_replay_t     replay;             // Recording replayed instead of the synthetic scene
+    bool                replaying;
+    // Frame watcher (see mp_camera_hal_set_frame_callback)
+    #if MICROPY_PY_THREAD
+    pthread_t           watcher;
+    #endif
+    bool                has_watcher;
+    volatile bool       watching;
+    mp_obj_t            dispatch;
+    bool                dispatch_pending;
+    hal_camera_fb_t     *ready_fb;
+    uint32_t            coalesced;
+    // Frame accounting (see mp_camera_hal_get_frame_stats)
+    uint32_t            sensor_seq;
+    bool                has_frame;          // A frame was grabbed since the last (re)configuration
+    uint32_t            captured;
+    uint32_t            dropped;
+    mp_camera_perf_t    perf;
+    // Sensor settings (see mp_camera_hal_apply_settings)
+    mp_camera_settings_t pending_settings;
+    int64_t             settings_since_us;
 } hal_camera_obj_t;
 
-#endif // CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2 || CONFIG_IDF_TARGET_ESP32S3
+#endif // CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2 || CONFIG_IDF_TARGET_ESP32S3 / MICROPY_CAMERA_HOST
 
 typedef hal_camera_obj_t mp_camera_obj_t;
 
@@ -107,6 +412,183 @@ typedef hal_camera_framesize_t  mp_camera_framesize_t;
 typedef hal_camera_grabmode_t mp_camera_grabmode_t;
 typedef hal_camera_gainceiling_t mp_camera_gainceiling_t;
 
+/**
+ * @brief Frame object returned by capture.
+ * @details Frames of a camera point into a driver frame buffer and stay valid until they are released,
+ * the HAL recycles the buffer (e.g. next capture or free_buffer) or the camera is deinitialized.
+ * Frames without camera own their (GC allocated) buffer, e.g. after a pixel format conversion.
+ * A released frame has buf == NULL.
+ */
+typedef struct mp_camera_frame_obj {
+    mp_obj_base_t           base;
+    mp_camera_obj_t         *camera;
+    uint32_t                seq;
+    uint8_t                 *buf;
+    size_t                  len;
+    uint16_t                width;
+    uint16_t                height;
+    mp_camera_pixformat_t   format;
+    int64_t                 timestamp_us;
+    uint32_t                sequence;       // Sensor frame number, gaps are dropped frames
+} mp_camera_frame_obj_t;
+
+extern const mp_obj_type_t mp_camera_frame_type;
+
+// The Camera type, subclasses are resolved with mp_obj_cast_to_native_base
+extern const mp_obj_type_t camera_type;
+
+/**
+ * @brief Frame buffer memory plan of a camera configuration.
+ * @details A configuration fits, if a single frame buffer fits into largest_block and required <= available.
+ */
+typedef struct mp_camera_memory_plan {
+    size_t  fb_size;        // Size of a single frame buffer in bytes
+    size_t  required;       // Memory needed by fb_count frame buffers incl. allocation overhead and reserve
+    size_t  available;      // Free memory for frame buffers, incl. the buffers of the running camera
+    size_t  largest_block;  // Largest block a single frame buffer can be allocated in
+    int     max_fb_count;   // Number of frame buffers which fit into the available memory (0 if none)
+    bool    fits;
+} mp_camera_memory_plan_t;
+
+/**
+ * @brief Creates a new frame object.
+ * 
+ * @param camera Camera owning the buffer or NULL, if the frame owns the buffer.
+ * @param seq Sequence number used by the HAL to validate the frame.
+ * @param buf Pixel data.
+ * @param len Length of the pixel data in bytes.
+ * @param width Frame width in pixels.
+ * @param height Frame height in pixels.
+ * @param format Pixel format of the data.
+ * @param timestamp_us Capture timestamp in microseconds.
+ * @param sequence Sensor frame number.
+ * @return New frame object.
+ */
+extern mp_obj_t mp_camera_frame_new(mp_camera_obj_t *camera, uint32_t seq, uint8_t *buf, size_t len,
+    uint16_t width, uint16_t height, mp_camera_pixformat_t format, int64_t timestamp_us, uint32_t sequence);
+
+/**
+ * @brief Returns the frame object, or raises if its buffer has been released or recycled.
+ * 
+ * @param frame_in Frame object.
+ */
+extern mp_camera_frame_obj_t *mp_camera_frame_get_valid(mp_obj_t frame_in);
+
+/**
+ * @brief Encodes pixel data with the software JPEG encoder into a new frame, which owns its buffer (see camera_jpeg.h).
+ * 
+ * @param buf Pixel data (RGB565, YUV422 or GRAYSCALE).
+ * @param quality API quality (0..100).
+ * @param subsampling Chroma subsampling (444, 422 or 420).
+ * @return New JPEG frame or MP_OBJ_NULL, if the frame cannot be encoded.
+ */
+extern mp_obj_t mp_camera_frame_new_jpeg(const uint8_t *buf, uint16_t width, uint16_t height, mp_camera_pixformat_t format,
+    int quality, int subsampling, int64_t timestamp_us, uint32_t sequence);
+
+#ifndef MICROPY_CAMERA_MJPEG_BOUNDARY_MAX
+#define MICROPY_CAMERA_MJPEG_BOUNDARY_MAX (70)  // Maximal boundary length according to RFC 2046
+#endif
+
+#ifndef MICROPY_CAMERA_JPEG_CHUNK_SIZE
+#define MICROPY_CAMERA_JPEG_CHUNK_SIZE (512)    // Output chunk of the software JPEG encoder
+#endif
+
+/**
+ * @brief Frame counters of a camera.
+ * @details Sequence numbers are estimated from the driver timestamps: a gap of n frame periods between two
+ * grabbed frames means that n - 1 frames of the sensor were never handed out (skipped by the driver,
+ * overwritten in GRAB_LATEST mode or not fetched in time).
+ */
+typedef struct mp_camera_frame_stats {
+    uint32_t    captured;           // Frames grabbed from the driver
+    uint32_t    dropped;            // Sensor frames between the grabbed frames
+    uint32_t    overwritten;        // Frames grabbed by the frame watcher and replaced before they were handed out
+    uint32_t    frame_period_us;    // Estimated sensor frame period, 0 if unknown
+    uint32_t    sequence;           // Sequence number of the last grabbed frame
+} mp_camera_frame_stats_t;
+
+/**
+ * @brief Writer for multipart MJPEG streams (multipart/x-mixed-replace).
+ * @details Each part is written as header, frame data and trailer straight from the source buffer to the stream.
+ * Progress is kept in the writer, so partial writes of non-blocking streams can be resumed (see mp_camera_mjpeg_writer_pump).
+ * Without boundary, only the frame data is written.
+ */
+typedef struct mp_camera_mjpeg_writer_obj {
+    mp_obj_base_t   base;
+    mp_obj_t        stream;
+    mp_obj_t        source;             // Frame or buffer of the current part, MP_OBJ_NULL if idle
+    size_t          offset;             // Bytes of the current part written so far
+    size_t          source_len;
+    uint8_t         boundary_len;
+    uint8_t         hdr_len;
+    char            boundary[MICROPY_CAMERA_MJPEG_BOUNDARY_MAX];
+    char            hdr[MICROPY_CAMERA_MJPEG_BOUNDARY_MAX + 64];
+} mp_camera_mjpeg_writer_obj_t;
+
+extern const mp_obj_type_t mp_camera_mjpeg_writer_type;
+
+/**
+ * @brief Initializes a writer.
+ * 
+ * @param self Writer (may live on the C stack).
+ * @param stream Stream object to write to (e.g. socket).
+ * @param boundary Multipart boundary (without leading "--") or NULL to write the frame data only.
+ * @param boundary_len Length of the boundary.
+ */
+extern void mp_camera_mjpeg_writer_init(mp_camera_mjpeg_writer_obj_t *self, mp_obj_t stream, const char *boundary, size_t boundary_len);
+
+/**
+ * @brief Starts a new part. A part in progress is discarded.
+ * 
+ * @param self Writer.
+ * @param source Object with buffer protocol (e.g. Frame) to be sent. Must stay valid until the part is complete.
+ */
+extern void mp_camera_mjpeg_writer_begin(mp_camera_mjpeg_writer_obj_t *self, mp_obj_t source);
+
+/**
+ * @brief Writes as much of the current part as the stream accepts without blocking.
+ * 
+ * @param self Writer.
+ * @param errcode Set to the error code, if the stream failed (MP_EAGAIN, if it would block).
+ * @return True, if the part is complete (or no part is in progress).
+ */
+extern bool mp_camera_mjpeg_writer_pump(mp_camera_mjpeg_writer_obj_t *self, int *errcode);
+
+/**
+ * @brief Writes a complete part and waits while the stream would block.
+ * 
+ * @param self Writer.
+ * @param source Object with buffer protocol to be sent.
+ * @param errcode Set to the error code, if the stream failed.
+ * @return True, if the part has been written completely.
+ */
+extern bool mp_camera_mjpeg_writer_send(mp_camera_mjpeg_writer_obj_t *self, mp_obj_t source, int *errcode);
+
+/**
+ * @brief Returns true, if the error code means that the peer has gone away.
+ */
+extern bool mp_camera_mjpeg_disconnected(int errcode);
+
+extern const mp_obj_type_t mp_camera_fanout_type;
+
+// Recorder of JPEG frames into an AVI file with a staging buffer for the storage writes (see camera_avi.h)
+extern const mp_obj_type_t mp_camera_avi_recorder_type;
+
+// Ring buffer of the most recent frames, which are dumped when an event happens (see camera_ring.h)
+extern const mp_obj_type_t mp_camera_pre_event_type;
+
+// Block based motion detection on GRAYSCALE and YUV422 frames (see camera_motion.h)
+extern const mp_obj_type_t mp_camera_motion_detector_type;
+
+// Luma histogram, channel statistics and block means of a frame (see camera_stats.h)
+MP_DECLARE_CONST_FUN_OBJ_KW(mp_camera_stats_obj);
+
+// Software auto exposure / auto white balance loop (see camera_exposure.h)
+extern const mp_obj_type_t mp_camera_auto_exposure_type;
+
+// Software JPEG encoding of RGB565, YUV422 and GRAYSCALE frames into a new frame or a stream (see camera_jpeg.h)
+MP_DECLARE_CONST_FUN_OBJ_KW(mp_camera_encode_jpeg_obj);
+
 /**
  * @brief Constructs the camera hardware abstraction layer.
  * @details The Port-plattform shall define a default pwm-time source and also frame buffer location (no input)
@@ -169,24 +651,91 @@ extern void mp_camera_hal_deinit(mp_camera_obj_t *self);
  */
 extern bool mp_camera_hal_initialized(mp_camera_obj_t *self);
 
+/**
+ * @brief How a reconfiguration was applied, from the cheapest to the most expensive way.
+ */
+typedef enum {
+    MP_CAMERA_RECONFIGURE_NONE,     // Nothing changed
+    MP_CAMERA_RECONFIGURE_SENSOR,   // Applied by the sensor, the frame buffers of the driver are reused
+    MP_CAMERA_RECONFIGURE_RESTART,  // The driver was deinitialized and initialized again
+} mp_camera_reconfigure_t;
+
 /**
  * @brief Reconfigures the camera hardware abstraction layer.
+ * @details Changes which fit into the frame buffers of the running driver are applied by the sensor, only
+ * the other ones restart the driver.
  * 
  * @param self Pointer to the camera object.
  * @param frame_size Frame size.
  * @param pixel_format Pixel format.
  * @param grab_mode Grab mode.
  * @param fb_count Number of framebuffers.
+ * @return How the new configuration was applied.
  */
-extern void mp_camera_hal_reconfigure(mp_camera_obj_t *self, mp_camera_framesize_t frame_size, mp_camera_pixformat_t pixel_format, mp_camera_grabmode_t grab_mode, mp_int_t fb_count);
+extern mp_camera_reconfigure_t mp_camera_hal_reconfigure(mp_camera_obj_t *self, mp_camera_framesize_t frame_size, mp_camera_pixformat_t pixel_format, mp_camera_grabmode_t grab_mode, mp_int_t fb_count);
 
 /**
- * @brief Captures an image and returns it as mp_obj_t (e.g. mp_obj_new_memoryview).
+ * @brief Applies a batch of sensor settings.
+ * @details All settings are validated before the first one is written, so an invalid batch raises without
+ * changing the sensor. Only settings which differ from the current value are written, and all of them are
+ * verified after the last write. A deferred batch is applied right after the next frame was taken from the
+ * driver, and the frames started while it was written are dropped, so no frame has half of the batch applied.
+ *
+ * @param self Pointer to the camera object.
+ * @param settings Settings to apply.
+ * @param deferred Apply the batch at the next frame boundary instead of right away.
+ * @return Mask of the settings which could not be verified (always 0 if deferred).
+ */
+extern uint32_t mp_camera_hal_apply_settings(mp_camera_obj_t *self, const mp_camera_settings_t *settings, bool deferred);
+
+/**
+ * @brief Reads all sensor settings the sensor supports (without accessing the sensor).
+ *
+ * @param self Pointer to the camera object.
+ * @param settings Filled with the settings, mask has the supported ones.
+ */
+extern void mp_camera_hal_get_settings(mp_camera_obj_t *self, mp_camera_settings_t *settings);
+
+/**
+ * @brief Estimates the frame buffer memory of a configuration and checks it against the free memory.
+ * @details Mirrors the allocation of the camera driver. Memory of the running camera is counted as available,
+ * since it is freed before the camera is reconfigured.
  * 
  * @param self Pointer to the camera object.
+ * @param frame_size Frame size.
+ * @param pixel_format Pixel format.
+ * @param fb_count Number of framebuffers.
+ * @param plan Filled with the estimate.
+ */
+extern void mp_camera_hal_plan_memory(mp_camera_obj_t *self, mp_camera_framesize_t frame_size, mp_camera_pixformat_t pixel_format, mp_int_t fb_count, mp_camera_memory_plan_t *plan);
+
+/**
+ * @brief Captures an image and returns it as mp_obj_t (Frame object, see mp_camera_frame_new).
+ * @details Frames which are not held are returned to the driver on the next capture. Held frames stay
+ * valid until they are released individually or free_buffer is called. At most fb_count frames can be
+ * outstanding, further captures raise an OSError until a frame is released.
+ * If out_format differs from the configured pixel format, the frame is converted into a
+ * frame owning its buffer (see camera_conv.h) and the frame buffer is returned to the driver right away.
+ * 
+ * @param self Pointer to the camera object.
+ * @param out_format Output pixel format or -1 to return the frame as delivered by the sensor.
+ * @param hold Keep the frame buffer until the frame is released.
  * @return Captured image as micropython object.
  */
-extern mp_obj_t mp_camera_hal_capture(mp_camera_obj_t *self);
+extern mp_obj_t mp_camera_hal_capture(mp_camera_obj_t *self, int8_t out_format, bool hold);
+
+/**
+ * @brief Captures an image into a caller-owned buffer.
+ * @details The frame is copied (or converted, if out_format differs from the configured pixel format)
+ * into buf and the frame buffer is returned to the driver before the function returns. No heap memory is allocated.
+ * 
+ * @param self Pointer to the camera object.
+ * @param buf Destination buffer.
+ * @param len Length of the destination buffer in bytes.
+ * @param out_format Output pixel format or -1 to copy the frame as delivered by the sensor.
+ * @return Number of bytes written as micropython int, or None if no frame could be captured.
+ */
+extern mp_obj_t mp_camera_hal_capture_into(mp_camera_obj_t *self, uint8_t *buf, size_t len, int8_t out_format);
 
 /**
  * @brief Returns true, if a frame is available.
@@ -197,12 +746,76 @@ extern mp_obj_t mp_camera_hal_capture(mp_camera_obj_t *self);
 extern mp_obj_t mp_camera_hal_frame_available(mp_camera_obj_t *self);
 
 /**
- * @brief Frees the buffer of the camera object.
+ * @brief Starts or stops grabbing frames in the background.
+ * @details While a dispatch function is set, the HAL grabs each completed frame as soon as the driver delivers it
+ * and schedules dispatch(camera) with mp_sched_schedule. If the dispatch falls behind, newer frames replace the
+ * ready frame (coalescing), so at most one dispatch is pending and it gets the latest frame.
+ * 
+ * @param self Pointer to the camera object.
+ * @param dispatch Function object to schedule or MP_OBJ_NULL to stop.
+ */
+extern void mp_camera_hal_set_frame_callback(mp_camera_obj_t *self, mp_obj_t dispatch);
+
+/**
+ * @brief Hands out the frame grabbed in the background as a frame which is not held.
+ * @details Must be called by the dispatch function (see mp_camera_hal_set_frame_callback).
+ * 
+ * @param self Pointer to the camera object.
+ * @return Frame object or None, if there is no ready frame (e.g. it has been captured meanwhile) or all frame buffers are held.
+ */
+extern mp_obj_t mp_camera_hal_take_ready_frame(mp_camera_obj_t *self);
+
+/**
+ * @brief Returns true, if the next capture will not block.
+ * @details Used for polling. The camera is ready, if the frames handed out fill all fb_count buffers (the next
+ * capture recycles the frames which are not held) or if a ready or completed frame is available. Polling itself does not recycle frames.
+ * 
+ * @param self Pointer to the camera object.
+ */
+extern bool mp_camera_hal_frame_ready(mp_camera_obj_t *self);
+
+/**
+ * @brief Frees all frame buffers handed out by the camera object, including held ones.
  * 
  * @param self Pointer to the camera object.
  */
 extern void mp_camera_hal_free_buffer(mp_camera_obj_t *self);
 
+/**
+ * @brief Returns true, if the frame with the given sequence number still owns its frame buffer.
+ * 
+ * @param self Pointer to the camera object.
+ * @param seq Sequence number of the frame.
+ */
+extern bool mp_camera_hal_frame_valid(mp_camera_obj_t *self, uint32_t seq);
+
+/**
+ * @brief Returns the frame counters.
+ * 
+ * @param self Pointer to the camera object.
+ * @param stats Receives the counters.
+ * @param reset Reset captured, dropped and overwritten after reading them.
+ */
+extern void mp_camera_hal_get_frame_stats(mp_camera_obj_t *self, mp_camera_frame_stats_t *stats, bool reset);
+
+/**
+ * @brief Returns the performance counters.
+ * 
+ * @param self Pointer to the camera object.
+ * @param perf Receives the counters.
+ * @param reset Reset the counters after reading them.
+ */
+extern void mp_camera_hal_get_perf(mp_camera_obj_t *self, mp_camera_perf_t *perf, bool reset);
+
+/**
+ * @brief Returns the frame buffer of the frame with the given sequence number to the driver.
+ * @details Does nothing if the frame is not valid anymore.
+ * 
+ * @param self Pointer to the camera object.
+ * @param seq Sequence number of the frame.
+ */
+extern void mp_camera_hal_release_frame(mp_camera_obj_t *self, uint32_t seq);
+
 /**
  * @brief Table mapping pixel formats API to their corresponding values at HAL.
  * @details Needs to be defined in the port-specific implementation.
@@ -278,6 +891,7 @@ DECLARE_CAMERA_HAL_GET(mp_camera_pixformat_t, pixel_format)
 DECLARE_CAMERA_HAL_GET(int, pixel_height)
 DECLARE_CAMERA_HAL_GET(int, pixel_width)
 DECLARE_CAMERA_HAL_GET(const char *, sensor_name)
+DECLARE_CAMERA_HAL_GET(int, sensor_id)
 DECLARE_CAMERA_HAL_GET(bool, supports_jpeg)
 
 #endif // MICROPY_INCLUDED_MODCAMERA_H
\ No newline at end of file
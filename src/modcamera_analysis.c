@@ -0,0 +1,453 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Christopher Nadler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/obj.h"
+#include "py/mphal.h"
+
+#include "modcamera.h"
+#include "camera_motion.h"
+#include "camera_stats.h"
+#include "camera_exposure.h"
+
+#define MOTION_MAX_BOXES (16)
+
+// MotionDetector: block based motion detection against a downsampled reference frame
+
+typedef struct mp_camera_motion_detector_obj {
+    mp_obj_base_t   base;
+    camera_motion_t motion;
+    uint8_t         scale;
+    size_t          ref_size;           // Size of the allocated reference, 0 before the first frame
+    mp_obj_t        mask;               // bytearray of cols x rows, overwritten by every detect
+    uint8_t         *mask_buf;
+    uint16_t        *queue;             // Scratch for boxes()
+    size_t          moving;             // Moving blocks of the last frame
+} mp_camera_motion_detector_obj_t;
+
+static mp_obj_t motion_detector_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    enum { ARG_grid, ARG_threshold, ARG_scale, ARG_learn };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_grid, MP_ARG_OBJ | MP_ARG_KW_ONLY, {.u_obj = MP_ROM_NONE} },
+        { MP_QSTR_threshold, MP_ARG_INT | MP_ARG_KW_ONLY, {.u_int = 12} },
+        { MP_QSTR_scale, MP_ARG_INT | MP_ARG_KW_ONLY, {.u_int = 4} },
+        { MP_QSTR_learn, MP_ARG_OBJ | MP_ARG_KW_ONLY, {.u_obj = MP_ROM_NONE} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_int_t cols = 16, rows = 12;
+    if (args[ARG_grid].u_obj != mp_const_none) {
+        mp_obj_t *grid;
+        mp_obj_get_array_fixed_n(args[ARG_grid].u_obj, 2, &grid);
+        cols = mp_obj_get_int(grid[0]);
+        rows = mp_obj_get_int(grid[1]);
+    }
+    if (cols < 1 || rows < 1 || cols > CAMERA_MOTION_MAX_GRID || rows > CAMERA_MOTION_MAX_GRID) {
+        mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("grid must be between 1 and %d"), CAMERA_MOTION_MAX_GRID);
+    }
+    mp_int_t scale = args[ARG_scale].u_int;
+    if (scale != 1 && scale != 2 && scale != 4 && scale != 8) {
+        mp_raise_ValueError(MP_ERROR_TEXT("scale must be 1, 2, 4 or 8"));
+    }
+    mp_int_t threshold = args[ARG_threshold].u_int;
+    if (threshold < 0 || threshold > 255) {
+        mp_raise_ValueError(MP_ERROR_TEXT("threshold must be between 0 and 255"));
+    }
+    mp_float_t learn = args[ARG_learn].u_obj != mp_const_none ? mp_obj_get_float(args[ARG_learn].u_obj) : 1;
+    if (learn <= 0 || learn > 1) {
+        mp_raise_ValueError(MP_ERROR_TEXT("learn must be in (0, 1]"));
+    }
+
+    mp_camera_motion_detector_obj_t *self = mp_obj_malloc(mp_camera_motion_detector_obj_t, type);
+    self->motion.cols = cols;
+    self->motion.rows = rows;
+    self->motion.threshold = threshold;
+    self->motion.learn = (uint16_t)(learn * 256 + MICROPY_FLOAT_CONST(0.5));
+    self->motion.has_reference = false;
+    self->scale = scale;
+    self->ref_size = 0;
+    self->mask_buf = m_new0(uint8_t, cols * rows);
+    self->mask = mp_obj_new_bytearray_by_ref(cols * rows, self->mask_buf);
+    self->queue = m_new(uint16_t, cols * rows);
+    self->moving = 0;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+static mp_obj_t motion_detector_detect(mp_obj_t self_in, mp_obj_t frame_in) {
+    mp_camera_motion_detector_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_camera_frame_obj_t *frame = mp_camera_frame_get_valid(frame_in);
+    if (!camera_motion_supported((camera_conv_format_t)frame->format)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("Motion detection needs GRAYSCALE or YUV422 frames"));
+    }
+    size_t bpp = camera_conv_bytes_per_pixel((camera_conv_format_t)frame->format);
+    if (frame->len < (size_t)frame->width * frame->height * bpp) {
+        mp_raise_ValueError(MP_ERROR_TEXT("Frame is too short for its size"));
+    }
+
+    // The reference is (re)created for the first frame and whenever the frame size changes
+    if (self->ref_size == 0 || frame->width != self->motion.width || frame->height != self->motion.height) {
+        size_t ref_size = camera_motion_reference_size(frame->width, frame->height, self->scale);
+        uint8_t *reference = self->ref_size ? m_renew(uint8_t, self->motion.reference, self->ref_size, ref_size) : m_new(uint8_t, ref_size);
+        self->motion.reference = reference;
+        self->ref_size = ref_size;
+        if (!camera_motion_init(&self->motion, frame->width, frame->height, self->scale,
+            self->motion.cols, self->motion.rows, reference)) {
+            self->motion.width = 0;
+            mp_raise_ValueError(MP_ERROR_TEXT("Grid is too fine for the frame size and scale"));
+        }
+    }
+
+    self->moving = camera_motion_detect(&self->motion, (camera_conv_format_t)frame->format, frame->buf, self->mask_buf);
+    return mp_obj_new_float((mp_float_t)self->moving / (self->motion.cols * self->motion.rows));
+}
+static MP_DEFINE_CONST_FUN_OBJ_2(motion_detector_detect_obj, motion_detector_detect);
+
+static mp_obj_t motion_detector_boxes(size_t n_args, const mp_obj_t *args) {
+    mp_camera_motion_detector_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_int_t max_boxes = n_args > 1 ? mp_obj_get_int(args[1]) : 8;
+    if (max_boxes < 1 || max_boxes > MOTION_MAX_BOXES) {
+        mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("max_boxes must be between 1 and %d"), MOTION_MAX_BOXES);
+    }
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    if (!self->moving) {
+        return list;
+    }
+    camera_motion_box_t boxes[MOTION_MAX_BOXES];
+    size_t count = camera_motion_boxes(&self->motion, self->mask_buf, self->queue, boxes, max_boxes);
+    for (size_t i = 0; i < count; i++) {
+        mp_obj_t box[4] = {
+            MP_OBJ_NEW_SMALL_INT(boxes[i].x),
+            MP_OBJ_NEW_SMALL_INT(boxes[i].y),
+            MP_OBJ_NEW_SMALL_INT(boxes[i].w),
+            MP_OBJ_NEW_SMALL_INT(boxes[i].h),
+        };
+        mp_obj_list_append(list, mp_obj_new_tuple(4, box));
+    }
+    return list;
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(motion_detector_boxes_obj, 1, 2, motion_detector_boxes);
+
+static mp_obj_t motion_detector_reset(mp_obj_t self_in) {
+    mp_camera_motion_detector_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    self->motion.has_reference = false;
+    self->moving = 0;
+    memset(self->mask_buf, 0, self->motion.cols * self->motion.rows);
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(motion_detector_reset_obj, motion_detector_reset);
+
+static void motion_detector_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
+    mp_camera_motion_detector_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (dest[0] == MP_OBJ_NULL) {
+        if (attr == MP_QSTR_mask) {
+            dest[0] = self->mask;
+        } else if (attr == MP_QSTR_moving) {
+            dest[0] = MP_OBJ_NEW_SMALL_INT(self->moving);
+        } else if (attr == MP_QSTR_grid) {
+            mp_obj_t grid[2] = { MP_OBJ_NEW_SMALL_INT(self->motion.cols), MP_OBJ_NEW_SMALL_INT(self->motion.rows) };
+            dest[0] = mp_obj_new_tuple(2, grid);
+        } else if (attr == MP_QSTR_threshold) {
+            dest[0] = MP_OBJ_NEW_SMALL_INT(self->motion.threshold);
+        } else {
+            dest[1] = MP_OBJ_SENTINEL;
+        }
+    } else if (dest[1] != MP_OBJ_NULL && attr == MP_QSTR_threshold) {
+        mp_int_t threshold = mp_obj_get_int(dest[1]);
+        if (threshold < 0 || threshold > 255) {
+            mp_raise_ValueError(MP_ERROR_TEXT("threshold must be between 0 and 255"));
+        }
+        self->motion.threshold = threshold;
+        dest[0] = MP_OBJ_NULL;
+    }
+}
+
+static const mp_rom_map_elem_t motion_detector_locals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_detect), MP_ROM_PTR(&motion_detector_detect_obj) },
+    { MP_ROM_QSTR(MP_QSTR_boxes), MP_ROM_PTR(&motion_detector_boxes_obj) },
+    { MP_ROM_QSTR(MP_QSTR_reset), MP_ROM_PTR(&motion_detector_reset_obj) },
+};
+static MP_DEFINE_CONST_DICT(motion_detector_locals_dict, motion_detector_locals_table);
+
+MP_DEFINE_CONST_OBJ_TYPE(
+    mp_camera_motion_detector_type,
+    MP_QSTR_MotionDetector,
+    MP_TYPE_FLAG_NONE,
+    make_new, motion_detector_make_new,
+    attr, motion_detector_attr,
+    locals_dict, &motion_detector_locals_dict
+);
+
+// stats: luma histogram, channel statistics and block means of a frame in one pass
+
+static mp_obj_t new_channel_tuple(size_t channels, const uint8_t *values) {
+    mp_obj_t items[3];
+    for (size_t c = 0; c < channels; c++) {
+        items[c] = MP_OBJ_NEW_SMALL_INT(values[c]);
+    }
+    return mp_obj_new_tuple(channels, items);
+}
+
+static mp_obj_t mp_camera_stats(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_frame, ARG_stride, ARG_grid, ARG_bins };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_frame, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_stride, MP_ARG_INT | MP_ARG_KW_ONLY, {.u_int = 1} },
+        { MP_QSTR_grid, MP_ARG_OBJ | MP_ARG_KW_ONLY, {.u_obj = MP_ROM_NONE} },
+        { MP_QSTR_bins, MP_ARG_INT | MP_ARG_KW_ONLY, {.u_int = 256} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_camera_frame_obj_t *frame = mp_camera_frame_get_valid(args[ARG_frame].u_obj);
+    camera_conv_format_t format = (camera_conv_format_t)frame->format;
+    if (!camera_stats_supported(format)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("Statistics need RGB565, RGB888, GRAYSCALE or YUV422 frames"));
+    }
+    if (frame->len < (size_t)frame->width * frame->height * camera_conv_bytes_per_pixel(format)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("Frame is too short for its size"));
+    }
+    mp_int_t cols = 4, rows = 4;
+    if (args[ARG_grid].u_obj != mp_const_none) {
+        mp_obj_t *grid;
+        mp_obj_get_array_fixed_n(args[ARG_grid].u_obj, 2, &grid);
+        cols = mp_obj_get_int(grid[0]);
+        rows = mp_obj_get_int(grid[1]);
+    }
+    mp_int_t bins = args[ARG_bins].u_int;
+    if (bins < 1 || bins > 256 || (bins & (bins - 1))) {
+        mp_raise_ValueError(MP_ERROR_TEXT("bins must be a power of 2 up to 256"));
+    }
+    mp_int_t stride = args[ARG_stride].u_int;
+    if (stride < 1 || cols < 1 || rows < 1 || cols > CAMERA_STATS_MAX_GRID || rows > CAMERA_STATS_MAX_GRID) {
+        mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("stride must be >= 1 and grid between 1 and %d"), CAMERA_STATS_MAX_GRID);
+    }
+
+    camera_stats_t *stats = m_new_obj(camera_stats_t);
+    vstr_t grid;
+    vstr_init_len(&grid, cols * rows);
+    if (!camera_stats_compute(format, frame->buf, frame->width, frame->height, stride, cols, rows,
+        stats, (uint8_t *)grid.buf)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("Grid blocks must be at least stride pixels"));
+    }
+
+    // Fold the 256 luma bins into the requested number of bins
+    size_t fold = 256 / bins;
+    mp_obj_t histogram = mp_obj_new_list(bins, NULL);
+    mp_obj_t *items;
+    size_t len;
+    mp_obj_list_get(histogram, &len, &items);
+    for (size_t i = 0; i < len; i++) {
+        uint32_t count = 0;
+        for (size_t j = 0; j < fold; j++) {
+            count += stats->histogram[i * fold + j];
+        }
+        items[i] = mp_obj_new_int_from_uint(count);
+    }
+
+    mp_obj_t dict = mp_obj_new_dict(8);
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_histogram), histogram);
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_luma), MP_OBJ_NEW_SMALL_INT(stats->luma));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_mean), new_channel_tuple(stats->channels, stats->mean));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_min), new_channel_tuple(stats->channels, stats->min));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_max), new_channel_tuple(stats->channels, stats->max));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_grid), mp_obj_new_bytes_from_vstr(&grid));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_samples), mp_obj_new_int_from_uint(stats->samples));
+    m_del_obj(camera_stats_t, stats);
+    return dict;
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(mp_camera_stats_obj, 1, mp_camera_stats);
+
+// AutoExposure: software exposure and white balance loop driving the sensor settings from frame statistics
+
+typedef struct mp_camera_auto_exposure_obj {
+    mp_obj_base_t       base;
+    mp_obj_t            camera;
+    camera_exposure_t   ctrl;
+    uint16_t            stride;
+    uint16_t            interval;       // Frames per update, the sensor applies new settings with a delay
+    uint16_t            skipped;
+    bool                running;
+} mp_camera_auto_exposure_obj_t;
+
+static mp_camera_obj_t *auto_exposure_camera(mp_camera_auto_exposure_obj_t *self) {
+    return MP_OBJ_TO_PTR(self->camera);
+}
+
+static mp_obj_t auto_exposure_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    enum { ARG_camera, ARG_target, ARG_gain, ARG_damping, ARG_interval, ARG_tolerance, ARG_stride, ARG_awb, ARG_max_exposure, ARG_max_gain };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_camera, MP_ARG_OBJ | MP_ARG_REQUIRED },
+        { MP_QSTR_target, MP_ARG_INT | MP_ARG_KW_ONLY, {.u_int = 110} },
+        { MP_QSTR_gain, MP_ARG_OBJ | MP_ARG_KW_ONLY, {.u_obj = MP_ROM_NONE} },
+        { MP_QSTR_damping, MP_ARG_OBJ | MP_ARG_KW_ONLY, {.u_obj = MP_ROM_NONE} },
+        { MP_QSTR_interval, MP_ARG_INT | MP_ARG_KW_ONLY, {.u_int = 2} },
+        { MP_QSTR_tolerance, MP_ARG_INT | MP_ARG_KW_ONLY, {.u_int = 8} },
+        { MP_QSTR_stride, MP_ARG_INT | MP_ARG_KW_ONLY, {.u_int = 4} },
+        { MP_QSTR_awb, MP_ARG_BOOL | MP_ARG_KW_ONLY, {.u_bool = true} },
+        { MP_QSTR_max_exposure, MP_ARG_INT | MP_ARG_KW_ONLY, {.u_int = 1200} },
+        { MP_QSTR_max_gain, MP_ARG_INT | MP_ARG_KW_ONLY, {.u_int = 30} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_obj_t camera = mp_obj_cast_to_native_base(args[ARG_camera].u_obj, MP_OBJ_FROM_PTR(&camera_type));
+    if (camera == MP_OBJ_NULL) {
+        mp_raise_TypeError(MP_ERROR_TEXT("expected a Camera"));
+    }
+    mp_float_t gain = args[ARG_gain].u_obj != mp_const_none ? mp_obj_get_float(args[ARG_gain].u_obj) : MICROPY_FLOAT_CONST(0.7);
+    mp_float_t damping = args[ARG_damping].u_obj != mp_const_none ? mp_obj_get_float(args[ARG_damping].u_obj) : MICROPY_FLOAT_CONST(0.2);
+    if (gain <= 0 || gain > 1 || damping < 0 || damping >= 1) {
+        mp_raise_ValueError(MP_ERROR_TEXT("gain must be in (0, 1] and damping in [0, 1)"));
+    }
+    if (args[ARG_target].u_int < 1 || args[ARG_target].u_int > 254 || args[ARG_tolerance].u_int < 1
+        || args[ARG_tolerance].u_int > 127 || args[ARG_interval].u_int < 1 || args[ARG_interval].u_int > 0xFFFF
+        || args[ARG_stride].u_int < 1 || args[ARG_stride].u_int > 0xFFFF) {
+        mp_raise_ValueError(MP_ERROR_TEXT("Invalid target, tolerance, interval or stride"));
+    }
+    if (args[ARG_max_exposure].u_int < 1 || args[ARG_max_exposure].u_int > 0xFFFF
+        || args[ARG_max_gain].u_int < 0 || args[ARG_max_gain].u_int > 0xFF) {
+        mp_raise_ValueError(MP_ERROR_TEXT("Invalid max_exposure or max_gain"));
+    }
+
+    mp_camera_auto_exposure_obj_t *self = mp_obj_malloc(mp_camera_auto_exposure_obj_t, type);
+    self->camera = camera;
+    self->ctrl.target = args[ARG_target].u_int;
+    self->ctrl.tolerance = args[ARG_tolerance].u_int;
+    self->ctrl.wb_tolerance = args[ARG_tolerance].u_int;
+    self->ctrl.awb = args[ARG_awb].u_bool;
+    self->ctrl.gain = gain;
+    self->ctrl.damping = damping;
+    self->ctrl.max_exposure = args[ARG_max_exposure].u_int;
+    self->ctrl.max_gain = args[ARG_max_gain].u_int;
+    self->stride = args[ARG_stride].u_int;
+    self->interval = args[ARG_interval].u_int;
+    self->skipped = 0;
+
+    // The loop takes over from the sensor, starting with its current settings
+    mp_camera_obj_t *cam = auto_exposure_camera(self);
+    mp_camera_hal_set_exposure_ctrl(cam, false);
+    mp_camera_hal_set_gain_ctrl(cam, false);
+    camera_exposure_init(&self->ctrl, mp_camera_hal_get_aec_value(cam), mp_camera_hal_get_agc_gain(cam),
+        mp_camera_hal_get_wb_mode(cam));
+    self->running = true;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+static mp_obj_t auto_exposure_update(mp_obj_t self_in, mp_obj_t frame_in) {
+    mp_camera_auto_exposure_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_camera_frame_obj_t *frame = mp_camera_frame_get_valid(frame_in);
+    camera_conv_format_t format = (camera_conv_format_t)frame->format;
+    if (!camera_stats_supported(format)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("AutoExposure needs RGB565, RGB888, GRAYSCALE or YUV422 frames"));
+    }
+    if (!self->running || ++self->skipped < self->interval) {
+        return mp_obj_new_bool(self->ctrl.converged);
+    }
+    self->skipped = 0;
+
+    if (frame->len < (size_t)frame->width * frame->height * camera_conv_bytes_per_pixel(format)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("Frame is too short for its size"));
+    }
+    camera_stats_t *stats = m_new_obj(camera_stats_t);
+    size_t stride = MIN(self->stride, MIN(frame->width, frame->height));
+    camera_stats_compute(format, frame->buf, frame->width, frame->height, stride, 1, 1, stats, NULL);
+    camera_exposure_output_t out;
+    camera_exposure_update(&self->ctrl, stats, mp_hal_ticks_ms(), &out);
+    m_del_obj(camera_stats_t, stats);
+
+    mp_camera_obj_t *cam = auto_exposure_camera(self);
+    if (out.exposure_changed) {
+        mp_camera_hal_set_aec_value(cam, out.aec_value);
+        mp_camera_hal_set_agc_gain(cam, out.agc_gain);
+    }
+    if (out.wb_changed) {
+        mp_camera_hal_set_wb_mode(cam, out.wb_mode);
+    }
+    return mp_obj_new_bool(self->ctrl.converged);
+}
+static MP_DEFINE_CONST_FUN_OBJ_2(auto_exposure_update_obj, auto_exposure_update);
+
+static mp_obj_t auto_exposure_stop(mp_obj_t self_in) {
+    mp_camera_auto_exposure_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->running) {
+        self->running = false;
+        mp_camera_obj_t *cam = auto_exposure_camera(self);
+        if (mp_camera_hal_initialized(cam)) {
+            mp_camera_hal_set_exposure_ctrl(cam, true);
+            mp_camera_hal_set_gain_ctrl(cam, true);
+            if (self->ctrl.awb) {
+                mp_camera_hal_set_wb_mode(cam, 0);
+            }
+        }
+    }
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(auto_exposure_stop_obj, auto_exposure_stop);
+
+static void auto_exposure_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
+    mp_camera_auto_exposure_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (dest[0] == MP_OBJ_NULL) {
+        if (attr == MP_QSTR_converged) {
+            dest[0] = mp_obj_new_bool(self->ctrl.converged);
+        } else if (attr == MP_QSTR_convergence_ms) {
+            dest[0] = mp_obj_new_int_from_uint(self->ctrl.convergence_ms);
+        } else if (attr == MP_QSTR_convergence_frames) {
+            dest[0] = mp_obj_new_int_from_uint(self->ctrl.convergence_updates * self->interval);
+        } else if (attr == MP_QSTR_luma) {
+            dest[0] = MP_OBJ_NEW_SMALL_INT(self->ctrl.luma < 0 ? 0 : (mp_int_t)(self->ctrl.luma + MICROPY_FLOAT_CONST(0.5)));
+        } else if (attr == MP_QSTR_target) {
+            dest[0] = MP_OBJ_NEW_SMALL_INT(self->ctrl.target);
+        } else {
+            dest[1] = MP_OBJ_SENTINEL;
+        }
+    } else if (dest[1] != MP_OBJ_NULL && attr == MP_QSTR_target) {
+        mp_int_t target = mp_obj_get_int(dest[1]);
+        if (target < 1 || target > 254) {
+            mp_raise_ValueError(MP_ERROR_TEXT("target must be between 1 and 254"));
+        }
+        self->ctrl.target = target;
+        dest[0] = MP_OBJ_NULL;
+    }
+}
+
+static const mp_rom_map_elem_t auto_exposure_locals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_update), MP_ROM_PTR(&auto_exposure_update_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stop), MP_ROM_PTR(&auto_exposure_stop_obj) },
+};
+static MP_DEFINE_CONST_DICT(auto_exposure_locals_dict, auto_exposure_locals_table);
+
+MP_DEFINE_CONST_OBJ_TYPE(
+    mp_camera_auto_exposure_type,
+    MP_QSTR_AutoExposure,
+    MP_TYPE_FLAG_NONE,
+    make_new, auto_exposure_make_new,
+    attr, auto_exposure_attr,
+    locals_dict, &auto_exposure_locals_dict
+);
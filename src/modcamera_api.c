@@ -32,10 +32,16 @@
 #include "py/mperrno.h"
 #include "py/mphal.h"
 #include "py/runtime.h"
+#include "py/stream.h"
+#include "py/objtype.h"
 
 #include "modcamera.h"
+#include "camera_conv.h"
+#include "camera_jpeg.h"
 
-#if MICROPY_HW_ESP_NEW_I2C_DRIVER
+#if MICROPY_CAMERA_HOST
+// The synthetic sensor of host builds is not on an I2C bus
+#elif MICROPY_HW_ESP_NEW_I2C_DRIVER
 #include "driver/i2c_master.h"
 #else
 #include "driver/i2c.h"
@@ -44,7 +50,8 @@
 
 // Get the I2C port from the I2C object. This will be deleted in the future
 // Structure matches machine_hw_i2c_obj_t from machine_i2c.c
-#if MICROPY_HW_ESP_NEW_I2C_DRIVER
+#if MICROPY_CAMERA_HOST
+#elif MICROPY_HW_ESP_NEW_I2C_DRIVER
     typedef struct _machine_hw_i2c_obj_t {
         mp_obj_base_t base;
         i2c_master_bus_handle_t bus_handle;
@@ -153,6 +160,9 @@ static mp_obj_t mp_camera_make_new(const mp_obj_type_t *type, size_t n_args, siz
     mp_obj_t i2c_obj = args[ARG_i2c].u_obj;
     
     if (i2c_obj != MP_ROM_NONE) {
+        #if MICROPY_CAMERA_HOST
+        mp_raise_ValueError(MP_ERROR_TEXT("The synthetic sensor has no I2C bus"));
+        #else
         // External I2C object provided - extract port number from it
         extern const mp_obj_type_t machine_i2c_type;
         if (!mp_obj_is_type(i2c_obj, &machine_i2c_type)) {
@@ -163,6 +173,7 @@ static mp_obj_t mp_camera_make_new(const mp_obj_type_t *type, size_t n_args, siz
         i2c_port = (int8_t)i2c->port;
         sda_pin = i2c->sda;
         scl_pin = i2c->scl;
+        #endif
     } else {
         // Use individual pins
         sda_pin = args[ARG_sda_pin].u_int;
@@ -206,7 +217,7 @@ static mp_obj_t mp_camera_make_new(const mp_obj_type_t *type, size_t n_args, siz
 
     mp_camera_hal_init(self);
 
-    if (mp_camera_hal_capture(self) == mp_const_none){
+    if (mp_camera_hal_capture(self, -1, false) == mp_const_none){
         mp_camera_hal_deinit(self);
         mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("Failed to capture initial frame. Construct a new object with appropriate configuration."));
     } else {
@@ -219,12 +230,215 @@ static mp_obj_t mp_camera_make_new(const mp_obj_type_t *type, size_t n_args, siz
     }
 } // camera_construct
 
+// Captures a frame and crops/bins it into a frame owning its buffer. The frame buffer is released right away.
+static mp_obj_t capture_region(mp_camera_obj_t *self, mp_obj_t roi_in, mp_int_t bin, int8_t out_format) {
+    camera_conv_format_t format = (camera_conv_format_t)mp_camera_hal_get_pixel_format(self);
+    if (!camera_conv_crop_supported(format, bin)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("roi and bin need RGB565, RGB888, GRAYSCALE or YUV422 and bin 1, 2 or 4"));
+    }
+    if (out_format == (int8_t)format) {
+        out_format = -1;
+    }
+    bool encode = out_format == CAMERA_CONV_JPEG && camera_jpeg_supported(format);
+    if (out_format >= 0 && !encode && !camera_conv_supported(format, out_format)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("Unsupported conversion"));
+    }
+
+    mp_int_t width = mp_camera_hal_get_pixel_width(self);
+    mp_int_t height = mp_camera_hal_get_pixel_height(self);
+    mp_int_t x = 0, y = 0, w = width, h = height;
+    if (roi_in != mp_const_none) {
+        mp_obj_t *roi;
+        mp_obj_get_array_fixed_n(roi_in, 4, &roi);
+        x = mp_obj_get_int(roi[0]);
+        y = mp_obj_get_int(roi[1]);
+        w = mp_obj_get_int(roi[2]);
+        h = mp_obj_get_int(roi[3]);
+    }
+    if (x < 0 || y < 0 || w <= 0 || h <= 0 || x + w > width || y + h > height) {
+        mp_raise_ValueError(MP_ERROR_TEXT("roi exceeds the frame"));
+    }
+    size_t out_w = w / bin;
+    size_t out_h = h / bin;
+    if (!out_w || !out_h) {
+        mp_raise_ValueError(MP_ERROR_TEXT("roi is smaller than bin"));
+    }
+    if (format == CAMERA_CONV_YUV422 && ((x & 1) || (out_w & 1))) {
+        mp_raise_ValueError(MP_ERROR_TEXT("YUV422 needs an even x and output width"));
+    }
+
+    // Allocate before capturing, so a MemoryError does not leave the frame buffer behind
+    size_t out_len = out_w * out_h * camera_conv_bytes_per_pixel(format);
+    uint8_t *out = m_new(uint8_t, out_len);
+    mp_obj_t frame_in = mp_camera_hal_capture(self, -1, false);
+    if (frame_in == mp_const_none) {
+        m_del(uint8_t, out, out_len);
+        return mp_const_none;
+    }
+    mp_camera_frame_obj_t *frame = MP_OBJ_TO_PTR(frame_in);
+    bool fits = frame->width >= x + w && frame->height >= y + h;
+    if (fits) {
+        camera_conv_crop(format, frame->buf, frame->width, x, y, w, h, bin, out);
+    }
+    int64_t timestamp_us = frame->timestamp_us;
+    uint32_t sequence = frame->sequence;
+    mp_camera_hal_release_frame(self, frame->seq);
+    if (!fits) {
+        m_del(uint8_t, out, out_len);
+        mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("Frame does not match the frame size"));
+    }
+
+    if (encode) {
+        mp_obj_t jpeg = mp_camera_frame_new_jpeg(out, out_w, out_h, (mp_camera_pixformat_t)format,
+            mp_camera_hal_get_quality(self), CAMERA_JPEG_SUBSAMPLING_420, timestamp_us, sequence);
+        m_del(uint8_t, out, out_len);
+        if (jpeg == MP_OBJ_NULL) {
+            mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("Failed to convert image"));
+        }
+        return jpeg;
+    }
+    if (out_format >= 0) {
+        // Converting after cropping only touches the (small) output
+        size_t conv_len = out_w * out_h * camera_conv_bytes_per_pixel(out_format);
+        uint8_t *conv = m_new(uint8_t, conv_len);
+        camera_conv_convert(format, out, out_format, conv, out_w * out_h);
+        m_del(uint8_t, out, out_len);
+        out = conv;
+        out_len = conv_len;
+        format = out_format;
+    }
+    return mp_camera_frame_new(NULL, 0, out, out_len, out_w, out_h, (mp_camera_pixformat_t)format, timestamp_us, sequence);
+}
+
 // Main methods
-static mp_obj_t camera_capture(mp_obj_t self_in){
+static mp_obj_t camera_capture(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args){
+    mp_camera_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    enum { ARG_out_format, ARG_hold, ARG_roi, ARG_bin };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_out_format, MP_ARG_OBJ, {.u_obj = MP_ROM_NONE} },
+        { MP_QSTR_hold, MP_ARG_BOOL | MP_ARG_KW_ONLY, {.u_bool = false} },
+        { MP_QSTR_roi, MP_ARG_OBJ | MP_ARG_KW_ONLY, {.u_obj = MP_ROM_NONE} },
+        { MP_QSTR_bin, MP_ARG_INT | MP_ARG_KW_ONLY, {.u_int = 1} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    int8_t out_format = args[ARG_out_format].u_obj != MP_ROM_NONE
+        ? mp_obj_get_int(args[ARG_out_format].u_obj)
+        : -1;
+    if (args[ARG_roi].u_obj != MP_ROM_NONE || args[ARG_bin].u_int != 1) {
+        return capture_region(self, args[ARG_roi].u_obj, args[ARG_bin].u_int, out_format);
+    }
+    return mp_camera_hal_capture(self, out_format, args[ARG_hold].u_bool);
+}
+static MP_DEFINE_CONST_FUN_OBJ_KW(camera_capture_obj, 1, camera_capture);
+
+static mp_obj_t camera_capture_into(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args){
+    mp_camera_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    enum { ARG_buf, ARG_out_format };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_buf, MP_ARG_OBJ | MP_ARG_REQUIRED },
+        { MP_QSTR_out_format, MP_ARG_OBJ, {.u_obj = MP_ROM_NONE} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[ARG_buf].u_obj, &bufinfo, MP_BUFFER_WRITE);
+    int8_t out_format = args[ARG_out_format].u_obj != MP_ROM_NONE
+        ? mp_obj_get_int(args[ARG_out_format].u_obj)
+        : -1;
+    return mp_camera_hal_capture_into(self, bufinfo.buf, bufinfo.len, out_format);
+}
+static MP_DEFINE_CONST_FUN_OBJ_KW(camera_capture_into_obj, 2, camera_capture_into);
+
+// Runs scheduled (see mp_camera_hal_set_frame_callback) and passes the ready frame to the on_frame callback.
+// The frame goes back to the driver when the callback returns.
+static mp_obj_t camera_dispatch_frame(mp_obj_t self_in) {
+    mp_camera_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_t frame = mp_camera_hal_take_ready_frame(self);
+    if (frame != mp_const_none && MP_STATE_VM(mp_camera_on_frame) != MP_OBJ_NULL) {
+        mp_call_function_1_protected(MP_STATE_VM(mp_camera_on_frame), frame);
+    }
+    if (frame != mp_const_none) {
+        mp_camera_hal_release_frame(self, ((mp_camera_frame_obj_t *)MP_OBJ_TO_PTR(frame))->seq);
+    }
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(camera_dispatch_frame_obj, camera_dispatch_frame);
+
+static mp_obj_t camera_on_frame(mp_obj_t self_in, mp_obj_t callback) {
     mp_camera_obj_t *self = MP_OBJ_TO_PTR(self_in);
-    return mp_camera_hal_capture(self);
+    if (callback != mp_const_none && !mp_obj_is_callable(callback)) {
+        mp_raise_TypeError(MP_ERROR_TEXT("callback must be callable or None"));
+    }
+    if (callback == mp_const_none) {
+        mp_camera_hal_set_frame_callback(self, MP_OBJ_NULL);
+        MP_STATE_VM(mp_camera_on_frame) = MP_OBJ_NULL;
+    } else {
+        MP_STATE_VM(mp_camera_on_frame) = callback;
+        mp_camera_hal_set_frame_callback(self, MP_OBJ_FROM_PTR(&camera_dispatch_frame_obj));
+    }
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_2(camera_on_frame_obj, camera_on_frame);
+
+// Streams JPEG frames as multipart parts to sock, until the client disconnects or max_frames have been sent
+static mp_obj_t camera_stream_mjpeg(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    mp_camera_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    enum { ARG_sock, ARG_boundary, ARG_max_fps, ARG_max_frames };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_sock, MP_ARG_OBJ | MP_ARG_REQUIRED },
+        { MP_QSTR_boundary, MP_ARG_OBJ | MP_ARG_KW_ONLY, {.u_obj = MP_ROM_QSTR(MP_QSTR_frame)} },
+        { MP_QSTR_max_fps, MP_ARG_INT | MP_ARG_KW_ONLY, {.u_int = 0} },
+        { MP_QSTR_max_frames, MP_ARG_INT | MP_ARG_KW_ONLY, {.u_int = 0} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    if (mp_camera_hal_get_pixel_format(self) != PIXFORMAT_JPEG) {
+        mp_raise_ValueError(MP_ERROR_TEXT("stream_mjpeg needs PixelFormat.JPEG"));
+    }
+    size_t boundary_len;
+    const char *boundary = mp_obj_str_get_data(args[ARG_boundary].u_obj, &boundary_len);
+    mp_camera_mjpeg_writer_obj_t writer;
+    mp_camera_mjpeg_writer_init(&writer, args[ARG_sock].u_obj, boundary, boundary_len);
+
+    mp_int_t max_frames = args[ARG_max_frames].u_int;
+    mp_uint_t interval_ms = args[ARG_max_fps].u_int > 0 ? 1000 / args[ARG_max_fps].u_int : 0;
+    mp_uint_t next_ms = mp_hal_ticks_ms();
+    mp_int_t frames = 0;
+    while (max_frames <= 0 || frames < max_frames) {
+        if (interval_ms) {
+            mp_int_t wait_ms = (mp_int_t)(next_ms - mp_hal_ticks_ms());
+            if (wait_ms > 0) {
+                mp_hal_delay_ms(wait_ms);
+            }
+            next_ms += interval_ms;
+        }
+        mp_obj_t frame = mp_camera_hal_capture(self, -1, false);
+        if (frame == mp_const_none) {
+            mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("Failed to capture image"));
+        }
+        int errcode;
+        bool sent = mp_camera_mjpeg_writer_send(&writer, frame, &errcode);
+        // Give the frame buffer back while the client processes the frame
+        mp_camera_hal_release_frame(self, ((mp_camera_frame_obj_t *)MP_OBJ_TO_PTR(frame))->seq);
+        if (!sent) {
+            if (mp_camera_mjpeg_disconnected(errcode)) {
+                break;
+            }
+            mp_raise_OSError(errcode);
+        }
+        frames++;
+        mp_handle_pending(true);
+    }
+    return MP_OBJ_NEW_SMALL_INT(frames);
 }
-static MP_DEFINE_CONST_FUN_OBJ_1(camera_capture_obj, camera_capture);
+static MP_DEFINE_CONST_FUN_OBJ_KW(camera_stream_mjpeg_obj, 2, camera_stream_mjpeg);
 
 static mp_obj_t camera_frame_available(mp_obj_t self_in){
     mp_camera_obj_t *self = MP_OBJ_TO_PTR(self_in);
@@ -239,6 +453,93 @@ static mp_obj_t camera_free_buf(mp_obj_t self_in) {
 }
 static MP_DEFINE_CONST_FUN_OBJ_1(camera_free_buf_obj, camera_free_buf);
 
+static const uint32_t perf_bucket_bounds[MICROPY_CAMERA_PERF_BUCKETS - 1] = MICROPY_CAMERA_PERF_BUCKET_BOUNDS_US;
+
+void mp_camera_perf_record(mp_camera_perf_hist_t *hist, int64_t duration_us) {
+    uint32_t us = duration_us < 0 ? 0 : (duration_us > UINT32_MAX ? UINT32_MAX : (uint32_t)duration_us);
+    size_t bucket = 0;
+    while (bucket < MP_ARRAY_SIZE(perf_bucket_bounds) && us >= perf_bucket_bounds[bucket]) {
+        bucket++;
+    }
+    hist->buckets[bucket]++;
+    hist->count++;
+    hist->total_us += us;
+    if (us > hist->max_us) {
+        hist->max_us = us;
+    }
+}
+
+static mp_obj_t perf_hist_to_dict(const mp_camera_perf_hist_t *hist) {
+    mp_obj_t buckets[MICROPY_CAMERA_PERF_BUCKETS];
+    for (size_t i = 0; i < MICROPY_CAMERA_PERF_BUCKETS; i++) {
+        buckets[i] = mp_obj_new_int_from_uint(hist->buckets[i]);
+    }
+    mp_obj_t dict = mp_obj_new_dict(4);
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_count), mp_obj_new_int_from_uint(hist->count));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_mean_us), mp_obj_new_int_from_uint(hist->count ? hist->total_us / hist->count : 0));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_max_us), mp_obj_new_int_from_uint(hist->max_us));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_histogram), mp_obj_new_tuple(MICROPY_CAMERA_PERF_BUCKETS, buckets));
+    return dict;
+}
+
+static mp_obj_t camera_perf(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    mp_camera_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    enum { ARG_reset };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_reset, MP_ARG_BOOL, {.u_bool = false} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_camera_perf_t perf;
+    mp_camera_hal_get_perf(self, &perf, args[ARG_reset].u_bool);
+
+    mp_obj_t bucket_bounds[MP_ARRAY_SIZE(perf_bucket_bounds)];
+    for (size_t i = 0; i < MP_ARRAY_SIZE(perf_bucket_bounds); i++) {
+        bucket_bounds[i] = mp_obj_new_int_from_uint(perf_bucket_bounds[i]);
+    }
+
+    mp_obj_t dict = mp_obj_new_dict(10);
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_captures), mp_obj_new_int_from_uint(perf.captures));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_failed), mp_obj_new_int_from_uint(perf.failed));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_capture_rate), mp_obj_new_float(perf.elapsed_us > 0
+        ? (mp_float_t)perf.captures * MICROPY_FLOAT_CONST(1000000.0) / perf.elapsed_us
+        : 0));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_fb_get), perf_hist_to_dict(&perf.fb_get));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_hold), perf_hist_to_dict(&perf.hold));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_init), perf_hist_to_dict(&perf.init));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_reconfigure), perf_hist_to_dict(&perf.reconfigure));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_switch_sensor), perf_hist_to_dict(&perf.switch_sensor));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_buckets_us), mp_obj_new_tuple(MP_ARRAY_SIZE(bucket_bounds), bucket_bounds));
+    return dict;
+}
+static MP_DEFINE_CONST_FUN_OBJ_KW(camera_perf_obj, 1, camera_perf);
+
+static mp_obj_t camera_frame_stats(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    mp_camera_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    enum { ARG_reset };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_reset, MP_ARG_BOOL, {.u_bool = false} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_camera_frame_stats_t stats;
+    mp_camera_hal_get_frame_stats(self, &stats, args[ARG_reset].u_bool);
+    mp_obj_t dict = mp_obj_new_dict(5);
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_captured), mp_obj_new_int_from_uint(stats.captured));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_dropped), mp_obj_new_int_from_uint(stats.dropped));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_overwritten), mp_obj_new_int_from_uint(stats.overwritten));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_sequence), mp_obj_new_int_from_uint(stats.sequence));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_sensor_fps), stats.frame_period_us
+        ? mp_obj_new_float(MICROPY_FLOAT_CONST(1000000.0) / stats.frame_period_us)
+        : mp_const_none);
+    return dict;
+}
+static MP_DEFINE_CONST_FUN_OBJ_KW(camera_frame_stats_obj, 1, camera_frame_stats);
+
 static mp_obj_t camera_reconfigure(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args){
     mp_camera_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
     enum { ARG_frame_size, ARG_pixel_format, ARG_grab_mode, ARG_fb_count };
@@ -269,11 +570,165 @@ static mp_obj_t camera_reconfigure(size_t n_args, const mp_obj_t *pos_args, mp_m
         ?  args[ARG_fb_count].u_int
         : mp_camera_hal_get_fb_count(self);
     
-    mp_camera_hal_reconfigure(self, frame_size, pixel_format, grab_mode, fb_count);
-    return mp_const_none;
+    static const qstr applied[] = {
+        [MP_CAMERA_RECONFIGURE_NONE] = MP_QSTR_none,
+        [MP_CAMERA_RECONFIGURE_SENSOR] = MP_QSTR_sensor,
+        [MP_CAMERA_RECONFIGURE_RESTART] = MP_QSTR_restart,
+    };
+    return MP_OBJ_NEW_QSTR(applied[mp_camera_hal_reconfigure(self, frame_size, pixel_format, grab_mode, fb_count)]);
 }
 static MP_DEFINE_CONST_FUN_OBJ_KW(camera_reconfigure_obj, 1, camera_reconfigure);
 
+static const qstr setting_names[MP_CAMERA_SETTING_COUNT] = {
+    [MP_CAMERA_SETTING_EXPOSURE_CTRL] = MP_QSTR_exposure_ctrl,
+    [MP_CAMERA_SETTING_AEC2] = MP_QSTR_aec2,
+    [MP_CAMERA_SETTING_GAIN_CTRL] = MP_QSTR_gain_ctrl,
+    [MP_CAMERA_SETTING_WHITEBAL] = MP_QSTR_whitebal,
+    [MP_CAMERA_SETTING_AWB_GAIN] = MP_QSTR_awb_gain,
+    [MP_CAMERA_SETTING_AEC_VALUE] = MP_QSTR_aec_value,
+    [MP_CAMERA_SETTING_AE_LEVEL] = MP_QSTR_ae_level,
+    [MP_CAMERA_SETTING_AGC_GAIN] = MP_QSTR_agc_gain,
+    [MP_CAMERA_SETTING_GAINCEILING] = MP_QSTR_gainceiling,
+    [MP_CAMERA_SETTING_WB_MODE] = MP_QSTR_wb_mode,
+    [MP_CAMERA_SETTING_CONTRAST] = MP_QSTR_contrast,
+    [MP_CAMERA_SETTING_BRIGHTNESS] = MP_QSTR_brightness,
+    [MP_CAMERA_SETTING_SATURATION] = MP_QSTR_saturation,
+    [MP_CAMERA_SETTING_SHARPNESS] = MP_QSTR_sharpness,
+    [MP_CAMERA_SETTING_DENOISE] = MP_QSTR_denoise,
+    [MP_CAMERA_SETTING_QUALITY] = MP_QSTR_quality,
+    [MP_CAMERA_SETTING_SPECIAL_EFFECT] = MP_QSTR_special_effect,
+    [MP_CAMERA_SETTING_COLORBAR] = MP_QSTR_colorbar,
+    [MP_CAMERA_SETTING_HMIRROR] = MP_QSTR_hmirror,
+    [MP_CAMERA_SETTING_VFLIP] = MP_QSTR_vflip,
+    [MP_CAMERA_SETTING_DCW] = MP_QSTR_dcw,
+    [MP_CAMERA_SETTING_BPC] = MP_QSTR_bpc,
+    [MP_CAMERA_SETTING_WPC] = MP_QSTR_wpc,
+    [MP_CAMERA_SETTING_RAW_GMA] = MP_QSTR_raw_gma,
+    [MP_CAMERA_SETTING_LENC] = MP_QSTR_lenc,
+};
+
+// Names of the settings which did not take effect
+static mp_obj_t failed_settings(uint32_t failed) {
+    mp_obj_t names[MP_CAMERA_SETTING_COUNT];
+    size_t n_failed = 0;
+    for (size_t i = 0; i < MP_CAMERA_SETTING_COUNT; i++) {
+        if (failed & (1u << i)) {
+            names[n_failed++] = MP_OBJ_NEW_QSTR(setting_names[i]);
+        }
+    }
+    return mp_obj_new_tuple(n_failed, names);
+}
+
+// apply(settings, *, deferred=False): writes a dict of sensor settings as one batch
+static mp_obj_t camera_apply(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    mp_camera_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    enum { ARG_settings, ARG_deferred };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_settings, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_deferred, MP_ARG_BOOL | MP_ARG_KW_ONLY, {.u_bool = false} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    if (!mp_obj_is_type(args[ARG_settings].u_obj, &mp_type_dict)) {
+        mp_raise_TypeError(MP_ERROR_TEXT("settings must be a dict"));
+    }
+    mp_map_t *map = mp_obj_dict_get_map(args[ARG_settings].u_obj);
+    mp_camera_settings_t settings = { .mask = 0 };
+    for (size_t i = 0; i < map->alloc; i++) {
+        if (!mp_map_slot_is_filled(map, i)) {
+            continue;
+        }
+        qstr name = mp_obj_str_get_qstr(map->table[i].key);
+        size_t setting = 0;
+        while (setting < MP_CAMERA_SETTING_COUNT && setting_names[setting] != name) {
+            setting++;
+        }
+        if (setting == MP_CAMERA_SETTING_COUNT) {
+            mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("unknown setting '%q'"), name);
+        }
+        settings.value[setting] = mp_obj_get_int(map->table[i].value);
+        settings.mask |= 1u << setting;
+    }
+
+    return failed_settings(mp_camera_hal_apply_settings(self, &settings, args[ARG_deferred].u_bool));
+}
+static MP_DEFINE_CONST_FUN_OBJ_KW(camera_apply_obj, 2, camera_apply);
+
+// Snapshot format: "CS", version, number of settings, sensor id (LE16), frame size, 0, mask of the
+// recorded settings (LE32), the values of all settings in mp_camera_setting_t order (LE16)
+#define SNAPSHOT_VERSION        (1)
+#define SNAPSHOT_HEADER_SIZE    (12)
+
+static mp_obj_t camera_snapshot(mp_obj_t self_in) {
+    mp_camera_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_camera_settings_t settings;
+    mp_camera_hal_get_settings(self, &settings);
+    int sensor_id = mp_camera_hal_get_sensor_id(self);
+
+    uint8_t blob[SNAPSHOT_HEADER_SIZE + 2 * MP_CAMERA_SETTING_COUNT];
+    blob[0] = 'C';
+    blob[1] = 'S';
+    blob[2] = SNAPSHOT_VERSION;
+    blob[3] = MP_CAMERA_SETTING_COUNT;
+    blob[4] = sensor_id & 0xFF;
+    blob[5] = (sensor_id >> 8) & 0xFF;
+    blob[6] = mp_camera_hal_get_frame_size(self);
+    blob[7] = 0;
+    for (size_t i = 0; i < 4; i++) {
+        blob[8 + i] = (settings.mask >> (8 * i)) & 0xFF;
+    }
+    for (size_t i = 0; i < MP_CAMERA_SETTING_COUNT; i++) {
+        blob[SNAPSHOT_HEADER_SIZE + 2 * i] = settings.value[i] & 0xFF;
+        blob[SNAPSHOT_HEADER_SIZE + 2 * i + 1] = (settings.value[i] >> 8) & 0xFF;
+    }
+    return mp_obj_new_bytes(blob, sizeof(blob));
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(camera_snapshot_obj, camera_snapshot);
+
+// restore(snapshot, *, deferred=False): restores the frame size and applies the settings as one batch
+static mp_obj_t camera_restore(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    mp_camera_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    enum { ARG_snapshot, ARG_deferred };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_snapshot, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_deferred, MP_ARG_BOOL | MP_ARG_KW_ONLY, {.u_bool = false} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[ARG_snapshot].u_obj, &bufinfo, MP_BUFFER_READ);
+    const uint8_t *blob = bufinfo.buf;
+    // Snapshots of older versions with fewer settings can be restored
+    if (bufinfo.len < SNAPSHOT_HEADER_SIZE || blob[0] != 'C' || blob[1] != 'S' || blob[2] != SNAPSHOT_VERSION
+        || blob[3] > MP_CAMERA_SETTING_COUNT || bufinfo.len != SNAPSHOT_HEADER_SIZE + 2u * blob[3]) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid snapshot"));
+    }
+    if ((blob[4] | (blob[5] << 8)) != mp_camera_hal_get_sensor_id(self)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("snapshot of another sensor"));
+    }
+
+    mp_camera_settings_t settings;
+    settings.mask = 0;
+    for (size_t i = 0; i < 4; i++) {
+        settings.mask |= (uint32_t)blob[8 + i] << (8 * i);
+    }
+    settings.mask &= (1u << blob[3]) - 1;
+    for (size_t i = 0; i < blob[3]; i++) {
+        settings.value[i] = (int16_t)(blob[SNAPSHOT_HEADER_SIZE + 2 * i] | (blob[SNAPSHOT_HEADER_SIZE + 2 * i + 1] << 8));
+    }
+
+    // Restoring the frame size may restart the driver, which resets the sensor settings
+    if (blob[6] != mp_camera_hal_get_frame_size(self)) {
+        mp_camera_hal_set_frame_size(self, blob[6]);
+    }
+    return failed_settings(mp_camera_hal_apply_settings(self, &settings, args[ARG_deferred].u_bool));
+}
+static MP_DEFINE_CONST_FUN_OBJ_KW(camera_restore_obj, 2, camera_restore);
+
 static mp_obj_t camera_init(mp_obj_t self_in) {
     mp_camera_obj_t *self = MP_OBJ_TO_PTR(self_in);
     mp_camera_hal_init(self);
@@ -284,6 +739,7 @@ static MP_DEFINE_CONST_FUN_OBJ_1(camera_init_obj, camera_init);
 static mp_obj_t mp_camera_deinit(mp_obj_t self_in) {
     mp_camera_obj_t *self = MP_OBJ_TO_PTR(self_in);
     mp_camera_hal_deinit(self);
+    MP_STATE_VM(mp_camera_on_frame) = MP_OBJ_NULL;
     return mp_const_none;
 }
 static MP_DEFINE_CONST_FUN_OBJ_1(mp_camera_deinit_obj, mp_camera_deinit);
@@ -295,338 +751,168 @@ static mp_obj_t mp_camera_obj___exit__(size_t n_args, const mp_obj_t *args) {
 }
 static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_camera___exit___obj, 4, 4, mp_camera_obj___exit__);
 
-// Property handler
-static void camera_obj_property(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
-    mp_camera_obj_t *self = MP_OBJ_TO_PTR(self_in);
-    if (self->initialized == false) {
-        if (dest[0] == MP_OBJ_NULL) {
-            dest[1] = MP_OBJ_SENTINEL;
-        }
-        return;
-    }
+// Camera properties. One table drives the native attribute access, the property objects found by
+// subclasses and the get_/set_ methods.
+// Read-only: name, conversion to Python, requires an initialized camera
+#define CAMERA_PROPERTIES_RO(X) \
+    X(pixel_format,   MP_OBJ_NEW_SMALL_INT,     false) \
+    X(grab_mode,      MP_OBJ_NEW_SMALL_INT,     false) \
+    X(fb_count,       MP_OBJ_NEW_SMALL_INT,     false) \
+    X(pixel_width,    mp_obj_new_int,           true) \
+    X(pixel_height,   mp_obj_new_int,           true) \
+    X(max_frame_size, MP_OBJ_NEW_SMALL_INT,     true) \
+    X(sensor_name,    mp_obj_new_str_from_cstr, true)
 
-    if (dest[0] == MP_OBJ_NULL) {
-        // Load (reading)
-        switch (attr) {
-            // Read-only properties
-            case MP_QSTR_pixel_format:
-                dest[0] = MP_OBJ_NEW_SMALL_INT(mp_camera_hal_get_pixel_format(self));
-                break;
-            case MP_QSTR_grab_mode:
-                dest[0] = MP_OBJ_NEW_SMALL_INT(mp_camera_hal_get_grab_mode(self));
-                break;
-            case MP_QSTR_fb_count:
-                dest[0] = MP_OBJ_NEW_SMALL_INT(mp_camera_hal_get_fb_count(self));
-                break;
-            case MP_QSTR_pixel_width:
-                dest[0] = mp_obj_new_int(mp_camera_hal_get_pixel_width(self));
-                break;
-            case MP_QSTR_pixel_height:
-                dest[0] = mp_obj_new_int(mp_camera_hal_get_pixel_height(self));
-                break;
-            case MP_QSTR_max_frame_size:
-                dest[0] = MP_OBJ_NEW_SMALL_INT(mp_camera_hal_get_max_frame_size(self));
-                break;
-            case MP_QSTR_sensor_name:
-                dest[0] = mp_obj_new_str_from_cstr(mp_camera_hal_get_sensor_name(self));
-                break;
+// Read-write (all require an initialized camera): name, conversion to Python, conversion from Python
+#define CAMERA_PROPERTIES_RW(X) \
+    X(frame_size,     MP_OBJ_NEW_SMALL_INT, mp_obj_get_int) \
+    X(contrast,       MP_OBJ_NEW_SMALL_INT, mp_obj_get_int) \
+    X(brightness,     MP_OBJ_NEW_SMALL_INT, mp_obj_get_int) \
+    X(saturation,     MP_OBJ_NEW_SMALL_INT, mp_obj_get_int) \
+    X(sharpness,      MP_OBJ_NEW_SMALL_INT, mp_obj_get_int) \
+    X(denoise,        MP_OBJ_NEW_SMALL_INT, mp_obj_get_int) \
+    X(gainceiling,    MP_OBJ_NEW_SMALL_INT, mp_obj_get_int) \
+    X(quality,        MP_OBJ_NEW_SMALL_INT, mp_obj_get_int) \
+    X(colorbar,       mp_obj_new_bool,      mp_obj_is_true) \
+    X(whitebal,       mp_obj_new_bool,      mp_obj_is_true) \
+    X(gain_ctrl,      mp_obj_new_bool,      mp_obj_is_true) \
+    X(exposure_ctrl,  mp_obj_new_bool,      mp_obj_is_true) \
+    X(hmirror,        mp_obj_new_bool,      mp_obj_is_true) \
+    X(vflip,          mp_obj_new_bool,      mp_obj_is_true) \
+    X(aec2,           mp_obj_new_bool,      mp_obj_is_true) \
+    X(awb_gain,       mp_obj_new_bool,      mp_obj_is_true) \
+    X(agc_gain,       MP_OBJ_NEW_SMALL_INT, mp_obj_get_int) \
+    X(aec_value,      MP_OBJ_NEW_SMALL_INT, mp_obj_get_int) \
+    X(special_effect, MP_OBJ_NEW_SMALL_INT, mp_obj_get_int) \
+    X(wb_mode,        MP_OBJ_NEW_SMALL_INT, mp_obj_get_int) \
+    X(ae_level,       MP_OBJ_NEW_SMALL_INT, mp_obj_get_int) \
+    X(dcw,            mp_obj_new_bool,      mp_obj_is_true) \
+    X(bpc,            mp_obj_new_bool,      mp_obj_is_true) \
+    X(wpc,            mp_obj_new_bool,      mp_obj_is_true) \
+    X(raw_gma,        mp_obj_new_bool,      mp_obj_is_true) \
+    X(lenc,           mp_obj_new_bool,      mp_obj_is_true)
 
-            // Read-write properties
-            case MP_QSTR_frame_size:
-                dest[0] = MP_OBJ_NEW_SMALL_INT(mp_camera_hal_get_frame_size(self));
-                break;
-            case MP_QSTR_contrast:
-                dest[0] = MP_OBJ_NEW_SMALL_INT(mp_camera_hal_get_contrast(self));
-                break;
-            case MP_QSTR_brightness:
-                dest[0] = MP_OBJ_NEW_SMALL_INT(mp_camera_hal_get_brightness(self));
-                break;
-            case MP_QSTR_saturation:
-                dest[0] = MP_OBJ_NEW_SMALL_INT(mp_camera_hal_get_saturation(self));
-                break;
-            case MP_QSTR_sharpness:
-                dest[0] = MP_OBJ_NEW_SMALL_INT(mp_camera_hal_get_sharpness(self));
-                break;
-            case MP_QSTR_denoise:
-                dest[0] = MP_OBJ_NEW_SMALL_INT(mp_camera_hal_get_denoise(self));
-                break;
-            case MP_QSTR_gainceiling:
-                dest[0] = MP_OBJ_NEW_SMALL_INT(mp_camera_hal_get_gainceiling(self));
-                break;
-            case MP_QSTR_quality:
-                dest[0] = MP_OBJ_NEW_SMALL_INT(mp_camera_hal_get_quality(self));
-                break;
-            case MP_QSTR_colorbar:
-                dest[0] = mp_obj_new_bool(mp_camera_hal_get_colorbar(self));
-                break;
-            case MP_QSTR_whitebal:
-                dest[0] = mp_obj_new_bool(mp_camera_hal_get_whitebal(self));
-                break;
-            case MP_QSTR_gain_ctrl:
-                dest[0] = mp_obj_new_bool(mp_camera_hal_get_gain_ctrl(self));
-                break;
-            case MP_QSTR_exposure_ctrl:
-                dest[0] = mp_obj_new_bool(mp_camera_hal_get_exposure_ctrl(self));
-                break;
-            case MP_QSTR_hmirror:
-                dest[0] = mp_obj_new_bool(mp_camera_hal_get_hmirror(self));
-                break;
-            case MP_QSTR_vflip:
-                dest[0] = mp_obj_new_bool(mp_camera_hal_get_vflip(self));
-                break;
-            case MP_QSTR_aec2:
-                dest[0] = mp_obj_new_bool(mp_camera_hal_get_aec2(self));
-                break;
-            case MP_QSTR_awb_gain:
-                dest[0] = mp_obj_new_bool(mp_camera_hal_get_awb_gain(self));
-                break;
-            case MP_QSTR_agc_gain:
-                dest[0] = MP_OBJ_NEW_SMALL_INT(mp_camera_hal_get_agc_gain(self));
-                break;
-            case MP_QSTR_aec_value:
-                dest[0] = MP_OBJ_NEW_SMALL_INT(mp_camera_hal_get_aec_value(self));
-                break;
-            case MP_QSTR_special_effect:
-                dest[0] = MP_OBJ_NEW_SMALL_INT(mp_camera_hal_get_special_effect(self));
-                break;
-            case MP_QSTR_wb_mode:
-                dest[0] = MP_OBJ_NEW_SMALL_INT(mp_camera_hal_get_wb_mode(self));
-                break;
-            case MP_QSTR_ae_level:
-                dest[0] = MP_OBJ_NEW_SMALL_INT(mp_camera_hal_get_ae_level(self));
-                break;
-            case MP_QSTR_dcw:
-                dest[0] = mp_obj_new_bool(mp_camera_hal_get_dcw(self));
-                break;
-            case MP_QSTR_bpc:
-                dest[0] = mp_obj_new_bool(mp_camera_hal_get_bpc(self));
-                break;
-            case MP_QSTR_wpc:
-                dest[0] = mp_obj_new_bool(mp_camera_hal_get_wpc(self));
-                break;
-            case MP_QSTR_raw_gma:
-                dest[0] = mp_obj_new_bool(mp_camera_hal_get_raw_gma(self));
-                break;
-            case MP_QSTR_lenc:
-                dest[0] = mp_obj_new_bool(mp_camera_hal_get_lenc(self));
-                break;
-            default:
-                // Delegate to locals_dict
-                dest[1] = MP_OBJ_SENTINEL;
-                return;
-        }
-    } else if (dest[0] == MP_OBJ_SENTINEL && dest[1] != MP_OBJ_NULL) {
-        // Store (writing)
-        switch (attr) {
-            // Read-only properties
-            case MP_QSTR_pixel_format:
-            case MP_QSTR_grab_mode:
-            case MP_QSTR_fb_count:
-            case MP_QSTR_pixel_width:
-            case MP_QSTR_pixel_height:
-            case MP_QSTR_max_frame_size:
-            case MP_QSTR_sensor_name:
-                mp_raise_ValueError(MP_ERROR_TEXT("read-only property"));
-                break;
+// The properties are ROM property objects (mp_rom_obj_property_t), so Python subclasses find them in the locals dict
+// and the runtime calls the native getter and setter.
 
-            // Read-write properties
-            case MP_QSTR_frame_size:
-                mp_camera_hal_set_frame_size(self, mp_obj_get_int(dest[1]));
-                break;
-            case MP_QSTR_contrast:
-                mp_camera_hal_set_contrast(self, mp_obj_get_int(dest[1]));
-                break;
-            case MP_QSTR_brightness:
-                mp_camera_hal_set_brightness(self, mp_obj_get_int(dest[1]));
-                break;
-            case MP_QSTR_saturation:
-                mp_camera_hal_set_saturation(self, mp_obj_get_int(dest[1]));
-                break;
-            case MP_QSTR_sharpness:
-                mp_camera_hal_set_sharpness(self, mp_obj_get_int(dest[1]));
-                break;
-            case MP_QSTR_denoise:
-                mp_camera_hal_set_denoise(self, mp_obj_get_int(dest[1]));
-                break;
-            case MP_QSTR_gainceiling:
-                mp_camera_hal_set_gainceiling(self, mp_obj_get_int(dest[1]));
-                break;
-            case MP_QSTR_quality:
-                mp_camera_hal_set_quality(self, mp_obj_get_int(dest[1]));
-                break;
-            case MP_QSTR_colorbar:
-                mp_camera_hal_set_colorbar(self, mp_obj_is_true(dest[1]));
-                break;
-            case MP_QSTR_whitebal:
-                mp_camera_hal_set_whitebal(self, mp_obj_is_true(dest[1]));
-                break;
-            case MP_QSTR_gain_ctrl:
-                mp_camera_hal_set_gain_ctrl(self, mp_obj_is_true(dest[1]));
-                break;
-            case MP_QSTR_exposure_ctrl:
-                mp_camera_hal_set_exposure_ctrl(self, mp_obj_is_true(dest[1]));
-                break;
-            case MP_QSTR_hmirror:
-                mp_camera_hal_set_hmirror(self, mp_obj_is_true(dest[1]));
-                break;
-            case MP_QSTR_vflip:
-                mp_camera_hal_set_vflip(self, mp_obj_is_true(dest[1]));
-                break;
-            case MP_QSTR_aec2:
-                mp_camera_hal_set_aec2(self, mp_obj_is_true(dest[1]));
-                break;
-            case MP_QSTR_awb_gain:
-                mp_camera_hal_set_awb_gain(self, mp_obj_is_true(dest[1]));
-                break;
-            case MP_QSTR_agc_gain:
-                mp_camera_hal_set_agc_gain(self, mp_obj_get_int(dest[1]));
-                break;
-            case MP_QSTR_aec_value:
-                mp_camera_hal_set_aec_value(self, mp_obj_get_int(dest[1]));
-                break;
-            case MP_QSTR_special_effect:
-                mp_camera_hal_set_special_effect(self, mp_obj_get_int(dest[1]));
-                break;
-            case MP_QSTR_wb_mode:
-                mp_camera_hal_set_wb_mode(self, mp_obj_get_int(dest[1]));
-                break;
-            case MP_QSTR_ae_level:
-                mp_camera_hal_set_ae_level(self, mp_obj_get_int(dest[1]));
-                break;
-            case MP_QSTR_dcw:
-                mp_camera_hal_set_dcw(self, mp_obj_is_true(dest[1]));
-                break;
-            case MP_QSTR_bpc:
-                mp_camera_hal_set_bpc(self, mp_obj_is_true(dest[1]));
-                break;
-            case MP_QSTR_wpc:
-                mp_camera_hal_set_wpc(self, mp_obj_is_true(dest[1]));
-                break;
-            case MP_QSTR_raw_gma:
-                mp_camera_hal_set_raw_gma(self, mp_obj_is_true(dest[1]));
-                break;
-            case MP_QSTR_lenc:
-                mp_camera_hal_set_lenc(self, mp_obj_is_true(dest[1]));
-                break;
-            default:
-                // Delegate to locals_dict for methods not handled here
-                return;
-        }
-        // Success - indicate attribute was stored
-        dest[0] = MP_OBJ_NULL;
+// The accessors are called with a Camera or an instance of a Python subclass of it
+static mp_camera_obj_t *camera_property_self(mp_obj_t self_in, bool requires_init) {
+    mp_camera_obj_t *self = MP_OBJ_TO_PTR(mp_obj_cast_to_native_base(self_in, MP_OBJ_FROM_PTR(&camera_type)));
+    if (requires_init && !self->initialized) {
+        mp_raise_OSError(MP_ENOENT);
     }
+    return self;
 }
 
-// Camera property functions
-// Camera sensor property functions
-#define CREATE_GETTER(property, get_function) \
-    static mp_obj_t camera_get_##property(const mp_obj_t self_in) { \
-        mp_camera_obj_t *self = MP_OBJ_TO_PTR(self_in); \
-        return get_function(mp_camera_hal_get_##property(self)); \
+#define CAMERA_GETTER(name, to_obj, requires_init) \
+    static mp_obj_t camera_get_##name(mp_obj_t self_in) { \
+        return to_obj(mp_camera_hal_get_##name(camera_property_self(self_in, requires_init))); \
     } \
-    static MP_DEFINE_CONST_FUN_OBJ_1(camera_get_##property##_obj, camera_get_##property);
-
-#define CREATE_SETTER(property, set_conversion) \
-    static mp_obj_t camera_set_##property(const mp_obj_t self_in, const mp_obj_t arg) { \
-        mp_camera_obj_t *self = MP_OBJ_TO_PTR(self_in); \
-        mp_camera_hal_set_##property(self, set_conversion(arg)); \
-        if (mp_camera_hal_get_##property(self) != set_conversion(arg)) { \
-            mp_warning(NULL,"Failed to set " #property); \
-        }; \
+    static MP_DEFINE_CONST_FUN_OBJ_1(camera_get_##name##_obj, camera_get_##name);
+
+#define CAMERA_PROPERTY_RO(name, to_obj, requires_init) \
+    CAMERA_GETTER(name, to_obj, requires_init) \
+    static const mp_rom_obj_property_t camera_##name##_property = { \
+        { &mp_type_property }, \
+        { MP_ROM_PTR(&camera_get_##name##_obj), MP_ROM_NONE, MP_ROM_NONE } \
+    };
+
+#define CAMERA_PROPERTY_RW(name, to_obj, from_obj) \
+    CAMERA_GETTER(name, to_obj, true) \
+    static mp_obj_t camera_set_##name(mp_obj_t self_in, mp_obj_t value) { \
+        mp_camera_hal_set_##name(camera_property_self(self_in, true), from_obj(value)); \
         return mp_const_none; \
     } \
-    static MP_DEFINE_CONST_FUN_OBJ_2(camera_set_##property##_obj, camera_set_##property);
-
-#define CREATE_GETSET_FUNCTIONS(property, get_function, set_conversion) \
-    CREATE_GETTER(property, get_function) \
-    CREATE_SETTER(property, set_conversion)
-
-// Create table property entry
-#define ADD_PROPERTY_TO_TABLE(property) \
-    { MP_ROM_QSTR(MP_QSTR_get_##property), MP_ROM_PTR(&camera_get_##property##_obj) }, \
-    { MP_ROM_QSTR(MP_QSTR_set_##property), MP_ROM_PTR(&camera_set_##property##_obj) }
-
-CREATE_GETSET_FUNCTIONS(frame_size, MP_OBJ_NEW_SMALL_INT, mp_obj_get_int);
-CREATE_GETTER(pixel_format, MP_OBJ_NEW_SMALL_INT);
-CREATE_GETTER(grab_mode, MP_OBJ_NEW_SMALL_INT);
-CREATE_GETTER(fb_count, MP_OBJ_NEW_SMALL_INT);
-CREATE_GETTER(pixel_width, mp_obj_new_int);
-CREATE_GETTER(pixel_height, mp_obj_new_int);
-CREATE_GETTER(max_frame_size, MP_OBJ_NEW_SMALL_INT);
-CREATE_GETTER(sensor_name, mp_obj_new_str_from_cstr);
-CREATE_GETSET_FUNCTIONS(contrast, MP_OBJ_NEW_SMALL_INT, mp_obj_get_int);
-CREATE_GETSET_FUNCTIONS(brightness, MP_OBJ_NEW_SMALL_INT, mp_obj_get_int);
-CREATE_GETSET_FUNCTIONS(saturation, MP_OBJ_NEW_SMALL_INT, mp_obj_get_int);
-CREATE_GETSET_FUNCTIONS(sharpness, MP_OBJ_NEW_SMALL_INT, mp_obj_get_int);
-CREATE_GETSET_FUNCTIONS(denoise, MP_OBJ_NEW_SMALL_INT, mp_obj_get_int);
-CREATE_GETSET_FUNCTIONS(gainceiling, MP_OBJ_NEW_SMALL_INT, mp_obj_get_int);
-CREATE_GETSET_FUNCTIONS(quality, MP_OBJ_NEW_SMALL_INT, mp_obj_get_int);
-CREATE_GETSET_FUNCTIONS(colorbar, mp_obj_new_bool, mp_obj_is_true);
-CREATE_GETSET_FUNCTIONS(whitebal, mp_obj_new_bool, mp_obj_is_true);
-CREATE_GETSET_FUNCTIONS(gain_ctrl, mp_obj_new_bool, mp_obj_is_true);
-CREATE_GETSET_FUNCTIONS(exposure_ctrl, mp_obj_new_bool, mp_obj_is_true);
-CREATE_GETSET_FUNCTIONS(hmirror, mp_obj_new_bool, mp_obj_is_true);
-CREATE_GETSET_FUNCTIONS(vflip, mp_obj_new_bool, mp_obj_is_true);
-CREATE_GETSET_FUNCTIONS(aec2, mp_obj_new_bool, mp_obj_is_true);
-CREATE_GETSET_FUNCTIONS(awb_gain, mp_obj_new_bool, mp_obj_is_true);
-CREATE_GETSET_FUNCTIONS(agc_gain, MP_OBJ_NEW_SMALL_INT, mp_obj_get_int);
-CREATE_GETSET_FUNCTIONS(aec_value, MP_OBJ_NEW_SMALL_INT, mp_obj_get_int);
-CREATE_GETSET_FUNCTIONS(special_effect, MP_OBJ_NEW_SMALL_INT, mp_obj_get_int);
-CREATE_GETSET_FUNCTIONS(wb_mode, MP_OBJ_NEW_SMALL_INT, mp_obj_get_int);
-CREATE_GETSET_FUNCTIONS(ae_level, MP_OBJ_NEW_SMALL_INT, mp_obj_get_int);
-CREATE_GETSET_FUNCTIONS(dcw, mp_obj_new_bool, mp_obj_is_true);
-CREATE_GETSET_FUNCTIONS(bpc, mp_obj_new_bool, mp_obj_is_true);
-CREATE_GETSET_FUNCTIONS(wpc, mp_obj_new_bool, mp_obj_is_true);
-CREATE_GETSET_FUNCTIONS(raw_gma, mp_obj_new_bool, mp_obj_is_true);
-CREATE_GETSET_FUNCTIONS(lenc, mp_obj_new_bool, mp_obj_is_true);
+    static MP_DEFINE_CONST_FUN_OBJ_2(camera_set_##name##_obj, camera_set_##name); \
+    static const mp_rom_obj_property_t camera_##name##_property = { \
+        { &mp_type_property }, \
+        { MP_ROM_PTR(&camera_get_##name##_obj), MP_ROM_PTR(&camera_set_##name##_obj), MP_ROM_NONE } \
+    };
+
+CAMERA_PROPERTIES_RO(CAMERA_PROPERTY_RO)
+CAMERA_PROPERTIES_RW(CAMERA_PROPERTY_RW)
+
+// The switch on the qstr compiles into a binary search
+static const mp_rom_obj_property_t *camera_find_property(qstr attr) {
+    switch (attr) {
+        #define CAMERA_PROPERTY_CASE(name, ...) case MP_QSTR_##name: return &camera_##name##_property;
+        CAMERA_PROPERTIES_RO(CAMERA_PROPERTY_CASE)
+        CAMERA_PROPERTIES_RW(CAMERA_PROPERTY_CASE)
+        #undef CAMERA_PROPERTY_CASE
+        default:
+            return NULL;
+    }
+}
+
+static void camera_obj_property(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
+    const mp_rom_obj_property_t *property = camera_find_property(attr);
+    if (property == NULL) {
+        if (dest[0] == MP_OBJ_NULL) {
+            dest[1] = MP_OBJ_SENTINEL;  // Delegate to locals_dict
+        }
+        return;
+    }
+    const mp_obj_t *proxy = mp_obj_property_get(MP_OBJ_FROM_PTR(property));
+    if (dest[0] == MP_OBJ_NULL) {
+        dest[0] = mp_call_function_1(proxy[0], self_in);
+    } else if (dest[1] != MP_OBJ_NULL && proxy[1] != mp_const_none) {
+        mp_call_function_2(proxy[1], self_in, dest[1]);
+        dest[0] = MP_OBJ_NULL;
+    }
+    // Stores to read-only properties stay unhandled, so they raise AttributeError as on subclasses
+}
 
 //API-Tables
 static const mp_rom_map_elem_t camera_camera_locals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_reconfigure), MP_ROM_PTR(&camera_reconfigure_obj) },
+    { MP_ROM_QSTR(MP_QSTR_apply), MP_ROM_PTR(&camera_apply_obj) },
+    { MP_ROM_QSTR(MP_QSTR_snapshot), MP_ROM_PTR(&camera_snapshot_obj) },
+    { MP_ROM_QSTR(MP_QSTR_restore), MP_ROM_PTR(&camera_restore_obj) },
     { MP_ROM_QSTR(MP_QSTR_capture), MP_ROM_PTR(&camera_capture_obj) },
+    { MP_ROM_QSTR(MP_QSTR_capture_into), MP_ROM_PTR(&camera_capture_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_on_frame), MP_ROM_PTR(&camera_on_frame_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stream_mjpeg), MP_ROM_PTR(&camera_stream_mjpeg_obj) },
     { MP_ROM_QSTR(MP_QSTR_frame_available), MP_ROM_PTR(&camera_frame_available_obj) },
     { MP_ROM_QSTR(MP_QSTR_free_buffer), MP_ROM_PTR(&camera_free_buf_obj) },
+    { MP_ROM_QSTR(MP_QSTR_frame_stats), MP_ROM_PTR(&camera_frame_stats_obj) },
+    { MP_ROM_QSTR(MP_QSTR_perf), MP_ROM_PTR(&camera_perf_obj) },
     { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&camera_init_obj) },
     { MP_ROM_QSTR(MP_QSTR_deinit), MP_ROM_PTR(&mp_camera_deinit_obj) },
     { MP_ROM_QSTR(MP_QSTR___del__), MP_ROM_PTR(&mp_camera_deinit_obj) },
     { MP_ROM_QSTR(MP_QSTR___enter__), MP_ROM_PTR(&mp_identity_obj) },
     { MP_ROM_QSTR(MP_QSTR___exit__), MP_ROM_PTR(&mp_camera___exit___obj) },
-    { MP_ROM_QSTR(MP_QSTR_get_pixel_format), MP_ROM_PTR(&camera_get_pixel_format_obj) },
-    { MP_ROM_QSTR(MP_QSTR_get_grab_mode), MP_ROM_PTR(&camera_get_grab_mode_obj) },
-    { MP_ROM_QSTR(MP_QSTR_get_fb_count), MP_ROM_PTR(&camera_get_fb_count_obj) },
-    { MP_ROM_QSTR(MP_QSTR_get_pixel_width), MP_ROM_PTR(&camera_get_pixel_width_obj) },
-    { MP_ROM_QSTR(MP_QSTR_get_pixel_height), MP_ROM_PTR(&camera_get_pixel_height_obj) },
-    { MP_ROM_QSTR(MP_QSTR_get_max_frame_size), MP_ROM_PTR(&camera_get_max_frame_size_obj) },
-    { MP_ROM_QSTR(MP_QSTR_get_sensor_name), MP_ROM_PTR(&camera_get_sensor_name_obj) },
-    ADD_PROPERTY_TO_TABLE(frame_size),
-    ADD_PROPERTY_TO_TABLE(contrast),
-    ADD_PROPERTY_TO_TABLE(brightness),
-    ADD_PROPERTY_TO_TABLE(saturation),
-    ADD_PROPERTY_TO_TABLE(sharpness),
-    ADD_PROPERTY_TO_TABLE(denoise),
-    ADD_PROPERTY_TO_TABLE(gainceiling),
-    ADD_PROPERTY_TO_TABLE(quality),
-    ADD_PROPERTY_TO_TABLE(colorbar),
-    ADD_PROPERTY_TO_TABLE(whitebal),
-    ADD_PROPERTY_TO_TABLE(gain_ctrl),
-    ADD_PROPERTY_TO_TABLE(exposure_ctrl),
-    ADD_PROPERTY_TO_TABLE(hmirror),
-    ADD_PROPERTY_TO_TABLE(vflip),
-    ADD_PROPERTY_TO_TABLE(aec2),
-    ADD_PROPERTY_TO_TABLE(awb_gain),
-    ADD_PROPERTY_TO_TABLE(agc_gain),
-    ADD_PROPERTY_TO_TABLE(aec_value),
-    ADD_PROPERTY_TO_TABLE(special_effect),
-    ADD_PROPERTY_TO_TABLE(wb_mode),
-    ADD_PROPERTY_TO_TABLE(ae_level),
-    ADD_PROPERTY_TO_TABLE(dcw),
-    ADD_PROPERTY_TO_TABLE(bpc),
-    ADD_PROPERTY_TO_TABLE(wpc),
-    ADD_PROPERTY_TO_TABLE(raw_gma),
-    ADD_PROPERTY_TO_TABLE(lenc),
+    #define CAMERA_PROPERTY_ENTRIES_RO(name, ...) \
+        { MP_ROM_QSTR(MP_QSTR_##name), MP_ROM_PTR(&camera_##name##_property) }, \
+        { MP_ROM_QSTR(MP_QSTR_get_##name), MP_ROM_PTR(&camera_get_##name##_obj) },
+    #define CAMERA_PROPERTY_ENTRIES_RW(name, ...) \
+        CAMERA_PROPERTY_ENTRIES_RO(name, ) \
+        { MP_ROM_QSTR(MP_QSTR_set_##name), MP_ROM_PTR(&camera_set_##name##_obj) },
+    CAMERA_PROPERTIES_RO(CAMERA_PROPERTY_ENTRIES_RO)
+    CAMERA_PROPERTIES_RW(CAMERA_PROPERTY_ENTRIES_RW)
+    #undef CAMERA_PROPERTY_ENTRIES_RO
+    #undef CAMERA_PROPERTY_ENTRIES_RW
 };
 static MP_DEFINE_CONST_DICT(camera_camera_locals_dict, camera_camera_locals_table);
 
+// Stream protocol: the camera can be polled (select.poll, asyncio) until a frame is ready
+static mp_uint_t camera_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_t arg, int *errcode) {
+    // self_in may be an instance of a Python subclass (e.g. acamera.Camera)
+    mp_camera_obj_t *self = MP_OBJ_TO_PTR(mp_obj_cast_to_native_base(self_in, MP_OBJ_FROM_PTR(&camera_type)));
+    if (request == MP_STREAM_POLL) {
+        if (!mp_camera_hal_initialized(self)) {
+            *errcode = MP_ENOENT;
+            return MP_STREAM_ERROR;
+        }
+        return (arg & MP_STREAM_POLL_RD) && mp_camera_hal_frame_ready(self) ? MP_STREAM_POLL_RD : 0;
+    }
+    *errcode = MP_EINVAL;
+    return MP_STREAM_ERROR;
+}
+
+static const mp_stream_p_t camera_stream_p = {
+    .ioctl = camera_ioctl,
+};
+
 //Helper methods
 static void mp_camera_hal_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
     mp_camera_obj_t *self = MP_OBJ_TO_PTR(self_in);
@@ -658,6 +944,73 @@ MP_CREATE_CONST_TYPE(GainCeiling, mp_camera_gainceiling);
 static MP_DEFINE_CONST_DICT(mp_camera_grab_mode_locals_dict,mp_camera_hal_grab_mode_table);
 MP_CREATE_CONST_TYPE(GrabMode, mp_camera_grab_mode);
 
+// Module functions
+static mp_obj_t mp_camera_convert(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_src, ARG_src_format, ARG_dst_format, ARG_out };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_src, MP_ARG_OBJ | MP_ARG_REQUIRED },
+        { MP_QSTR_src_format, MP_ARG_INT | MP_ARG_REQUIRED },
+        { MP_QSTR_dst_format, MP_ARG_INT | MP_ARG_REQUIRED },
+        { MP_QSTR_out, MP_ARG_OBJ | MP_ARG_KW_ONLY, {.u_obj = MP_ROM_NONE} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    camera_conv_format_t src_format = args[ARG_src_format].u_int;
+    camera_conv_format_t dst_format = args[ARG_dst_format].u_int;
+    if (!camera_conv_supported(src_format, dst_format)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("Unsupported conversion"));
+    }
+
+    mp_buffer_info_t src;
+    mp_get_buffer_raise(args[ARG_src].u_obj, &src, MP_BUFFER_READ);
+    size_t pixels = src.len / camera_conv_bytes_per_pixel(src_format);
+    if (src_format == CAMERA_CONV_YUV422) {
+        pixels &= ~(size_t)1;   // YUV422 is converted in pairs of pixels, a trailing odd pixel is not converted
+    }
+    size_t dst_len = pixels * camera_conv_bytes_per_pixel(dst_format);
+
+    if (args[ARG_out].u_obj != mp_const_none) {
+        mp_buffer_info_t dst;
+        mp_get_buffer_raise(args[ARG_out].u_obj, &dst, MP_BUFFER_WRITE);
+        if (dst.len < dst_len) {
+            mp_raise_ValueError(MP_ERROR_TEXT("Output buffer too small"));
+        }
+        return mp_obj_new_int_from_uint(camera_conv_convert(src_format, src.buf, dst_format, dst.buf, pixels));
+    }
+
+    uint8_t *dst = m_new(uint8_t, dst_len);
+    camera_conv_convert(src_format, src.buf, dst_format, dst, pixels);
+    return mp_obj_new_bytearray_by_ref(dst_len, dst);
+}
+static MP_DEFINE_CONST_FUN_OBJ_KW(mp_camera_convert_obj, 3, mp_camera_convert);
+
+static mp_obj_t mp_camera_estimate_memory(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_frame_size, ARG_pixel_format, ARG_fb_count };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_frame_size, MP_ARG_INT | MP_ARG_REQUIRED },
+        { MP_QSTR_pixel_format, MP_ARG_INT | MP_ARG_REQUIRED },
+        { MP_QSTR_fb_count, MP_ARG_INT, {.u_int = 1} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_camera_memory_plan_t plan;
+    mp_camera_hal_plan_memory(&mp_camera_singleton, args[ARG_frame_size].u_int, args[ARG_pixel_format].u_int, args[ARG_fb_count].u_int, &plan);
+
+    mp_obj_t dict = mp_obj_new_dict(6);
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_fb_size), mp_obj_new_int_from_uint(plan.fb_size));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_required), mp_obj_new_int_from_uint(plan.required));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_available), mp_obj_new_int_from_uint(plan.available));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_largest_block), mp_obj_new_int_from_uint(plan.largest_block));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_max_fb_count), MP_OBJ_NEW_SMALL_INT(plan.max_fb_count));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_fits), mp_obj_new_bool(plan.fits));
+    return dict;
+}
+static MP_DEFINE_CONST_FUN_OBJ_KW(mp_camera_estimate_memory_obj, 2, mp_camera_estimate_memory);
+
 #ifdef MP_CAMERA_DRIVER_VERSION
     static mp_obj_t mp_camera_driver_version(void) {
         return mp_obj_new_str(MP_CAMERA_DRIVER_VERSION, strlen(MP_CAMERA_DRIVER_VERSION));
@@ -668,10 +1021,21 @@ MP_CREATE_CONST_TYPE(GrabMode, mp_camera_grab_mode);
 static const mp_rom_map_elem_t camera_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_camera) },
     { MP_ROM_QSTR(MP_QSTR_Camera),    MP_ROM_PTR(&camera_type) },
+    { MP_ROM_QSTR(MP_QSTR_Frame),     MP_ROM_PTR(&mp_camera_frame_type) },
+    { MP_ROM_QSTR(MP_QSTR_MJPEGWriter), MP_ROM_PTR(&mp_camera_mjpeg_writer_type) },
+    { MP_ROM_QSTR(MP_QSTR_FanOut),    MP_ROM_PTR(&mp_camera_fanout_type) },
+    { MP_ROM_QSTR(MP_QSTR_AVIRecorder), MP_ROM_PTR(&mp_camera_avi_recorder_type) },
+    { MP_ROM_QSTR(MP_QSTR_PreEventBuffer), MP_ROM_PTR(&mp_camera_pre_event_type) },
+    { MP_ROM_QSTR(MP_QSTR_MotionDetector), MP_ROM_PTR(&mp_camera_motion_detector_type) },
+    { MP_ROM_QSTR(MP_QSTR_AutoExposure), MP_ROM_PTR(&mp_camera_auto_exposure_type) },
     { MP_ROM_QSTR(MP_QSTR_PixelFormat), MP_ROM_PTR(&mp_camera_pixel_format_type) },
     { MP_ROM_QSTR(MP_QSTR_FrameSize), MP_ROM_PTR(&mp_camera_frame_size_type) },
     { MP_ROM_QSTR(MP_QSTR_GainCeiling), MP_ROM_PTR(&mp_camera_gainceiling_type) },
     { MP_ROM_QSTR(MP_QSTR_GrabMode), MP_ROM_PTR(&mp_camera_grab_mode_type) },
+    { MP_ROM_QSTR(MP_QSTR_convert), MP_ROM_PTR(&mp_camera_convert_obj) },
+    { MP_ROM_QSTR(MP_QSTR_encode_jpeg), MP_ROM_PTR(&mp_camera_encode_jpeg_obj) },
+    { MP_ROM_QSTR(MP_QSTR_estimate_memory), MP_ROM_PTR(&mp_camera_estimate_memory_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stats),     MP_ROM_PTR(&mp_camera_stats_obj) },
     #ifdef MP_CAMERA_DRIVER_VERSION
         { MP_ROM_QSTR(MP_QSTR_Version), MP_ROM_PTR(&mp_camera_driver_version_obj) },
     #endif
@@ -685,6 +1049,7 @@ MP_DEFINE_CONST_OBJ_TYPE(
     make_new, mp_camera_make_new,
     print, mp_camera_hal_print,
     attr, camera_obj_property,
+    protocol, &camera_stream_p,
     locals_dict, &camera_camera_locals_dict
 );
 
@@ -692,4 +1057,7 @@ const mp_obj_module_t camera_module = {
     .base = { &mp_type_module },
     .globals = (mp_obj_dict_t *)&camera_module_globals,
 };
-MP_REGISTER_MODULE(MP_QSTR_camera, camera_module);
\ No newline at end of file
+MP_REGISTER_MODULE(MP_QSTR_camera, camera_module);
+
+// The camera object is static, so the on_frame callback needs a GC root
+MP_REGISTER_ROOT_POINTER(mp_obj_t mp_camera_on_frame);
\ No newline at end of file
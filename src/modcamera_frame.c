@@ -0,0 +1,232 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Christopher Nadler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/runtime.h"
+#include "py/obj.h"
+
+#include "modcamera.h"
+#include "camera_conv.h"
+#include "camera_jpeg.h"
+
+mp_obj_t mp_camera_frame_new(mp_camera_obj_t *camera, uint32_t seq, uint8_t *buf, size_t len,
+    uint16_t width, uint16_t height, mp_camera_pixformat_t format, int64_t timestamp_us, uint32_t sequence) {
+    mp_camera_frame_obj_t *self = mp_obj_malloc(mp_camera_frame_obj_t, &mp_camera_frame_type);
+    self->camera = camera;
+    self->seq = seq;
+    self->buf = buf;
+    self->len = len;
+    self->width = width;
+    self->height = height;
+    self->format = format;
+    self->timestamp_us = timestamp_us;
+    self->sequence = sequence;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+static bool jpeg_append(void *ctx, const uint8_t *data, size_t len) {
+    vstr_add_strn((vstr_t *)ctx, (const char *)data, len);
+    return true;
+}
+
+mp_obj_t mp_camera_frame_new_jpeg(const uint8_t *buf, uint16_t width, uint16_t height, mp_camera_pixformat_t format,
+    int quality, int subsampling, int64_t timestamp_us, uint32_t sequence) {
+    // Start with a typical size, the buffer grows with the output and is trimmed afterwards
+    vstr_t jpeg;
+    vstr_init(&jpeg, CAMERA_JPEG_HEADER_SIZE + (size_t)width * height / 8);
+    uint8_t chunk[MICROPY_CAMERA_JPEG_CHUNK_SIZE];
+    size_t len = camera_jpeg_encode((camera_conv_format_t)format, buf, width, height, quality,
+        (camera_jpeg_subsampling_t)subsampling, chunk, sizeof(chunk), jpeg_append, &jpeg);
+    if (len == 0) {
+        vstr_clear(&jpeg);
+        return MP_OBJ_NULL;
+    }
+    uint8_t *out = (uint8_t *)m_renew(char, jpeg.buf, jpeg.alloc, len);
+    return mp_camera_frame_new(NULL, 0, out, len, width, height, PIXFORMAT_JPEG, timestamp_us, sequence);
+}
+
+// Frame(data, width, height, format, *, timestamp=0): a frame owning a copy of data, e.g. for synthetic or stored images
+static mp_obj_t frame_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    enum { ARG_data, ARG_width, ARG_height, ARG_format, ARG_timestamp };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_data, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_width, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_height, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_format, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_timestamp, MP_ARG_INT | MP_ARG_KW_ONLY, {.u_int = 0} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_buffer_info_t data;
+    mp_get_buffer_raise(args[ARG_data].u_obj, &data, MP_BUFFER_READ);
+    mp_int_t width = args[ARG_width].u_int;
+    mp_int_t height = args[ARG_height].u_int;
+    if (width < 1 || height < 1 || width > UINT16_MAX || height > UINT16_MAX) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid frame size"));
+    }
+    mp_int_t format = args[ARG_format].u_int;
+    if (format < 0 || format > CAMERA_CONV_RGB555) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid pixel format"));
+    }
+    size_t bpp = camera_conv_bytes_per_pixel((camera_conv_format_t)format);
+    if (bpp && data.len < (size_t)width * height * bpp) {
+        mp_raise_ValueError(MP_ERROR_TEXT("data too small for frame size"));
+    }
+    uint8_t *buf = m_new(uint8_t, data.len);
+    memcpy(buf, data.buf, data.len);
+    return mp_camera_frame_new(NULL, 0, buf, data.len, width, height, format, args[ARG_timestamp].u_int, 0);
+}
+
+// A frame of a camera becomes invalid as soon as the HAL hands its buffer back to the driver
+static bool frame_is_valid(mp_camera_frame_obj_t *self) {
+    if (self->buf && self->camera && !mp_camera_hal_frame_valid(self->camera, self->seq)) {
+        self->buf = NULL;
+    }
+    return self->buf != NULL;
+}
+
+mp_camera_frame_obj_t *mp_camera_frame_get_valid(mp_obj_t frame_in) {
+    if (!mp_obj_is_type(frame_in, &mp_camera_frame_type)) {
+        mp_raise_TypeError(MP_ERROR_TEXT("expected a Frame"));
+    }
+    mp_camera_frame_obj_t *self = MP_OBJ_TO_PTR(frame_in);
+    if (!frame_is_valid(self)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("Frame has been released"));
+    }
+    return self;
+}
+
+static mp_obj_t frame_release(mp_obj_t self_in) {
+    mp_camera_frame_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->buf && self->camera) {
+        mp_camera_hal_release_frame(self->camera, self->seq);
+    }
+    self->buf = NULL;   // Owned buffers are left to the GC
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(frame_release_obj, frame_release);
+
+static mp_obj_t frame___exit__(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    return frame_release(args[0]);
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(frame___exit___obj, 4, 4, frame___exit__);
+
+static void frame_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
+    mp_camera_frame_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (dest[0] != MP_OBJ_NULL) {
+        // All attributes are read-only
+        return;
+    }
+    switch (attr) {
+        case MP_QSTR_width:
+            dest[0] = MP_OBJ_NEW_SMALL_INT(self->width);
+            break;
+        case MP_QSTR_height:
+            dest[0] = MP_OBJ_NEW_SMALL_INT(self->height);
+            break;
+        case MP_QSTR_format:
+            dest[0] = MP_OBJ_NEW_SMALL_INT(self->format);
+            break;
+        case MP_QSTR_timestamp:
+            dest[0] = mp_obj_new_int_from_ll(self->timestamp_us);
+            break;
+        case MP_QSTR_sequence:
+            dest[0] = mp_obj_new_int_from_uint(self->sequence);
+            break;
+        default:
+            // Delegate to locals_dict
+            dest[1] = MP_OBJ_SENTINEL;
+            break;
+    }
+}
+
+static mp_obj_t frame_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
+    mp_camera_frame_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    switch (op) {
+        case MP_UNARY_OP_BOOL:
+            return mp_obj_new_bool(frame_is_valid(self));
+        case MP_UNARY_OP_LEN:
+            return MP_OBJ_NEW_SMALL_INT(mp_camera_frame_get_valid(self_in)->len);
+        default:
+            return MP_OBJ_NULL;
+    }
+}
+
+static mp_obj_t frame_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
+    if (value != MP_OBJ_SENTINEL) {
+        // Frames are read-only
+        return MP_OBJ_NULL;
+    }
+    mp_camera_frame_obj_t *self = mp_camera_frame_get_valid(self_in);
+    mp_obj_t item = mp_obj_subscr(mp_obj_new_memoryview('B', self->len, self->buf), index, MP_OBJ_SENTINEL);
+    if (mp_obj_is_type(index, &mp_type_slice)) {
+        // Slices are copies, a view would outlive release() and recycling of the frame buffer
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(item, &bufinfo, MP_BUFFER_READ);
+        return mp_obj_new_bytes(bufinfo.buf, bufinfo.len);
+    }
+    return item;
+}
+
+static mp_int_t frame_get_buffer(mp_obj_t self_in, mp_buffer_info_t *bufinfo, mp_uint_t flags) {
+    if (flags & MP_BUFFER_WRITE) {
+        return 1;
+    }
+    mp_camera_frame_obj_t *self = mp_camera_frame_get_valid(self_in);
+    bufinfo->buf = self->buf;
+    bufinfo->len = self->len;
+    bufinfo->typecode = 'B';
+    return 0;
+}
+
+static void frame_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    mp_camera_frame_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (frame_is_valid(self)) {
+        mp_printf(print, "Frame(%ux%u, format=%d, len=%u)", self->width, self->height, (int)self->format, (unsigned int)self->len);
+    } else {
+        mp_printf(print, "Frame(released)");
+    }
+}
+
+static const mp_rom_map_elem_t frame_locals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_release), MP_ROM_PTR(&frame_release_obj) },
+    { MP_ROM_QSTR(MP_QSTR___enter__), MP_ROM_PTR(&mp_identity_obj) },
+    { MP_ROM_QSTR(MP_QSTR___exit__), MP_ROM_PTR(&frame___exit___obj) },
+};
+static MP_DEFINE_CONST_DICT(frame_locals_dict, frame_locals_table);
+
+MP_DEFINE_CONST_OBJ_TYPE(
+    mp_camera_frame_type,
+    MP_QSTR_Frame,
+    MP_TYPE_FLAG_NONE,
+    make_new, frame_make_new,
+    print, frame_print,
+    unary_op, frame_unary_op,
+    subscr, frame_subscr,
+    buffer, frame_get_buffer,
+    attr, frame_attr,
+    locals_dict, &frame_locals_dict
+);
@@ -0,0 +1,1199 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Christopher Nadler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Camera HAL of host builds (e.g. the unix port). A synthetic sensor renders test patterns (see camera_pattern.c)
+// at a fixed frame rate, so applications, frame accounting and the API can be tested without hardware.
+// Alternatively the sensor replays a recording (see camera_replay.c), e.g. to tune applications with real footage.
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "modcamera.h"
+#include "camera_conv.h"
+#include "camera_jpeg.h"
+#include "camera_pattern.h"
+#include "camera_replay.h"
+#include "py/mpthread.h"
+
+#if MICROPY_CAMERA_HOST
+
+#define HOST_SENSOR_NAME    "SYNTHETIC"
+#define HOST_SENSOR_PID     (0x5359)
+
+static int64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+#if MICROPY_CAMERA_PERF
+#define PERF_NOW() now_us()
+#define PERF_RECORD(self, hist, start_us) mp_camera_perf_record(&(self)->perf.hist, now_us() - (start_us))
+#define PERF_COUNT(self, counter) ((self)->perf.counter++)
+#else
+#define PERF_NOW() ((int64_t)0)
+#define PERF_RECORD(self, hist, start_us) ((void)(start_us))
+#define PERF_COUNT(self, counter)
+#endif
+
+// The sensor state is shared with the frame watcher thread. There is only one camera, so the lock is static.
+#if MICROPY_PY_THREAD
+static pthread_mutex_t sensor_lock = PTHREAD_MUTEX_INITIALIZER;
+#define SENSOR_LOCK() pthread_mutex_lock(&sensor_lock)
+#define SENSOR_UNLOCK() pthread_mutex_unlock(&sensor_lock)
+#else
+#define SENSOR_LOCK()
+#define SENSOR_UNLOCK()
+#endif
+
+static const struct {
+    uint16_t width;
+    uint16_t height;
+} resolution[FRAMESIZE_INVALID] = {
+    {   96,   96 }, {  160,  120 }, {  128,  128 }, {  176,  144 }, {  240,  176 }, {  240,  240 },
+    {  320,  240 }, {  320,  320 }, {  400,  296 }, {  480,  320 }, {  640,  480 }, {  800,  600 },
+    { 1024,  768 }, { 1280,  720 }, { 1280, 1024 }, { 1600, 1200 }, { 1920, 1080 }, {  720, 1280 },
+    {  864, 1536 }, { 2048, 1536 }, { 2560, 1440 }, { 2560, 1600 }, { 1080, 1920 }, { 2560, 1920 },
+};
+
+// Sensor settings: setting, valid range and the value after a sensor reset. The ranges are the ones of the
+// esp32 HAL (modcamera.c), so applications see the same validation on the host.
+#define HOST_SETTINGS(X) \
+    X(EXPOSURE_CTRL,  exposure_ctrl,  0, 1,     1) \
+    X(AEC2,           aec2,           0, 1,     0) \
+    X(GAIN_CTRL,      gain_ctrl,      0, 1,     1) \
+    X(WHITEBAL,       whitebal,       0, 1,     1) \
+    X(AWB_GAIN,       awb_gain,       0, 1,     1) \
+    X(AEC_VALUE,      aec_value,      0, 1200,  300) \
+    X(AE_LEVEL,       ae_level,       -3, 3,    0) \
+    X(AGC_GAIN,       agc_gain,       0, 30,    0) \
+    X(GAINCEILING,    gainceiling,    0, 6,     0) \
+    X(WB_MODE,        wb_mode,        0, 4,     0) \
+    X(CONTRAST,       contrast,       -3, 3,    0) \
+    X(BRIGHTNESS,     brightness,     -3, 3,    0) \
+    X(SATURATION,     saturation,     -4, 4,    0) \
+    X(SHARPNESS,      sharpness,      -3, 3,    0) \
+    X(DENOISE,        denoise,        0, 8,     0) \
+    X(QUALITY,        quality,        0, 100,   MICROPY_CAMERA_JPEG_QUALITY) \
+    X(SPECIAL_EFFECT, special_effect, 0, 6,     0) \
+    X(COLORBAR,       colorbar,       0, 1,     0) \
+    X(HMIRROR,        hmirror,        0, 1,     0) \
+    X(VFLIP,          vflip,          0, 1,     0) \
+    X(DCW,            dcw,            0, 1,     1) \
+    X(BPC,            bpc,            0, 1,     0) \
+    X(WPC,            wpc,            0, 1,     1) \
+    X(RAW_GMA,        raw_gma,        0, 1,     1) \
+    X(LENC,           lenc,           0, 1,     1)
+
+static const struct {
+    const char  *name;
+    int16_t     min;
+    int16_t     max;
+    int16_t     reset;
+} sensor_settings[MP_CAMERA_SETTING_COUNT] = {
+    #define SETTING_INFO(id, name, min, max, reset) [MP_CAMERA_SETTING_##id] = { #name, min, max, reset },
+    HOST_SETTINGS(SETTING_INFO)
+    #undef SETTING_INFO
+};
+
+static inline void check_init(mp_camera_obj_t *self) {
+    if (!self->initialized) {
+        mp_raise_OSError(MP_ENOENT);
+    }
+}
+
+static void set_check_fb_count(mp_camera_obj_t *self, mp_int_t fb_count) {
+    if (fb_count > MICROPY_CAMERA_MAX_FB_COUNT) {
+        self->camera_config.fb_count = MICROPY_CAMERA_MAX_FB_COUNT;
+        mp_warning(NULL, "Frame buffer count limited to %d", MICROPY_CAMERA_MAX_FB_COUNT);
+    } else if (fb_count < 1) {
+        self->camera_config.fb_count = 1;
+        mp_warning(NULL, "Frame buffer size must be >0. Setting it to 1");
+    } else {
+        self->camera_config.fb_count = fb_count;
+    }
+}
+
+static void set_check_grab_mode(mp_camera_obj_t *self, mp_camera_grabmode_t grab_mode) {
+    if (grab_mode != CAMERA_GRAB_WHEN_EMPTY && grab_mode != CAMERA_GRAB_LATEST) {
+        mp_raise_ValueError(MP_ERROR_TEXT("Invalid grab_mode"));
+    }
+    self->camera_config.grab_mode = grab_mode;
+}
+
+static void set_check_pixel_format(mp_camera_obj_t *self, mp_camera_pixformat_t pixel_format) {
+    if (pixel_format > PIXFORMAT_RGB555) {
+        mp_raise_ValueError(MP_ERROR_TEXT("Invalid pixel_format"));
+    }
+    self->camera_config.pixel_format = pixel_format;
+}
+
+// Synthetic sensor
+
+// Frame period of the sensor, the environment variable MICROPY_CAMERA_FPS overrides the build default
+static uint32_t sensor_period_us(void) {
+    int fps = MICROPY_CAMERA_HOST_FPS;
+    const char *env = getenv("MICROPY_CAMERA_FPS");
+    if (env && *env) {
+        fps = atoi(env);
+    }
+    return fps > 0 ? 1000000 / fps : 0;
+}
+
+// Start of sensor frame k relative to sensor_start_us. Replayed frames keep the timing of the recording.
+static int64_t sensor_frame_time(mp_camera_obj_t *self, uint32_t frame) {
+    if (self->replaying) {
+        return camera_replay_frame_time(&self->replay, frame);
+    }
+    return (int64_t)frame * self->sensor_period_us;
+}
+
+// Number of frames which are complete, a frame is complete when the next one starts
+static uint32_t sensor_frames_complete(mp_camera_obj_t *self, int64_t now) {
+    int64_t elapsed_us = now - self->sensor_start_us;
+    if (elapsed_us < 0) {
+        return 0;
+    }
+    if (self->replaying) {
+        return camera_replay_frames_started(&self->replay, elapsed_us) - 1;
+    }
+    return elapsed_us / self->sensor_period_us;
+}
+
+// Sensor frame k is exposed from sensor_start_us + sensor_frame_time(k) and complete when frame k + 1 starts.
+// LATEST delivers the newest complete frame. WHEN_EMPTY delivers the frames in order, but the driver only
+// queues fb_count frames, so older ones are dropped. Returns the frame and the time it is complete.
+static uint32_t sensor_next_frame(mp_camera_obj_t *self, int64_t now, int64_t *done_us) {
+    uint32_t frame = self->next_frame;
+    if (!self->sensor_period_us) {
+        *done_us = now;
+        return frame;
+    }
+    uint32_t complete = sensor_frames_complete(self, now);
+    if (self->camera_config.grab_mode == CAMERA_GRAB_LATEST) {
+        if (complete > frame) {
+            frame = complete - 1;
+        }
+    } else if (complete > frame + self->camera_config.fb_count) {
+        frame = complete - self->camera_config.fb_count;
+    }
+    *done_us = self->sensor_start_us + sensor_frame_time(self, frame + 1);
+    return frame;
+}
+
+static void sensor_sleep_until(int64_t until_us, bool from_vm) {
+    struct timespec ts = { .tv_sec = until_us / 1000000, .tv_nsec = (until_us % 1000000) * 1000 };
+    if (from_vm) {
+        MP_THREAD_GIL_EXIT();
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    if (from_vm) {
+        MP_THREAD_GIL_ENTER();
+    }
+}
+
+static void sensor_render(mp_camera_obj_t *self, hal_camera_fb_t *fb, uint32_t frame) {
+    if (self->replaying) {
+        // Zero copy, the frame buffer points into the mapped recording
+        fb->buf = (uint8_t *)camera_replay_frame(&self->replay, frame, &fb->len);
+        fb->width = self->replay.width;
+        fb->height = self->replay.height;
+        fb->format = self->camera_config.pixel_format;
+        return;
+    }
+    const int32_t *settings = self->settings;
+    // Manual exposure and gain scale the image, so the effect of a setting is visible in the frames
+    int gain = 256;
+    if (!settings[MP_CAMERA_SETTING_EXPOSURE_CTRL]) {
+        gain = gain * settings[MP_CAMERA_SETTING_AEC_VALUE] / sensor_settings[MP_CAMERA_SETTING_AEC_VALUE].reset;
+    }
+    if (!settings[MP_CAMERA_SETTING_GAIN_CTRL]) {
+        gain = gain * (8 + settings[MP_CAMERA_SETTING_AGC_GAIN]) / 8;
+    }
+    camera_pattern_t pattern = {
+        .width = resolution[self->camera_config.frame_size].width,
+        .height = resolution[self->camera_config.frame_size].height,
+        .format = (camera_conv_format_t)self->camera_config.pixel_format,
+        .frame = frame,
+        .colorbar = settings[MP_CAMERA_SETTING_COLORBAR],
+        .hmirror = settings[MP_CAMERA_SETTING_HMIRROR],
+        .vflip = settings[MP_CAMERA_SETTING_VFLIP],
+        .gain = MIN(gain, UINT16_MAX),
+        .offset = 16 * settings[MP_CAMERA_SETTING_BRIGHTNESS],
+        .quality = self->camera_config.jpeg_quality,
+    };
+    fb->width = pattern.width;
+    fb->height = pattern.height;
+    fb->format = self->camera_config.pixel_format;
+    fb->len = camera_pattern_render(&pattern, fb->buf, self->fb_alloc_size);
+}
+
+// Counterpart of esp_camera_fb_get: waits until the next frame is complete and renders it into a free frame buffer.
+// Returns NULL, if all frame buffers are taken.
+static hal_camera_fb_t *sensor_fb_get(mp_camera_obj_t *self, bool from_vm) {
+    int64_t done_us;
+    uint32_t frame;
+    for (;;) {
+        SENSOR_LOCK();
+        int64_t now = now_us();
+        frame = sensor_next_frame(self, now, &done_us);
+        if (now >= done_us) {
+            break;
+        }
+        SENSOR_UNLOCK();
+        sensor_sleep_until(done_us, from_vm);
+        if (from_vm) {
+            mp_handle_pending(true);
+        }
+    }
+    hal_camera_fb_t *fb = NULL;
+    for (int i = 0; i < self->camera_config.fb_count; i++) {
+        if (!self->fbs[i].in_use) {
+            fb = &self->fbs[i];
+            break;
+        }
+    }
+    if (fb) {
+        fb->in_use = true;
+        fb->sensor_seq = frame;
+        fb->timestamp_us = self->sensor_period_us ? self->sensor_start_us + sensor_frame_time(self, frame) : done_us;
+        self->next_frame = frame + 1;
+        sensor_render(self, fb, frame);
+    }
+    SENSOR_UNLOCK();
+    return fb;
+}
+
+static void sensor_fb_return(hal_camera_fb_t *fb) {
+    SENSOR_LOCK();
+    fb->in_use = false;
+    SENSOR_UNLOCK();
+}
+
+static bool sensor_frame_complete(mp_camera_obj_t *self) {
+    int64_t done_us;
+    int64_t now = now_us();
+    SENSOR_LOCK();
+    sensor_next_frame(self, now, &done_us);
+    SENSOR_UNLOCK();
+    return now >= done_us;
+}
+
+// Frames which started before now were exposed with the previous configuration
+static void sensor_restart(mp_camera_obj_t *self) {
+    self->sensor_start_us = now_us();
+    self->next_frame = 0;
+}
+
+static void sensor_reset_settings(mp_camera_obj_t *self) {
+    for (size_t i = 0; i < MP_CAMERA_SETTING_COUNT; i++) {
+        self->settings[i] = sensor_settings[i].reset;
+    }
+}
+
+static void free_fbs(mp_camera_obj_t *self) {
+    for (size_t i = 0; i < MICROPY_CAMERA_MAX_FB_COUNT; i++) {
+        if (!self->replaying) {
+            free(self->fbs[i].buf);
+        }
+        memset(&self->fbs[i], 0, sizeof(self->fbs[i]));
+    }
+    self->fb_alloc_size = 0;
+}
+
+static size_t fb_size(mp_camera_framesize_t frame_size, mp_camera_pixformat_t pixel_format) {
+    if (frame_size >= FRAMESIZE_INVALID) {
+        mp_raise_ValueError(MP_ERROR_TEXT("Invalid frame_size"));
+    }
+    return camera_pattern_max_size(resolution[frame_size].width, resolution[frame_size].height, (camera_conv_format_t)pixel_format);
+}
+
+// The frame buffers are allocated outside of the GC heap, since the watcher thread fills them.
+// Replayed frames are not copied, so a replay only needs the frame buffer bookkeeping.
+static void init_sensor(mp_camera_obj_t *self) {
+    self->sensor_period_us = sensor_period_us();
+    sensor_reset_settings(self);
+    sensor_restart(self);
+    if (self->replaying) {
+        self->fb_alloc_size = self->replay.max_len;
+        if (self->sensor_period_us) {
+            self->sensor_period_us = MAX(self->replay.loop_us / self->replay.count, 1);
+        }
+        return;
+    }
+    size_t size = fb_size(self->camera_config.frame_size, self->camera_config.pixel_format);
+    for (int i = 0; i < self->camera_config.fb_count; i++) {
+        self->fbs[i].buf = malloc(size);
+        if (!self->fbs[i].buf) {
+            free_fbs(self);
+            mp_raise_msg(&mp_type_MemoryError, MP_ERROR_TEXT("Failed to allocate frame buffers"));
+        }
+    }
+    self->fb_alloc_size = size;
+}
+
+// The recording defines the frame size and pixel format of the camera
+static void open_replay(mp_camera_obj_t *self, const char *path) {
+    int err = camera_replay_open(&self->replay, path);
+    if (err == EINVAL) {
+        mp_raise_ValueError(MP_ERROR_TEXT("Invalid recording"));
+    } else if (err) {
+        mp_raise_OSError(err);
+    }
+    mp_camera_framesize_t frame_size = 0;
+    while (frame_size < FRAMESIZE_INVALID
+        && (resolution[frame_size].width != self->replay.width || resolution[frame_size].height != self->replay.height)) {
+        frame_size++;
+    }
+    if (frame_size == FRAMESIZE_INVALID) {
+        camera_replay_close(&self->replay);
+        mp_raise_ValueError(MP_ERROR_TEXT("Frame size of the recording is not supported"));
+    }
+    self->camera_config.frame_size = frame_size;
+    self->camera_config.pixel_format = (mp_camera_pixformat_t)self->replay.format;
+    self->replaying = true;
+}
+
+// Frame handling, same as the esp32 HAL (modcamera.c)
+
+static void return_frame(mp_camera_obj_t *self, hal_camera_frame_slot_t *slot) {
+    PERF_RECORD(self, hold, slot->handed_out_us);
+    sensor_fb_return(slot->fb);
+    slot->fb = NULL;
+    slot->held = false;
+}
+
+static hal_camera_fb_t *take_ready_fb(mp_camera_obj_t *self) {
+    SENSOR_LOCK();
+    hal_camera_fb_t *fb = self->ready_fb;
+    self->ready_fb = NULL;
+    SENSOR_UNLOCK();
+    return fb;
+}
+
+static void return_all_frames(mp_camera_obj_t *self) {
+    for (size_t i = 0; i < MICROPY_CAMERA_MAX_FB_COUNT; i++) {
+        if (self->frames[i].fb) {
+            return_frame(self, &self->frames[i]);
+        }
+    }
+    hal_camera_fb_t *fb = take_ready_fb(self);
+    if (fb) {
+        sensor_fb_return(fb);
+    }
+}
+
+// The sensor numbers its frames, so the dropped frames are counted exactly
+static void account_frame(mp_camera_obj_t *self, hal_camera_fb_t *fb) {
+    if (self->has_frame && fb->sensor_seq > self->sensor_seq) {
+        self->dropped += fb->sensor_seq - self->sensor_seq - 1;
+    }
+    self->has_frame = true;
+    self->sensor_seq = fb->sensor_seq;
+    self->captured++;
+}
+
+static void apply_pending_settings(mp_camera_obj_t *self);
+
+// Frames started before the last deferred settings batch was written have (partly) old settings
+static inline bool frame_is_stale(mp_camera_obj_t *self, hal_camera_fb_t *fb) {
+    return fb->timestamp_us < self->settings_since_us;
+}
+
+// Prefer the frame the watcher already grabbed, it is the latest one
+static hal_camera_fb_t *grab_frame(mp_camera_obj_t *self) {
+    PERF_COUNT(self, captures);
+    hal_camera_fb_t *fb = take_ready_fb(self);
+    if (fb && frame_is_stale(self, fb)) {
+        sensor_fb_return(fb);
+        fb = NULL;
+    }
+    if (!fb) {
+        int64_t start_us = PERF_NOW();
+        fb = sensor_fb_get(self, true);
+        while (fb && frame_is_stale(self, fb)) {
+            sensor_fb_return(fb);
+            fb = sensor_fb_get(self, true);
+        }
+        if (!fb) {
+            fb = take_ready_fb(self);   // The watcher took the last free frame buffer meanwhile
+        }
+        PERF_RECORD(self, fb_get, start_us);
+    }
+    if (fb) {
+        account_frame(self, fb);
+        apply_pending_settings(self);
+    } else {
+        PERF_COUNT(self, failed);
+    }
+    return fb;
+}
+
+#if MICROPY_PY_THREAD
+
+static void watcher_wait(void) {
+    struct timespec ts = { .tv_sec = 0, .tv_nsec = 1000000 };
+    nanosleep(&ts, NULL);
+}
+
+static void *frame_watcher_thread(void *arg) {
+    mp_camera_obj_t *self = arg;
+    while (self->watching) {
+        if (self->ready_fb && (!self->sensor_period_us || !sensor_frame_complete(self))) {
+            // Wait for a newer frame or for the ready frame to be handed out
+            watcher_wait();
+            continue;
+        }
+        hal_camera_fb_t *fb = sensor_fb_get(self, false);
+        if (!fb) {
+            watcher_wait();     // All frame buffers are taken, e.g. with fb_count = 1 the ready frame has to be returned first
+            continue;
+        }
+        SENSOR_LOCK();
+        hal_camera_fb_t *old_fb = self->ready_fb;
+        self->ready_fb = fb;
+        if (old_fb) {
+            self->coalesced++;
+            old_fb->in_use = false;
+        }
+        bool schedule = !self->dispatch_pending;
+        self->dispatch_pending = true;
+        SENSOR_UNLOCK();
+
+        if (schedule && !mp_sched_schedule(self->dispatch, MP_OBJ_FROM_PTR(self))) {
+            // Scheduler queue is full, retry with the next frame
+            SENSOR_LOCK();
+            self->dispatch_pending = false;
+            SENSOR_UNLOCK();
+        }
+    }
+    return NULL;
+}
+
+static void start_watcher(mp_camera_obj_t *self) {
+    self->watching = true;
+    self->dispatch_pending = false;
+    if (pthread_create(&self->watcher, NULL, frame_watcher_thread, self) != 0) {
+        self->watching = false;
+        mp_raise_OSError(MP_ENOMEM);
+    }
+    self->has_watcher = true;
+}
+
+// Waits for the watcher to finish, it might be waiting up to one frame period for the next frame
+static void stop_watcher(mp_camera_obj_t *self) {
+    if (!self->has_watcher) {
+        return;
+    }
+    self->watching = false;
+    MP_THREAD_GIL_EXIT();
+    pthread_join(self->watcher, NULL);
+    MP_THREAD_GIL_ENTER();
+    self->has_watcher = false;
+}
+
+#else
+
+static void start_watcher(mp_camera_obj_t *self) {
+    (void)self;
+    mp_raise_OSError(MP_EOPNOTSUPP);    // The watcher needs threads
+}
+
+static void stop_watcher(mp_camera_obj_t *self) {
+    (void)self;
+}
+
+#endif // MICROPY_PY_THREAD
+
+static hal_camera_frame_slot_t *find_frame(mp_camera_obj_t *self, uint32_t seq) {
+    for (size_t i = 0; i < MICROPY_CAMERA_MAX_FB_COUNT; i++) {
+        if (self->frames[i].fb && self->frames[i].seq == seq) {
+            return &self->frames[i];
+        }
+    }
+    return NULL;
+}
+
+void mp_camera_hal_plan_memory(mp_camera_obj_t *self, mp_camera_framesize_t frame_size, mp_camera_pixformat_t pixel_format, mp_int_t fb_count, mp_camera_memory_plan_t *plan) {
+    plan->fb_size = fb_size(frame_size, pixel_format);
+    plan->required = fb_count * plan->fb_size;
+    plan->available = MICROPY_CAMERA_HOST_FB_MEMORY;
+    plan->largest_block = MICROPY_CAMERA_HOST_FB_MEMORY;
+    plan->max_fb_count = 0;
+    if (plan->fb_size && plan->fb_size <= plan->largest_block) {
+        plan->max_fb_count = MIN(plan->available / plan->fb_size, MICROPY_CAMERA_MAX_FB_COUNT);
+    }
+    plan->fits = fb_count <= plan->max_fb_count;
+}
+
+static void check_memory(mp_camera_obj_t *self, mp_camera_framesize_t frame_size, mp_camera_pixformat_t pixel_format, mp_int_t fb_count) {
+    mp_camera_memory_plan_t plan;
+    mp_camera_hal_plan_memory(self, frame_size, pixel_format, fb_count, &plan);
+    if (!plan.fits) {
+        mp_raise_msg_varg(&mp_type_MemoryError, MP_ERROR_TEXT("%d frame buffers need %u bytes of memory, %u bytes available (max. fb_count %d)"),
+            (int)fb_count, (unsigned int)plan.required, (unsigned int)plan.available, plan.max_fb_count);
+    }
+}
+
+// Camera HAL Funcitons
+void mp_camera_hal_construct(
+    mp_camera_obj_t *self,
+    int8_t data_pins[8],
+    int8_t external_clock_pin,
+    int8_t pixel_clock_pin,
+    int8_t vsync_pin,
+    int8_t href_pin,
+    int8_t powerdown_pin,
+    int8_t reset_pin,
+    int8_t sccb_sda_pin,
+    int8_t sccb_scl_pin,
+    int8_t sccb_i2c_port,
+    int32_t xclk_freq_hz,
+    mp_camera_pixformat_t pixel_format,
+    mp_camera_framesize_t frame_size,
+    int8_t jpeg_quality,
+    int8_t fb_count,
+    mp_camera_grabmode_t grab_mode) {
+        // The synthetic sensor has no pins and no clock
+        self->camera_config.frame_size = frame_size;
+        self->camera_config.jpeg_quality = jpeg_quality;
+
+        set_check_pixel_format(self, pixel_format);
+        set_check_fb_count(self, fb_count);
+        set_check_grab_mode(self, grab_mode);
+
+        self->initialized = false;
+        self->fb_alloc_size = 0;
+        memset(self->frames, 0, sizeof(self->frames));
+        memset(self->fbs, 0, sizeof(self->fbs));
+        memset(&self->replay, 0, sizeof(self->replay));
+        self->replaying = false;
+        self->has_watcher = false;
+        self->watching = false;
+        self->dispatch = MP_OBJ_NULL;
+        self->ready_fb = NULL;
+        self->coalesced = 0;
+        self->sensor_seq = 0;
+        self->has_frame = false;
+        self->captured = 0;
+        self->dropped = 0;
+        memset(&self->perf, 0, sizeof(self->perf));
+        self->perf.since_us = PERF_NOW();
+        self->pending_settings.mask = 0;
+        self->settings_since_us = 0;
+    }
+
+void mp_camera_hal_init(mp_camera_obj_t *self) {
+    if (self->initialized) {
+        return;
+    }
+    const char *replay_path = getenv("MICROPY_CAMERA_REPLAY");
+    if (replay_path && *replay_path) {
+        open_replay(self, replay_path);
+    } else {
+        check_memory(self, self->camera_config.frame_size, self->camera_config.pixel_format, self->camera_config.fb_count);
+    }
+    int64_t start_us = PERF_NOW();
+    init_sensor(self);
+    self->initialized = true;
+    PERF_RECORD(self, init, start_us);
+}
+
+void mp_camera_hal_deinit(mp_camera_obj_t *self) {
+    if (self->initialized) {
+        stop_watcher(self);
+        self->dispatch = MP_OBJ_NULL;
+        return_all_frames(self);
+        self->pending_settings.mask = 0;
+        free_fbs(self);
+        if (self->replaying) {
+            camera_replay_close(&self->replay);
+            self->replaying = false;
+        }
+        self->initialized = false;
+    }
+}
+
+// The frame buffers are sized for the largest frame of the configuration, other configurations reuse them if they fit
+static bool sensor_can_switch(mp_camera_obj_t *self, mp_camera_framesize_t frame_size, mp_camera_pixformat_t pixel_format, mp_camera_grabmode_t grab_mode, mp_int_t fb_count) {
+    hal_camera_config_t *config = &self->camera_config;
+    if (grab_mode != config->grab_mode || fb_count != config->fb_count) {
+        return false;
+    }
+    return fb_size(frame_size, pixel_format) <= self->fb_alloc_size;
+}
+
+static void switch_sensor(mp_camera_obj_t *self, mp_camera_framesize_t frame_size, mp_camera_pixformat_t pixel_format) {
+    bool watching = self->has_watcher;
+    stop_watcher(self);
+    return_all_frames(self);
+    self->camera_config.frame_size = frame_size;
+    self->camera_config.pixel_format = pixel_format;
+    sensor_restart(self);
+    self->has_frame = false;
+    if (watching) {
+        start_watcher(self);
+    }
+}
+
+mp_camera_reconfigure_t mp_camera_hal_reconfigure(mp_camera_obj_t *self, mp_camera_framesize_t frame_size, mp_camera_pixformat_t pixel_format, mp_camera_grabmode_t grab_mode, mp_int_t fb_count) {
+    check_init(self);
+    int64_t start_us = PERF_NOW();
+
+    if (frame_size > mp_camera_hal_get_max_frame_size(self)) {
+        mp_warning(NULL, "Frame size will be scaled down to maximal frame size supported by the camera sensor");
+        frame_size = mp_camera_hal_get_max_frame_size(self);
+    }
+    mp_int_t new_fb_count = MIN(MAX(fb_count, 1), MICROPY_CAMERA_MAX_FB_COUNT);
+    hal_camera_config_t *config = &self->camera_config;
+    if (frame_size == config->frame_size && pixel_format == config->pixel_format
+        && grab_mode == config->grab_mode && new_fb_count == config->fb_count) {
+        return MP_CAMERA_RECONFIGURE_NONE;
+    }
+    if (self->replaying && (frame_size != config->frame_size || pixel_format != config->pixel_format)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("The frame size and pixel format of a replay are the ones of the recording"));
+    }
+    if (pixel_format > PIXFORMAT_RGB555) {
+        mp_raise_ValueError(MP_ERROR_TEXT("Invalid pixel_format"));
+    }
+    if (sensor_can_switch(self, frame_size, pixel_format, grab_mode, new_fb_count)) {
+        switch_sensor(self, frame_size, pixel_format);
+        PERF_RECORD(self, switch_sensor, start_us);
+        return MP_CAMERA_RECONFIGURE_SENSOR;
+    }
+
+    // Validate the new configuration while the running one is still intact
+    check_memory(self, frame_size, pixel_format, new_fb_count);
+
+    set_check_pixel_format(self, pixel_format);
+    set_check_grab_mode(self, grab_mode);
+    set_check_fb_count(self, fb_count);
+    config->frame_size = frame_size;
+
+    bool watching = self->has_watcher;
+    stop_watcher(self);
+    return_all_frames(self);
+    free_fbs(self);
+    self->initialized = false;
+    self->has_frame = false;
+    init_sensor(self);
+    self->initialized = true;
+    if (watching) {
+        start_watcher(self);
+    }
+    PERF_RECORD(self, reconfigure, start_us);
+    return MP_CAMERA_RECONFIGURE_RESTART;
+}
+
+// There is no JPEG decoder on the host, JPEG frames are encoded in software
+static bool conversion_supported(mp_camera_pixformat_t src_format, mp_camera_pixformat_t dst_format) {
+    if (dst_format == PIXFORMAT_JPEG) {
+        return camera_jpeg_supported((camera_conv_format_t)src_format);
+    }
+    return src_format != PIXFORMAT_JPEG && camera_conv_supported((camera_conv_format_t)src_format, (camera_conv_format_t)dst_format);
+}
+
+// out has been allocated before the frame was grabbed (see alloc_conversion)
+static mp_obj_t convert_frame(mp_camera_obj_t *self, hal_camera_fb_t *fb, mp_camera_pixformat_t out_format,
+    uint8_t *out, size_t out_len) {
+    int64_t start_us = PERF_NOW();
+    uint16_t width = fb->width;
+    uint16_t height = fb->height;
+    int64_t timestamp_us = fb->timestamp_us;
+    if (out_format == PIXFORMAT_JPEG) {
+        // The output grows while it is encoded from the frame buffer, so give the buffer back if that raises
+        mp_obj_t jpeg;
+        nlr_buf_t nlr;
+        if (nlr_push(&nlr) == 0) {
+            jpeg = mp_camera_frame_new_jpeg(fb->buf, width, height, fb->format, self->camera_config.jpeg_quality,
+                CAMERA_JPEG_SUBSAMPLING_420, timestamp_us, self->sensor_seq);
+            nlr_pop();
+        } else {
+            sensor_fb_return(fb);
+            nlr_jump(nlr.ret_val);
+        }
+        sensor_fb_return(fb);
+        PERF_RECORD(self, hold, start_us);
+        if (jpeg == MP_OBJ_NULL) {
+            mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("Failed to convert image"));
+        }
+        return jpeg;
+    }
+    // A frame which does not match the frame size (e.g. of a replay) does not fit into out
+    bool converted = width * height * camera_conv_bytes_per_pixel((camera_conv_format_t)out_format) == out_len
+        && camera_conv_convert((camera_conv_format_t)fb->format, fb->buf,
+            (camera_conv_format_t)out_format, out, width * height) == out_len;
+    sensor_fb_return(fb);
+    PERF_RECORD(self, hold, start_us);
+    if (!converted) {
+        m_del(uint8_t, out, out_len);
+        mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("Failed to convert image"));
+    }
+    return mp_camera_frame_new(NULL, 0, out, out_len, width, height, out_format, timestamp_us, self->sensor_seq);
+}
+
+static int8_t check_out_format(mp_camera_obj_t *self, int8_t out_format) {
+    MP_STATIC_ASSERT((int)PIXFORMAT_RGB555 == (int)CAMERA_CONV_RGB555 && (int)PIXFORMAT_JPEG == (int)CAMERA_CONV_JPEG);
+    if (out_format == self->camera_config.pixel_format) {
+        return -1;
+    }
+    if (out_format >= 0 && !conversion_supported(self->camera_config.pixel_format, out_format)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("Unsupported conversion"));
+    }
+    return out_format;
+}
+
+// Allocates the output of a conversion before the frame is grabbed, so a MemoryError does not keep the frame buffer.
+// Returns NULL, if there is nothing to convert.
+static uint8_t *alloc_conversion(mp_camera_obj_t *self, int8_t out_format, size_t *out_len) {
+    if (out_format < 0 || out_format == PIXFORMAT_JPEG) {
+        *out_len = 0;
+        return NULL;
+    }
+    *out_len = mp_camera_hal_get_pixel_width(self) * mp_camera_hal_get_pixel_height(self)
+        * camera_conv_bytes_per_pixel((camera_conv_format_t)out_format);
+    return m_new(uint8_t, *out_len);
+}
+
+// Frames which are not held are only valid until the next capture.
+// Returns a free slot for the next frame or NULL, if all frame buffers are held.
+static hal_camera_frame_slot_t *recycle_frames(mp_camera_obj_t *self) {
+    hal_camera_frame_slot_t *slot = NULL;
+    int held = 0;
+    for (size_t i = 0; i < MICROPY_CAMERA_MAX_FB_COUNT; i++) {
+        if (self->frames[i].fb && !self->frames[i].held) {
+            return_frame(self, &self->frames[i]);
+        }
+        if (self->frames[i].fb) {
+            held++;
+        } else if (!slot) {
+            slot = &self->frames[i];
+        }
+    }
+    return held < self->camera_config.fb_count ? slot : NULL;
+}
+
+// Number of frames handed out, held or not
+static int frames_handed_out(mp_camera_obj_t *self) {
+    int count = 0;
+    for (size_t i = 0; i < MICROPY_CAMERA_MAX_FB_COUNT; i++) {
+        if (self->frames[i].fb) {
+            count++;
+        }
+    }
+    return count;
+}
+
+static hal_camera_frame_slot_t *get_free_slot(mp_camera_obj_t *self) {
+    hal_camera_frame_slot_t *slot = recycle_frames(self);
+    if (!slot) {
+        mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("All frame buffers are held. Release a frame first"));
+    }
+    return slot;
+}
+
+static mp_obj_t hand_out_frame(mp_camera_obj_t *self, hal_camera_frame_slot_t *slot, hal_camera_fb_t *fb, bool hold) {
+    slot->fb = fb;
+    slot->seq = ++self->frame_seq;
+    slot->held = hold;
+    slot->handed_out_us = PERF_NOW();
+    return mp_camera_frame_new(self, slot->seq, fb->buf, fb->len, fb->width, fb->height, fb->format,
+        fb->timestamp_us, self->sensor_seq);
+}
+
+mp_obj_t mp_camera_hal_capture(mp_camera_obj_t *self, int8_t out_format, bool hold) {
+    check_init(self);
+    out_format = check_out_format(self, out_format);
+    hal_camera_frame_slot_t *slot = get_free_slot(self);
+    size_t out_len;
+    uint8_t *out = alloc_conversion(self, out_format, &out_len);
+
+    hal_camera_fb_t *fb = grab_frame(self);
+    if (!fb) {
+        m_del(uint8_t, out, out_len);
+        return mp_const_none;
+    }
+    if (out_format >= 0) {
+        return convert_frame(self, fb, out_format, out, out_len);
+    }
+    return hand_out_frame(self, slot, fb, hold);
+}
+
+void mp_camera_hal_set_frame_callback(mp_camera_obj_t *self, mp_obj_t dispatch) {
+    stop_watcher(self);
+    self->dispatch = dispatch;
+    if (dispatch != MP_OBJ_NULL) {
+        check_init(self);
+        start_watcher(self);
+    }
+}
+
+mp_obj_t mp_camera_hal_take_ready_frame(mp_camera_obj_t *self) {
+    SENSOR_LOCK();
+    self->dispatch_pending = false;
+    SENSOR_UNLOCK();
+    if (!self->initialized || !self->ready_fb) {
+        return mp_const_none;
+    }
+    hal_camera_frame_slot_t *slot = recycle_frames(self);
+    if (!slot) {
+        return mp_const_none;   // Leave the ready frame for the next capture
+    }
+    hal_camera_fb_t *fb = take_ready_fb(self);
+    if (!fb) {
+        return mp_const_none;
+    }
+    if (frame_is_stale(self, fb)) {
+        sensor_fb_return(fb);   // The watcher grabs the next one
+        return mp_const_none;
+    }
+    PERF_COUNT(self, captures);
+    account_frame(self, fb);
+    apply_pending_settings(self);
+    return hand_out_frame(self, slot, fb, false);
+}
+
+mp_obj_t mp_camera_hal_capture_into(mp_camera_obj_t *self, uint8_t *buf, size_t len, int8_t out_format) {
+    check_init(self);
+    out_format = check_out_format(self, out_format);
+    get_free_slot(self);
+
+    hal_camera_fb_t *fb = grab_frame(self);
+    if (!fb) {
+        return mp_const_none;
+    }
+    int64_t start_us = PERF_NOW();
+    if (out_format == PIXFORMAT_JPEG) {
+        // The length is only known after encoding, the encoder stops when buf is full
+        size_t out_len = camera_jpeg_encode((camera_conv_format_t)fb->format, fb->buf, fb->width, fb->height,
+            self->camera_config.jpeg_quality, CAMERA_JPEG_SUBSAMPLING_420, buf, len, NULL, NULL);
+        sensor_fb_return(fb);
+        PERF_RECORD(self, hold, start_us);
+        if (out_len == 0) {
+            mp_raise_ValueError(MP_ERROR_TEXT("Buffer too small"));
+        }
+        return mp_obj_new_int_from_uint(out_len);
+    }
+    size_t out_len = out_format >= 0
+        ? fb->width * fb->height * camera_conv_bytes_per_pixel((camera_conv_format_t)out_format)
+        : fb->len;
+    if (out_len > len) {
+        sensor_fb_return(fb);
+        mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("Buffer too small, %u bytes needed"), (unsigned int)out_len);
+    }
+    bool copied = true;
+    if (out_format < 0) {
+        memcpy(buf, fb->buf, out_len);
+    } else {
+        copied = camera_conv_convert((camera_conv_format_t)fb->format, fb->buf,
+            (camera_conv_format_t)out_format, buf, fb->width * fb->height) == out_len;
+    }
+    sensor_fb_return(fb);
+    PERF_RECORD(self, hold, start_us);
+    if (!copied) {
+        mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("Failed to convert image"));
+    }
+    return mp_obj_new_int_from_uint(out_len);
+}
+
+mp_obj_t mp_camera_hal_frame_available(mp_camera_obj_t *self) {
+    check_init(self);
+    return mp_obj_new_bool(sensor_frame_complete(self));
+}
+
+bool mp_camera_hal_frame_ready(mp_camera_obj_t *self) {
+    check_init(self);
+    // Polling must not invalidate frames which are still in use, so count the handed out frames instead of recycling
+    // them. If they occupy all frame buffers, the driver cannot capture. Report ready then, capture recycles the frames
+    // which are not held, or raises if all are held.
+    return frames_handed_out(self) >= self->camera_config.fb_count || self->ready_fb || sensor_frame_complete(self);
+}
+
+bool mp_camera_hal_initialized(mp_camera_obj_t *self){
+    return self->initialized;
+}
+
+void mp_camera_hal_free_buffer(mp_camera_obj_t *self) {
+    return_all_frames(self);
+}
+
+bool mp_camera_hal_frame_valid(mp_camera_obj_t *self, uint32_t seq) {
+    return find_frame(self, seq) != NULL;
+}
+
+void mp_camera_hal_get_frame_stats(mp_camera_obj_t *self, mp_camera_frame_stats_t *stats, bool reset) {
+    SENSOR_LOCK();
+    stats->overwritten = self->coalesced;
+    if (reset) {
+        self->coalesced = 0;
+    }
+    SENSOR_UNLOCK();
+    stats->captured = self->captured;
+    stats->dropped = self->dropped;
+    stats->frame_period_us = self->sensor_period_us;
+    stats->sequence = self->sensor_seq;
+    if (reset) {
+        self->captured = 0;
+        self->dropped = 0;
+    }
+}
+
+void mp_camera_hal_get_perf(mp_camera_obj_t *self, mp_camera_perf_t *perf, bool reset) {
+    *perf = self->perf;
+    perf->elapsed_us = now_us() - self->perf.since_us;
+    if (reset) {
+        memset(&self->perf, 0, sizeof(self->perf));
+        self->perf.since_us = PERF_NOW();
+    }
+}
+
+void mp_camera_hal_release_frame(mp_camera_obj_t *self, uint32_t seq) {
+    hal_camera_frame_slot_t *slot = find_frame(self, seq);
+    if (slot) {
+        return_frame(self, slot);
+    }
+}
+
+const mp_rom_map_elem_t mp_camera_hal_pixel_format_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_JPEG),            MP_ROM_INT((mp_uint_t)PIXFORMAT_JPEG) },
+    { MP_ROM_QSTR(MP_QSTR_YUV422),          MP_ROM_INT((mp_uint_t)PIXFORMAT_YUV422) },
+    { MP_ROM_QSTR(MP_QSTR_YUV420),          MP_ROM_INT((mp_uint_t)PIXFORMAT_YUV420) },
+    { MP_ROM_QSTR(MP_QSTR_GRAYSCALE),       MP_ROM_INT((mp_uint_t)PIXFORMAT_GRAYSCALE) },
+    { MP_ROM_QSTR(MP_QSTR_RGB565),          MP_ROM_INT((mp_uint_t)PIXFORMAT_RGB565) },
+    { MP_ROM_QSTR(MP_QSTR_RGB888),          MP_ROM_INT((mp_uint_t)PIXFORMAT_RGB888) },
+    { MP_ROM_QSTR(MP_QSTR_RAW),             MP_ROM_INT((mp_uint_t)PIXFORMAT_RAW) },
+    { MP_ROM_QSTR(MP_QSTR_RGB444),          MP_ROM_INT((mp_uint_t)PIXFORMAT_RGB444) },
+    { MP_ROM_QSTR(MP_QSTR_RGB555),          MP_ROM_INT((mp_uint_t)PIXFORMAT_RGB555) },
+};
+
+const mp_rom_map_elem_t mp_camera_hal_frame_size_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_R96X96),    MP_ROM_INT((mp_uint_t)FRAMESIZE_96X96) },
+    { MP_ROM_QSTR(MP_QSTR_QQVGA),     MP_ROM_INT((mp_uint_t)FRAMESIZE_QQVGA) },
+    { MP_ROM_QSTR(MP_QSTR_R128x128),  MP_ROM_INT((mp_uint_t)FRAMESIZE_128X128) },
+    { MP_ROM_QSTR(MP_QSTR_QCIF),      MP_ROM_INT((mp_uint_t)FRAMESIZE_QCIF) },
+    { MP_ROM_QSTR(MP_QSTR_HQVGA),     MP_ROM_INT((mp_uint_t)FRAMESIZE_HQVGA) },
+    { MP_ROM_QSTR(MP_QSTR_R240X240),  MP_ROM_INT((mp_uint_t)FRAMESIZE_240X240) },
+    { MP_ROM_QSTR(MP_QSTR_QVGA),      MP_ROM_INT((mp_uint_t)FRAMESIZE_QVGA) },
+    { MP_ROM_QSTR(MP_QSTR_R320X320),  MP_ROM_INT((mp_uint_t)FRAMESIZE_320X320) },
+    { MP_ROM_QSTR(MP_QSTR_CIF),       MP_ROM_INT((mp_uint_t)FRAMESIZE_CIF) },
+    { MP_ROM_QSTR(MP_QSTR_HVGA),      MP_ROM_INT((mp_uint_t)FRAMESIZE_HVGA) },
+    { MP_ROM_QSTR(MP_QSTR_VGA),       MP_ROM_INT((mp_uint_t)FRAMESIZE_VGA) },
+    { MP_ROM_QSTR(MP_QSTR_SVGA),      MP_ROM_INT((mp_uint_t)FRAMESIZE_SVGA) },
+    { MP_ROM_QSTR(MP_QSTR_XGA),       MP_ROM_INT((mp_uint_t)FRAMESIZE_XGA) },
+    { MP_ROM_QSTR(MP_QSTR_HD),        MP_ROM_INT((mp_uint_t)FRAMESIZE_HD) },
+    { MP_ROM_QSTR(MP_QSTR_SXGA),      MP_ROM_INT((mp_uint_t)FRAMESIZE_SXGA) },
+    { MP_ROM_QSTR(MP_QSTR_UXGA),      MP_ROM_INT((mp_uint_t)FRAMESIZE_UXGA) },
+    { MP_ROM_QSTR(MP_QSTR_FHD),       MP_ROM_INT((mp_uint_t)FRAMESIZE_FHD) },
+    { MP_ROM_QSTR(MP_QSTR_P_HD),      MP_ROM_INT((mp_uint_t)FRAMESIZE_P_HD) },
+    { MP_ROM_QSTR(MP_QSTR_P_3MP),     MP_ROM_INT((mp_uint_t)FRAMESIZE_P_3MP) },
+    { MP_ROM_QSTR(MP_QSTR_QXGA),      MP_ROM_INT((mp_uint_t)FRAMESIZE_QXGA) },
+    { MP_ROM_QSTR(MP_QSTR_QHD),       MP_ROM_INT((mp_uint_t)FRAMESIZE_QHD) },
+    { MP_ROM_QSTR(MP_QSTR_WQXGA),     MP_ROM_INT((mp_uint_t)FRAMESIZE_WQXGA) },
+    { MP_ROM_QSTR(MP_QSTR_P_FHD),     MP_ROM_INT((mp_uint_t)FRAMESIZE_P_FHD) },
+    { MP_ROM_QSTR(MP_QSTR_QSXGA),     MP_ROM_INT((mp_uint_t)FRAMESIZE_QSXGA) },
+};
+
+const mp_rom_map_elem_t mp_camera_hal_grab_mode_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_WHEN_EMPTY), MP_ROM_INT((mp_uint_t)CAMERA_GRAB_WHEN_EMPTY) },
+    { MP_ROM_QSTR(MP_QSTR_LATEST),     MP_ROM_INT((mp_uint_t)CAMERA_GRAB_LATEST) },
+};
+
+const mp_rom_map_elem_t mp_camera_hal_gainceiling_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_2X),      MP_ROM_INT((mp_uint_t)GAINCEILING_2X) },
+    { MP_ROM_QSTR(MP_QSTR_4X),      MP_ROM_INT((mp_uint_t)GAINCEILING_4X) },
+    { MP_ROM_QSTR(MP_QSTR_8X),      MP_ROM_INT((mp_uint_t)GAINCEILING_8X) },
+    { MP_ROM_QSTR(MP_QSTR_16X),     MP_ROM_INT((mp_uint_t)GAINCEILING_16X) },
+    { MP_ROM_QSTR(MP_QSTR_32X),     MP_ROM_INT((mp_uint_t)GAINCEILING_32X) },
+    { MP_ROM_QSTR(MP_QSTR_64X),     MP_ROM_INT((mp_uint_t)GAINCEILING_64X) },
+    { MP_ROM_QSTR(MP_QSTR_128X),    MP_ROM_INT((mp_uint_t)GAINCEILING_128X) },
+};
+
+// Settings
+
+// The sensor is emulated, so it has all settings and every value in range is kept as written
+static int setting_read(mp_camera_obj_t *self, mp_camera_setting_t setting) {
+    if (setting == MP_CAMERA_SETTING_QUALITY) {
+        return self->camera_config.jpeg_quality;
+    }
+    return self->settings[setting];
+}
+
+static void setting_write(mp_camera_obj_t *self, mp_camera_setting_t setting, int value) {
+    if (value < sensor_settings[setting].min || value > sensor_settings[setting].max) {
+        mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("Invalid setting for %s"), sensor_settings[setting].name);
+    }
+    SENSOR_LOCK();
+    if (setting == MP_CAMERA_SETTING_QUALITY) {
+        self->camera_config.jpeg_quality = value;
+    } else {
+        self->settings[setting] = value;
+    }
+    SENSOR_UNLOCK();
+}
+
+#define HOST_SETTING_GETSET(type, name, id) \
+    type mp_camera_hal_get_##name(mp_camera_obj_t * self) { \
+        check_init(self); \
+        return (type)setting_read(self, MP_CAMERA_SETTING_##id); \
+    } \
+    void mp_camera_hal_set_##name(mp_camera_obj_t * self, type value) { \
+        check_init(self); \
+        setting_write(self, MP_CAMERA_SETTING_##id, value); \
+    }
+
+HOST_SETTING_GETSET(int, contrast, CONTRAST);
+HOST_SETTING_GETSET(int, brightness, BRIGHTNESS);
+HOST_SETTING_GETSET(int, saturation, SATURATION);
+HOST_SETTING_GETSET(int, sharpness, SHARPNESS);
+HOST_SETTING_GETSET(int, denoise, DENOISE);
+HOST_SETTING_GETSET(mp_camera_gainceiling_t, gainceiling, GAINCEILING);
+HOST_SETTING_GETSET(bool, colorbar, COLORBAR);
+HOST_SETTING_GETSET(bool, whitebal, WHITEBAL);
+HOST_SETTING_GETSET(bool, gain_ctrl, GAIN_CTRL);
+HOST_SETTING_GETSET(bool, exposure_ctrl, EXPOSURE_CTRL);
+HOST_SETTING_GETSET(bool, hmirror, HMIRROR);
+HOST_SETTING_GETSET(bool, vflip, VFLIP);
+HOST_SETTING_GETSET(bool, aec2, AEC2);
+HOST_SETTING_GETSET(bool, awb_gain, AWB_GAIN);
+HOST_SETTING_GETSET(int, agc_gain, AGC_GAIN);
+HOST_SETTING_GETSET(int, aec_value, AEC_VALUE);
+HOST_SETTING_GETSET(int, special_effect, SPECIAL_EFFECT);
+HOST_SETTING_GETSET(int, wb_mode, WB_MODE);
+HOST_SETTING_GETSET(int, ae_level, AE_LEVEL);
+HOST_SETTING_GETSET(bool, dcw, DCW);
+HOST_SETTING_GETSET(bool, bpc, BPC);
+HOST_SETTING_GETSET(bool, wpc, WPC);
+HOST_SETTING_GETSET(bool, raw_gma, RAW_GMA);
+HOST_SETTING_GETSET(bool, lenc, LENC);
+HOST_SETTING_GETSET(int, quality, QUALITY);
+
+mp_camera_framesize_t mp_camera_hal_get_frame_size(mp_camera_obj_t * self) {
+    check_init(self);
+    return self->camera_config.frame_size;
+}
+
+void mp_camera_hal_set_frame_size(mp_camera_obj_t * self, framesize_t value) {
+    check_init(self);
+    mp_camera_hal_reconfigure(self, value, self->camera_config.pixel_format, self->camera_config.grab_mode, self->camera_config.fb_count);
+}
+
+static void apply_pending_settings(mp_camera_obj_t *self) {
+    if (!self->pending_settings.mask) {
+        return;
+    }
+    for (size_t i = 0; i < MP_CAMERA_SETTING_COUNT; i++) {
+        if (self->pending_settings.mask & (1u << i)) {
+            setting_write(self, i, self->pending_settings.value[i]);
+        }
+    }
+    self->pending_settings.mask = 0;
+    // Frames are stamped when they start, the one in flight was partly exposed with the old settings
+    self->settings_since_us = now_us();
+}
+
+void mp_camera_hal_get_settings(mp_camera_obj_t *self, mp_camera_settings_t *settings) {
+    check_init(self);
+    settings->mask = (1u << MP_CAMERA_SETTING_COUNT) - 1;
+    for (size_t i = 0; i < MP_CAMERA_SETTING_COUNT; i++) {
+        settings->value[i] = setting_read(self, i);
+    }
+}
+
+uint32_t mp_camera_hal_apply_settings(mp_camera_obj_t *self, const mp_camera_settings_t *settings, bool deferred) {
+    check_init(self);
+    for (size_t i = 0; i < MP_CAMERA_SETTING_COUNT; i++) {
+        if ((settings->mask & (1u << i))
+            && (settings->value[i] < sensor_settings[i].min || settings->value[i] > sensor_settings[i].max)) {
+            mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("%s must be between %d and %d"),
+                sensor_settings[i].name, sensor_settings[i].min, sensor_settings[i].max);
+        }
+    }
+    if (!deferred) {
+        for (size_t i = 0; i < MP_CAMERA_SETTING_COUNT; i++) {
+            if (settings->mask & (1u << i)) {
+                setting_write(self, i, settings->value[i]);
+            }
+        }
+        return 0;
+    }
+    // Later batches override the values of earlier ones which are still pending
+    for (size_t i = 0; i < MP_CAMERA_SETTING_COUNT; i++) {
+        if (settings->mask & (1u << i)) {
+            self->pending_settings.value[i] = settings->value[i];
+        }
+    }
+    self->pending_settings.mask |= settings->mask;
+    return 0;
+}
+
+mp_camera_pixformat_t mp_camera_hal_get_pixel_format(mp_camera_obj_t *self) {
+    return self->camera_config.pixel_format;
+}
+
+camera_grab_mode_t mp_camera_hal_get_grab_mode(mp_camera_obj_t *self) {
+    return self->camera_config.grab_mode;
+}
+
+int mp_camera_hal_get_fb_count(mp_camera_obj_t *self) {
+    return self->camera_config.fb_count;
+}
+
+const char *mp_camera_hal_get_sensor_name(mp_camera_obj_t *self) {
+    check_init(self);
+    return HOST_SENSOR_NAME;
+}
+
+bool mp_camera_hal_get_supports_jpeg(mp_camera_obj_t *self) {
+    check_init(self);
+    return true;
+}
+
+mp_camera_framesize_t mp_camera_hal_get_max_frame_size(mp_camera_obj_t *self) {
+    check_init(self);
+    return FRAMESIZE_QSXGA;
+}
+
+// The synthetic sensor is not on a bus
+int mp_camera_hal_get_address(mp_camera_obj_t *self) {
+    check_init(self);
+    return 0;
+}
+
+int mp_camera_hal_get_sensor_id(mp_camera_obj_t *self) {
+    check_init(self);
+    return HOST_SENSOR_PID;
+}
+
+int mp_camera_hal_get_pixel_width(mp_camera_obj_t *self) {
+    check_init(self);
+    return resolution[self->camera_config.frame_size].width;
+}
+
+int mp_camera_hal_get_pixel_height(mp_camera_obj_t *self) {
+    check_init(self);
+    return resolution[self->camera_config.frame_size].height;
+}
+
+#endif // MICROPY_CAMERA_HOST
@@ -0,0 +1,1006 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Christopher Nadler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "py/mphal.h"
+#include "py/stream.h"
+#include "py/objtype.h"
+
+#include "modcamera.h"
+#include "camera_avi.h"
+#include "camera_jpeg.h"
+#include "camera_ring.h"
+#include "camera_replay.h"
+
+static const char mjpeg_trailer[] = "\r\n";
+#define MJPEG_TRAILER_LEN (sizeof(mjpeg_trailer) - 1)
+
+void mp_camera_mjpeg_writer_init(mp_camera_mjpeg_writer_obj_t *self, mp_obj_t stream, const char *boundary, size_t boundary_len) {
+    if (boundary_len > MICROPY_CAMERA_MJPEG_BOUNDARY_MAX) {
+        mp_raise_ValueError(MP_ERROR_TEXT("boundary too long"));
+    }
+    mp_get_stream_raise(stream, MP_STREAM_OP_WRITE);
+    self->base.type = &mp_camera_mjpeg_writer_type;
+    self->stream = stream;
+    self->source = MP_OBJ_NULL;
+    self->offset = 0;
+    self->source_len = 0;
+    self->hdr_len = 0;
+    self->boundary_len = boundary ? boundary_len : 0;
+    if (boundary) {
+        memcpy(self->boundary, boundary, boundary_len);
+    }
+}
+
+void mp_camera_mjpeg_writer_begin(mp_camera_mjpeg_writer_obj_t *self, mp_obj_t source) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(source, &bufinfo, MP_BUFFER_READ);
+    self->source = source;
+    self->source_len = bufinfo.len;
+    self->offset = 0;
+    self->hdr_len = 0;
+    if (self->boundary_len) {
+        self->hdr_len = snprintf(self->hdr, sizeof(self->hdr), "--%.*s\r\nContent-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n",
+            (int)self->boundary_len, self->boundary, (unsigned int)bufinfo.len);
+    }
+}
+
+// Writes the segment [seg_start, seg_start + len) of the part, if the writer is within it
+static bool write_segment(mp_camera_mjpeg_writer_obj_t *self, const uint8_t *buf, size_t seg_start, size_t len, int *errcode) {
+    if (self->offset >= seg_start + len) {
+        return true;
+    }
+    size_t done = self->offset - seg_start;
+    size_t todo = len - done;
+    *errcode = 0;
+    mp_uint_t written = mp_stream_rw(self->stream, (void *)(buf + done), todo, errcode, MP_STREAM_RW_WRITE);
+    self->offset += written;
+    if (written < todo) {
+        if (*errcode == 0) {
+            // mp_stream_rw returns a partial write of a non-blocking stream without error, the rest would block.
+            // Only a write without any progress means that the stream is closed.
+            *errcode = written > 0 ? MP_EAGAIN : MP_EPIPE;
+        }
+        return false;
+    }
+    return true;
+}
+
+bool mp_camera_mjpeg_writer_pump(mp_camera_mjpeg_writer_obj_t *self, int *errcode) {
+    *errcode = 0;
+    if (self->source == MP_OBJ_NULL) {
+        return true;
+    }
+    // The source is looked up on every call, a released frame raises instead of sending stale memory
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(self->source, &bufinfo, MP_BUFFER_READ);
+    size_t data_start = self->hdr_len;
+    size_t trailer_start = data_start + self->source_len;
+    if (!write_segment(self, (const uint8_t *)self->hdr, 0, self->hdr_len, errcode)
+        || !write_segment(self, bufinfo.buf, data_start, self->source_len, errcode)
+        || (self->boundary_len && !write_segment(self, (const uint8_t *)mjpeg_trailer, trailer_start, MJPEG_TRAILER_LEN, errcode))) {
+        return false;
+    }
+    self->source = MP_OBJ_NULL;
+    return true;
+}
+
+bool mp_camera_mjpeg_writer_send(mp_camera_mjpeg_writer_obj_t *self, mp_obj_t source, int *errcode) {
+    mp_camera_mjpeg_writer_begin(self, source);
+    while (!mp_camera_mjpeg_writer_pump(self, errcode)) {
+        if (*errcode != MP_EAGAIN && *errcode != MP_ETIMEDOUT) {
+            self->source = MP_OBJ_NULL;
+            return false;
+        }
+        mp_hal_delay_ms(1);     // Stream would block, let it drain
+    }
+    return true;
+}
+
+bool mp_camera_mjpeg_disconnected(int errcode) {
+    return errcode == MP_ECONNRESET || errcode == MP_EPIPE || errcode == MP_ENOTCONN || errcode == MP_ECONNABORTED;
+}
+
+// MJPEGWriter(stream, boundary="frame")
+static mp_obj_t mjpeg_writer_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    enum { ARG_stream, ARG_boundary };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_stream, MP_ARG_OBJ | MP_ARG_REQUIRED },
+        { MP_QSTR_boundary, MP_ARG_OBJ, {.u_obj = MP_ROM_QSTR(MP_QSTR_frame)} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_camera_mjpeg_writer_obj_t *self = mp_obj_malloc(mp_camera_mjpeg_writer_obj_t, type);
+    size_t boundary_len = 0;
+    const char *boundary = args[ARG_boundary].u_obj != mp_const_none
+        ? mp_obj_str_get_data(args[ARG_boundary].u_obj, &boundary_len)
+        : NULL;
+    mp_camera_mjpeg_writer_init(self, args[ARG_stream].u_obj, boundary, boundary_len);
+    return MP_OBJ_FROM_PTR(self);
+}
+
+static mp_obj_t mjpeg_writer_write(mp_obj_t self_in, mp_obj_t frame) {
+    mp_camera_mjpeg_writer_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    int errcode;
+    if (!mp_camera_mjpeg_writer_send(self, frame, &errcode)) {
+        mp_raise_OSError(errcode);
+    }
+    return MP_OBJ_NEW_SMALL_INT(self->offset);
+}
+static MP_DEFINE_CONST_FUN_OBJ_2(mjpeg_writer_write_obj, mjpeg_writer_write);
+
+static void mjpeg_writer_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
+    mp_camera_mjpeg_writer_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (dest[0] != MP_OBJ_NULL) {
+        return;
+    }
+    if (attr == MP_QSTR_content_type) {
+        // Value for the Content-Type header of the HTTP response
+        vstr_t vstr;
+        vstr_init(&vstr, 48 + self->boundary_len);
+        vstr_printf(&vstr, "multipart/x-mixed-replace; boundary=%.*s", (int)self->boundary_len, self->boundary);
+        dest[0] = mp_obj_new_str_from_vstr(&vstr);
+    } else {
+        dest[1] = MP_OBJ_SENTINEL;
+    }
+}
+
+static const mp_rom_map_elem_t mjpeg_writer_locals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mjpeg_writer_write_obj) },
+};
+static MP_DEFINE_CONST_DICT(mjpeg_writer_locals_dict, mjpeg_writer_locals_table);
+
+MP_DEFINE_CONST_OBJ_TYPE(
+    mp_camera_mjpeg_writer_type,
+    MP_QSTR_MJPEGWriter,
+    MP_TYPE_FLAG_NONE,
+    make_new, mjpeg_writer_make_new,
+    attr, mjpeg_writer_attr,
+    locals_dict, &mjpeg_writer_locals_dict
+);
+
+// FanOut: captures each frame once and distributes it to several sinks with their own send progress
+
+typedef struct fanout_sink {
+    mp_camera_mjpeg_writer_obj_t writer;
+    uint32_t        delivered;
+    uint32_t        dropped;            // Frames skipped, because the sink was still busy with an older frame
+} fanout_sink_t;
+
+typedef struct mp_camera_fanout_obj {
+    mp_obj_base_t   base;
+    mp_obj_t        camera;
+    mp_obj_t        frame;              // Held frame of the last capture, MP_OBJ_NULL if none
+    fanout_sink_t   *sinks;
+    size_t          len;
+    size_t          alloc;
+    mp_uint_t       interval_ms;
+    mp_uint_t       next_ms;
+    mp_obj_t        boundary;
+} mp_camera_fanout_obj_t;
+
+static mp_camera_obj_t *fanout_camera(mp_camera_fanout_obj_t *self) {
+    return MP_OBJ_TO_PTR(self->camera);
+}
+
+static void fanout_remove_at(mp_camera_fanout_obj_t *self, size_t i) {
+    memmove(&self->sinks[i], &self->sinks[i + 1], (self->len - i - 1) * sizeof(fanout_sink_t));
+    self->len--;
+    memset(&self->sinks[self->len], 0, sizeof(fanout_sink_t));
+}
+
+// Pumps all sinks without blocking. Sinks which have disconnected are removed and added to the disconnected list.
+static void fanout_pump(mp_camera_fanout_obj_t *self, mp_obj_t *disconnected) {
+    for (size_t i = 0; i < self->len;) {
+        fanout_sink_t *sink = &self->sinks[i];
+        if (sink->writer.source == MP_OBJ_NULL) {
+            i++;
+            continue;
+        }
+        int errcode;
+        if (mp_camera_mjpeg_writer_pump(&sink->writer, &errcode)) {
+            sink->delivered++;
+        } else if (errcode != MP_EAGAIN && errcode != MP_ETIMEDOUT) {
+            if (!mp_camera_mjpeg_disconnected(errcode)) {
+                mp_raise_OSError(errcode);
+            }
+            if (*disconnected == MP_OBJ_NULL) {
+                *disconnected = mp_obj_new_list(0, NULL);
+            }
+            mp_obj_list_append(*disconnected, sink->writer.stream);
+            fanout_remove_at(self, i);
+            continue;
+        }
+        i++;
+    }
+}
+
+// The held frame becomes invalid, if the buffers are freed or the camera is reconfigured or deinitialized
+static bool fanout_frame_valid(mp_camera_fanout_obj_t *self) {
+    mp_camera_frame_obj_t *frame = MP_OBJ_TO_PTR(self->frame);
+    return frame->buf && mp_camera_hal_frame_valid(fanout_camera(self), frame->seq);
+}
+
+// Forgets an invalid held frame. Sinks still sending it count the part as dropped and wait for the next frame.
+static void fanout_drop_frame(mp_camera_fanout_obj_t *self) {
+    for (size_t i = 0; i < self->len; i++) {
+        if (self->sinks[i].writer.source == self->frame) {
+            self->sinks[i].writer.source = MP_OBJ_NULL;
+            self->sinks[i].dropped++;
+        }
+    }
+    self->frame = MP_OBJ_NULL;
+}
+
+// Gives the frame buffer back. Sinks still sending the frame continue from a copy.
+static void fanout_release_frame(mp_camera_fanout_obj_t *self) {
+    if (self->frame == MP_OBJ_NULL) {
+        return;
+    }
+    if (!fanout_frame_valid(self)) {
+        fanout_drop_frame(self);
+        return;
+    }
+    mp_camera_frame_obj_t *frame = MP_OBJ_TO_PTR(self->frame);
+    mp_obj_t copy = MP_OBJ_NULL;
+    for (size_t i = 0; i < self->len; i++) {
+        if (self->sinks[i].writer.source == self->frame) {
+            if (copy == MP_OBJ_NULL) {
+                copy = mp_obj_new_bytes(frame->buf, frame->len);
+            }
+            self->sinks[i].writer.source = copy;
+        }
+    }
+    mp_camera_hal_release_frame(fanout_camera(self), frame->seq);
+    self->frame = MP_OBJ_NULL;
+}
+
+static mp_obj_t fanout_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    enum { ARG_camera, ARG_boundary, ARG_max_fps };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_camera, MP_ARG_OBJ | MP_ARG_REQUIRED },
+        { MP_QSTR_boundary, MP_ARG_OBJ | MP_ARG_KW_ONLY, {.u_obj = MP_ROM_QSTR(MP_QSTR_frame)} },
+        { MP_QSTR_max_fps, MP_ARG_INT | MP_ARG_KW_ONLY, {.u_int = 0} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_obj_t camera = mp_obj_cast_to_native_base(args[ARG_camera].u_obj, MP_OBJ_FROM_PTR(&camera_type));
+    if (camera == MP_OBJ_NULL) {
+        mp_raise_TypeError(MP_ERROR_TEXT("expected a Camera"));
+    }
+    mp_camera_fanout_obj_t *self = mp_obj_malloc(mp_camera_fanout_obj_t, type);
+    self->camera = camera;
+    self->frame = MP_OBJ_NULL;
+    self->len = 0;
+    self->alloc = 4;
+    self->sinks = m_new0(fanout_sink_t, self->alloc);
+    self->interval_ms = args[ARG_max_fps].u_int > 0 ? 1000 / args[ARG_max_fps].u_int : 0;
+    self->next_ms = mp_hal_ticks_ms();
+    self->boundary = args[ARG_boundary].u_obj;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+static mp_obj_t fanout_add(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    mp_camera_fanout_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    enum { ARG_sink, ARG_boundary };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_sink, MP_ARG_OBJ | MP_ARG_REQUIRED },
+        { MP_QSTR_boundary, MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_obj_t sink_obj = args[ARG_sink].u_obj;
+    mp_obj_t boundary_obj = args[ARG_boundary].u_obj != MP_OBJ_NULL ? args[ARG_boundary].u_obj : self->boundary;
+    size_t boundary_len = 0;
+    const char *boundary = boundary_obj != mp_const_none ? mp_obj_str_get_data(boundary_obj, &boundary_len) : NULL;
+
+    // A slow sink must not stall the others, so sockets are switched to non-blocking mode
+    mp_obj_t dest[3];
+    mp_load_method_maybe(sink_obj, MP_QSTR_setblocking, dest);
+    if (dest[0] != MP_OBJ_NULL) {
+        dest[2] = mp_const_false;
+        mp_call_method_n_kw(1, 0, dest);
+    }
+
+    if (self->len == self->alloc) {
+        self->sinks = m_renew(fanout_sink_t, self->sinks, self->alloc, self->alloc * 2);
+        memset(&self->sinks[self->alloc], 0, self->alloc * sizeof(fanout_sink_t));
+        self->alloc *= 2;
+    }
+    fanout_sink_t *sink = &self->sinks[self->len];
+    mp_camera_mjpeg_writer_init(&sink->writer, sink_obj, boundary, boundary_len);
+    sink->delivered = 0;
+    sink->dropped = 0;
+    self->len++;
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_KW(fanout_add_obj, 2, fanout_add);
+
+static mp_obj_t fanout_remove(mp_obj_t self_in, mp_obj_t sink_obj) {
+    mp_camera_fanout_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    for (size_t i = 0; i < self->len; i++) {
+        if (self->sinks[i].writer.stream == sink_obj) {
+            fanout_remove_at(self, i);
+            return mp_const_none;
+        }
+    }
+    mp_raise_ValueError(MP_ERROR_TEXT("sink not found"));
+}
+static MP_DEFINE_CONST_FUN_OBJ_2(fanout_remove_obj, fanout_remove);
+
+// Sends pending data, captures the next frame (if due) and hands it to all idle sinks.
+// Returns the sinks which have disconnected (and have been removed), without allocating if there are none.
+static mp_obj_t fanout_step(mp_obj_t self_in) {
+    mp_camera_fanout_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_t disconnected = MP_OBJ_NULL;
+
+    if (self->frame != MP_OBJ_NULL && !fanout_frame_valid(self)) {
+        fanout_drop_frame(self);
+    }
+    fanout_pump(self, &disconnected);
+    bool due = !self->interval_ms || (mp_int_t)(mp_hal_ticks_ms() - self->next_ms) >= 0;
+    if (self->len && due) {
+        // Release the previous frame first, so a single frame buffer (fb_count = 1) is sufficient
+        fanout_release_frame(self);
+        mp_obj_t frame = mp_camera_hal_capture(fanout_camera(self), -1, true);
+        if (frame != mp_const_none) {
+            self->frame = frame;
+            for (size_t i = 0; i < self->len; i++) {
+                fanout_sink_t *sink = &self->sinks[i];
+                if (sink->writer.source != MP_OBJ_NULL) {
+                    sink->dropped++;
+                } else {
+                    mp_camera_mjpeg_writer_begin(&sink->writer, frame);
+                }
+            }
+            fanout_pump(self, &disconnected);
+        }
+        if (self->interval_ms) {
+            self->next_ms += self->interval_ms;
+            if ((mp_int_t)(mp_hal_ticks_ms() - self->next_ms) > 0) {
+                self->next_ms = mp_hal_ticks_ms();  // Do not catch up after a stall
+            }
+        }
+    }
+    return disconnected != MP_OBJ_NULL ? disconnected : mp_const_empty_tuple;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(fanout_step_obj, fanout_step);
+
+static mp_obj_t fanout_stats(mp_obj_t self_in) {
+    mp_camera_fanout_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    for (size_t i = 0; i < self->len; i++) {
+        mp_obj_t items[] = {
+            self->sinks[i].writer.stream,
+            mp_obj_new_int_from_uint(self->sinks[i].delivered),
+            mp_obj_new_int_from_uint(self->sinks[i].dropped),
+        };
+        mp_obj_list_append(list, mp_obj_new_tuple(MP_ARRAY_SIZE(items), items));
+    }
+    return list;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(fanout_stats_obj, fanout_stats);
+
+static mp_obj_t fanout_close(mp_obj_t self_in) {
+    mp_camera_fanout_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    fanout_release_frame(self);
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(fanout_close_obj, fanout_close);
+
+static mp_obj_t fanout_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
+    mp_camera_fanout_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    switch (op) {
+        case MP_UNARY_OP_BOOL:
+            return mp_obj_new_bool(self->len != 0);
+        case MP_UNARY_OP_LEN:
+            return MP_OBJ_NEW_SMALL_INT(self->len);
+        default:
+            return MP_OBJ_NULL;
+    }
+}
+
+static const mp_rom_map_elem_t fanout_locals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_add), MP_ROM_PTR(&fanout_add_obj) },
+    { MP_ROM_QSTR(MP_QSTR_remove), MP_ROM_PTR(&fanout_remove_obj) },
+    { MP_ROM_QSTR(MP_QSTR_step), MP_ROM_PTR(&fanout_step_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stats), MP_ROM_PTR(&fanout_stats_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close), MP_ROM_PTR(&fanout_close_obj) },
+};
+static MP_DEFINE_CONST_DICT(fanout_locals_dict, fanout_locals_table);
+
+MP_DEFINE_CONST_OBJ_TYPE(
+    mp_camera_fanout_type,
+    MP_QSTR_FanOut,
+    MP_TYPE_FLAG_NONE,
+    make_new, fanout_make_new,
+    unary_op, fanout_unary_op,
+    locals_dict, &fanout_locals_dict
+);
+
+// AVIRecorder: appends JPEG frames to an AVI file. Frames are copied into a staging ring buffer, which is written
+// in batches aligned to the file offset, so slow storage delays the writes instead of the captures.
+
+#define AVI_DEFAULT_BUFFER_SIZE (128 * 1024)
+#define AVI_DEFAULT_BATCH_SIZE  (16 * 1024)
+#define AVI_INDEX_BLOCK         (32)    // Index entries written at once
+
+typedef struct mp_camera_avi_recorder_obj {
+    mp_obj_base_t   base;
+    mp_obj_t        camera;
+    mp_obj_t        stream;
+    uint8_t         *ring;              // Staging buffer, the byte at file offset pos is at ring[pos % ring_size]
+    size_t          ring_size;          // Multiple of batch_size
+    size_t          batch_size;
+    uint32_t        staged;             // File offset of the end of the staged data
+    uint32_t        written;            // File offset of the end of the written data
+    uint32_t        *index;             // Offset (relative to the first frame) and length of each frame
+    size_t          index_alloc;
+    camera_avi_info_t info;
+    int64_t         first_us;
+    int64_t         last_us;
+    uint32_t        last_sequence;
+    uint32_t        dropped;            // Frames not recorded, because the staging buffer was full
+    uint32_t        skipped;            // Sensor frames between the recorded ones, which were never captured
+    uint32_t        max_write_us;
+    bool            closed;
+} mp_camera_avi_recorder_obj_t;
+
+static void avi_write(mp_camera_avi_recorder_obj_t *self, const uint8_t *buf, size_t len) {
+    int errcode = 0;
+    mp_uint_t written = mp_stream_rw(self->stream, (void *)buf, len, &errcode, MP_STREAM_RW_WRITE);
+    if (written < len) {
+        mp_raise_OSError(errcode ? errcode : MP_ENOSPC);
+    }
+}
+
+static void avi_seek(mp_camera_avi_recorder_obj_t *self, mp_off_t offset, int whence) {
+    int errcode;
+    if (mp_stream_seek(self->stream, offset, whence, &errcode) == (mp_off_t)-1) {
+        mp_raise_OSError(errcode);
+    }
+}
+
+static void avi_check_open(mp_camera_avi_recorder_obj_t *self) {
+    if (self->closed) {
+        mp_raise_ValueError(MP_ERROR_TEXT("recorder is closed"));
+    }
+}
+
+static void avi_stage(mp_camera_avi_recorder_obj_t *self, const uint8_t *buf, size_t len) {
+    size_t start = self->staged % self->ring_size;
+    size_t first = MIN(len, self->ring_size - start);
+    memcpy(self->ring + start, buf, first);
+    memcpy(self->ring, buf + first, len - first);
+    self->staged += len;
+}
+
+// Writes the staged data up to the next batch boundary. Returns false if there is nothing to write,
+// or the batch is incomplete and partial is false.
+static bool avi_write_batch(mp_camera_avi_recorder_obj_t *self, bool partial) {
+    uint32_t end = (self->written / self->batch_size + 1) * self->batch_size;
+    if (end > self->staged) {
+        if (!partial || self->staged == self->written) {
+            return false;
+        }
+        end = self->staged;
+    }
+    // Batches never wrap around, as the ring size is a multiple of the batch size
+    mp_uint_t start_us = mp_hal_ticks_us();
+    avi_write(self, self->ring + self->written % self->ring_size, end - self->written);
+    self->max_write_us = MAX(self->max_write_us, (uint32_t)(mp_hal_ticks_us() - start_us));
+    self->written = end;
+    return true;
+}
+
+// Stages a frame. Returns false, if it has been dropped, because the staging buffer is full.
+static bool avi_add_frame(mp_camera_avi_recorder_obj_t *self, mp_camera_frame_obj_t *frame) {
+    if (frame->format != PIXFORMAT_JPEG) {
+        mp_raise_ValueError(MP_ERROR_TEXT("AVIRecorder needs JPEG frames"));
+    }
+    camera_avi_info_t *info = &self->info;
+    if (info->frames == 0 && self->dropped == 0) {
+        info->width = frame->width;
+        info->height = frame->height;
+    } else if (frame->width != info->width || frame->height != info->height) {
+        mp_raise_ValueError(MP_ERROR_TEXT("frame size changed"));
+    }
+    uint32_t chunk_size = camera_avi_chunk_size(frame->len);
+    if (chunk_size > self->ring_size) {
+        mp_raise_ValueError(MP_ERROR_TEXT("frame larger than buffer_size"));
+    }
+    if (info->frames && frame->sequence > self->last_sequence + 1) {
+        self->skipped += frame->sequence - self->last_sequence - 1;
+    }
+    self->last_sequence = frame->sequence;
+    if (chunk_size > self->ring_size - (self->staged - self->written)) {
+        self->dropped++;
+        return false;
+    }
+
+    if (info->frames == self->index_alloc) {
+        self->index = m_renew(uint32_t, self->index, 2 * self->index_alloc, 4 * self->index_alloc);
+        self->index_alloc *= 2;
+    }
+    self->index[2 * info->frames] = self->staged - CAMERA_AVI_HEADER_SIZE;
+    self->index[2 * info->frames + 1] = frame->len;
+
+    uint8_t header[CAMERA_AVI_CHUNK_HEADER_SIZE];
+    camera_avi_chunk_header(frame->len, header);
+    avi_stage(self, header, sizeof(header));
+    avi_stage(self, frame->buf, frame->len);
+    if (frame->len & 1) {
+        avi_stage(self, (const uint8_t *)"", 1);
+    }
+
+    if (info->frames == 0) {
+        self->first_us = frame->timestamp_us;
+    }
+    self->last_us = frame->timestamp_us;
+    info->frames++;
+    info->movi_size += chunk_size;
+    info->max_len = MAX(info->max_len, frame->len);
+    return true;
+}
+
+// Writes one batch, or more if the staging buffer is more than half full
+static void avi_pump(mp_camera_avi_recorder_obj_t *self) {
+    if (!avi_write_batch(self, false)) {
+        return;
+    }
+    while (self->staged - self->written > self->ring_size / 2 && avi_write_batch(self, false)) {
+    }
+}
+
+static void avi_update_info(mp_camera_avi_recorder_obj_t *self) {
+    camera_avi_info_t *info = &self->info;
+    info->us_per_frame = info->frames > 1 ? (uint32_t)((self->last_us - self->first_us) / (info->frames - 1)) : 0;
+}
+
+// AVIRecorder(camera, stream, *, buffer_size=131072, batch_size=16384)
+static mp_obj_t avi_recorder_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    enum { ARG_camera, ARG_stream, ARG_buffer_size, ARG_batch_size };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_camera, MP_ARG_OBJ | MP_ARG_REQUIRED },
+        { MP_QSTR_stream, MP_ARG_OBJ | MP_ARG_REQUIRED },
+        { MP_QSTR_buffer_size, MP_ARG_INT | MP_ARG_KW_ONLY, {.u_int = AVI_DEFAULT_BUFFER_SIZE} },
+        { MP_QSTR_batch_size, MP_ARG_INT | MP_ARG_KW_ONLY, {.u_int = AVI_DEFAULT_BATCH_SIZE} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_obj_t camera = mp_obj_cast_to_native_base(args[ARG_camera].u_obj, MP_OBJ_FROM_PTR(&camera_type));
+    if (camera == MP_OBJ_NULL) {
+        mp_raise_TypeError(MP_ERROR_TEXT("expected a Camera"));
+    }
+    mp_int_t batch_size = args[ARG_batch_size].u_int;
+    if (batch_size < 512 || batch_size % 512) {
+        mp_raise_ValueError(MP_ERROR_TEXT("batch_size must be a multiple of 512"));
+    }
+    // At least two batches, so one can be written while the next one fills
+    mp_int_t batches = MAX(2, (args[ARG_buffer_size].u_int + batch_size - 1) / batch_size);
+    mp_get_stream_raise(args[ARG_stream].u_obj, MP_STREAM_OP_WRITE | MP_STREAM_OP_IOCTL);
+
+    mp_camera_avi_recorder_obj_t *self = mp_obj_malloc(mp_camera_avi_recorder_obj_t, type);
+    self->camera = camera;
+    self->stream = args[ARG_stream].u_obj;
+    self->batch_size = batch_size;
+    self->ring_size = batches * batch_size;
+    self->ring = m_new(uint8_t, self->ring_size);
+    self->index_alloc = 64;
+    self->index = m_new(uint32_t, 2 * self->index_alloc);
+    memset(&self->info, 0, sizeof(self->info));
+    self->staged = self->written = CAMERA_AVI_HEADER_SIZE;
+    self->first_us = self->last_us = 0;
+    self->last_sequence = 0;
+    self->dropped = self->skipped = 0;
+    self->max_write_us = 0;
+    self->closed = false;
+
+    // Placeholder, the header is written again by close
+    uint8_t header[CAMERA_AVI_HEADER_SIZE];
+    camera_avi_header(&self->info, header);
+    avi_write(self, header, sizeof(header));
+    return MP_OBJ_FROM_PTR(self);
+}
+
+// Captures a frame, stages it and writes staged data. Returns True, if the frame has been recorded.
+static mp_obj_t avi_recorder_step(mp_obj_t self_in) {
+    mp_camera_avi_recorder_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    avi_check_open(self);
+    mp_camera_obj_t *camera = MP_OBJ_TO_PTR(self->camera);
+    mp_obj_t frame_obj = mp_camera_hal_capture(camera, -1, true);
+    bool added = false;
+    if (frame_obj != mp_const_none) {
+        mp_camera_frame_obj_t *frame = MP_OBJ_TO_PTR(frame_obj);
+        // The frame buffer goes back to the driver right after the copy, storage writes do not hold it
+        nlr_buf_t nlr;
+        if (nlr_push(&nlr) == 0) {
+            added = avi_add_frame(self, frame);
+            nlr_pop();
+        } else {
+            mp_camera_hal_release_frame(camera, frame->seq);
+            nlr_jump(nlr.ret_val);
+        }
+        mp_camera_hal_release_frame(camera, frame->seq);
+    }
+    avi_pump(self);
+    return mp_obj_new_bool(added);
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(avi_recorder_step_obj, avi_recorder_step);
+
+static mp_obj_t avi_recorder_add(mp_obj_t self_in, mp_obj_t frame_in) {
+    mp_camera_avi_recorder_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    avi_check_open(self);
+    bool added = avi_add_frame(self, mp_camera_frame_get_valid(frame_in));
+    avi_pump(self);
+    return mp_obj_new_bool(added);
+}
+static MP_DEFINE_CONST_FUN_OBJ_2(avi_recorder_add_obj, avi_recorder_add);
+
+static mp_obj_t avi_recorder_flush(mp_obj_t self_in) {
+    mp_camera_avi_recorder_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    avi_check_open(self);
+    while (avi_write_batch(self, true)) {
+    }
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(avi_recorder_flush_obj, avi_recorder_flush);
+
+// Writes the staged frames and the index, and completes the header. The stream is not closed.
+static mp_obj_t avi_recorder_close(mp_obj_t self_in) {
+    mp_camera_avi_recorder_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->closed) {
+        return mp_const_none;
+    }
+    avi_recorder_flush(self_in);
+    self->closed = true;
+    m_del(uint8_t, self->ring, self->ring_size);
+    self->ring = NULL;
+
+    camera_avi_info_t *info = &self->info;
+    avi_update_info(self);
+    uint8_t buf[AVI_INDEX_BLOCK * CAMERA_AVI_INDEX_ENTRY_SIZE];
+    camera_avi_index_header(info, buf);
+    avi_write(self, buf, CAMERA_AVI_CHUNK_HEADER_SIZE);
+    for (uint32_t i = 0; i < info->frames; i += AVI_INDEX_BLOCK) {
+        uint32_t n = MIN(AVI_INDEX_BLOCK, info->frames - i);
+        for (uint32_t j = 0; j < n; j++) {
+            camera_avi_index_entry(self->index[2 * (i + j)], self->index[2 * (i + j) + 1], buf + j * CAMERA_AVI_INDEX_ENTRY_SIZE);
+        }
+        avi_write(self, buf, n * CAMERA_AVI_INDEX_ENTRY_SIZE);
+    }
+    m_del(uint32_t, self->index, 2 * self->index_alloc);
+    self->index = NULL;
+
+    uint8_t header[CAMERA_AVI_HEADER_SIZE];
+    camera_avi_header(info, header);
+    avi_seek(self, 0, MP_SEEK_SET);
+    avi_write(self, header, sizeof(header));
+    avi_seek(self, 0, MP_SEEK_END);
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(avi_recorder_close_obj, avi_recorder_close);
+
+static mp_obj_t avi_recorder___exit__(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    return avi_recorder_close(args[0]);
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(avi_recorder___exit___obj, 4, 4, avi_recorder___exit__);
+
+static mp_obj_t avi_recorder_stats(mp_obj_t self_in) {
+    mp_camera_avi_recorder_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    avi_update_info(self);
+    const camera_avi_info_t *info = &self->info;
+    mp_obj_t dict = mp_obj_new_dict(7);
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_frames), mp_obj_new_int_from_uint(info->frames));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_dropped), mp_obj_new_int_from_uint(self->dropped));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_skipped), mp_obj_new_int_from_uint(self->skipped));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_bytes), mp_obj_new_int_from_uint(self->written));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_pending), mp_obj_new_int_from_uint(self->staged - self->written));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_fps), mp_obj_new_float(info->us_per_frame
+        ? MICROPY_FLOAT_CONST(1000000.0) / info->us_per_frame : MICROPY_FLOAT_CONST(0.0)));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_max_write_us), mp_obj_new_int_from_uint(self->max_write_us));
+    return dict;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(avi_recorder_stats_obj, avi_recorder_stats);
+
+static const mp_rom_map_elem_t avi_recorder_locals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_step), MP_ROM_PTR(&avi_recorder_step_obj) },
+    { MP_ROM_QSTR(MP_QSTR_add), MP_ROM_PTR(&avi_recorder_add_obj) },
+    { MP_ROM_QSTR(MP_QSTR_flush), MP_ROM_PTR(&avi_recorder_flush_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close), MP_ROM_PTR(&avi_recorder_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stats), MP_ROM_PTR(&avi_recorder_stats_obj) },
+    { MP_ROM_QSTR(MP_QSTR___enter__), MP_ROM_PTR(&mp_identity_obj) },
+    { MP_ROM_QSTR(MP_QSTR___exit__), MP_ROM_PTR(&avi_recorder___exit___obj) },
+};
+static MP_DEFINE_CONST_DICT(avi_recorder_locals_dict, avi_recorder_locals_table);
+
+MP_DEFINE_CONST_OBJ_TYPE(
+    mp_camera_avi_recorder_type,
+    MP_QSTR_AVIRecorder,
+    MP_TYPE_FLAG_NONE,
+    make_new, avi_recorder_make_new,
+    locals_dict, &avi_recorder_locals_dict
+);
+
+// PreEventBuffer: keeps the most recent frames within a byte budget (and optionally an age), e.g. fed by on_frame,
+// and dumps them as a recording (see camera_replay.h) when an event happens.
+
+typedef struct mp_camera_pre_event_obj {
+    mp_obj_base_t   base;
+    camera_ring_t   ring;
+    int64_t         max_age_us;         // 0 if frames are only evicted by the byte budget
+    mp_camera_pixformat_t format;       // Format and size of the frames in the ring
+    uint16_t        width;
+    uint16_t        height;
+    uint32_t        dropped;            // Frames not stored, because they were larger than the buffer or added during a dump
+    bool            dumping;
+} mp_camera_pre_event_obj_t;
+
+// PreEventBuffer(size, *, max_frames=300, max_age_ms=0)
+static mp_obj_t pre_event_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    enum { ARG_size, ARG_max_frames, ARG_max_age_ms };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_size, MP_ARG_INT | MP_ARG_REQUIRED },
+        { MP_QSTR_max_frames, MP_ARG_INT | MP_ARG_KW_ONLY, {.u_int = 300} },
+        { MP_QSTR_max_age_ms, MP_ARG_INT | MP_ARG_KW_ONLY, {.u_int = 0} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_int_t size = args[ARG_size].u_int;
+    mp_int_t max_frames = args[ARG_max_frames].u_int;
+    if (size <= 0 || max_frames <= 0 || args[ARG_max_age_ms].u_int < 0) {
+        mp_raise_ValueError(MP_ERROR_TEXT("size, max_frames and max_age_ms must be positive"));
+    }
+    mp_camera_pre_event_obj_t *self = mp_obj_malloc(mp_camera_pre_event_obj_t, type);
+    // The GC heap is in PSRAM on boards with PSRAM, the frame buffers use the remaining PSRAM (see memory_plan)
+    camera_ring_init(&self->ring, m_new(uint8_t, size), size, m_new(camera_ring_entry_t, max_frames), max_frames);
+    self->max_age_us = (int64_t)args[ARG_max_age_ms].u_int * 1000;
+    self->format = 0;
+    self->width = 0;
+    self->height = 0;
+    self->dropped = 0;
+    self->dumping = false;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+// Copies a frame into the ring. Returns False, if the frame has not been stored.
+// A frame of another pixel format or size starts a new window.
+static mp_obj_t pre_event_add(mp_obj_t self_in, mp_obj_t frame_in) {
+    mp_camera_pre_event_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_camera_frame_obj_t *frame = mp_camera_frame_get_valid(frame_in);
+    if (self->dumping) {
+        self->dropped++;
+        return mp_const_false;
+    }
+    if (frame->format != self->format || frame->width != self->width || frame->height != self->height) {
+        camera_ring_clear(&self->ring);
+        self->format = frame->format;
+        self->width = frame->width;
+        self->height = frame->height;
+    }
+    uint8_t *dst = camera_ring_push(&self->ring, frame->len, frame->timestamp_us, frame->sequence);
+    if (dst == NULL) {
+        self->dropped++;
+        return mp_const_false;
+    }
+    memcpy(dst, frame->buf, frame->len);
+    if (self->max_age_us) {
+        camera_ring_evict_before(&self->ring, frame->timestamp_us - self->max_age_us);
+    }
+    return mp_const_true;
+}
+static MP_DEFINE_CONST_FUN_OBJ_2(pre_event_add_obj, pre_event_add);
+
+static void pre_event_write(mp_obj_t stream, const uint8_t *buf, size_t len) {
+    int errcode = 0;
+    mp_uint_t written = mp_stream_rw(stream, (void *)buf, len, &errcode, MP_STREAM_RW_WRITE);
+    if (written < len) {
+        mp_raise_OSError(errcode ? errcode : MP_ENOSPC);
+    }
+}
+
+static void pre_event_write_frames(mp_camera_pre_event_obj_t *self, mp_obj_t stream) {
+    uint8_t header[CAMERA_REPLAY_HEADER_SIZE];
+    camera_replay_put_header(header, (camera_conv_format_t)self->format, self->width, self->height);
+    pre_event_write(stream, header, sizeof(header));
+    for (size_t i = 0; i < self->ring.count; i++) {
+        const camera_ring_entry_t *entry = camera_ring_get(&self->ring, i);
+        uint8_t record[CAMERA_REPLAY_RECORD_SIZE];
+        camera_replay_put_record(record, entry->timestamp_us, entry->len);
+        pre_event_write(stream, record, sizeof(record));
+        pre_event_write(stream, self->ring.buf + entry->offset, entry->len);
+    }
+}
+
+// Writes the frames, oldest first, as a recording to stream and returns their number. The frames stay in the ring.
+// Frames added meanwhile (e.g. by on_frame while a socket blocks) are dropped, as they would overwrite the window.
+static mp_obj_t pre_event_dump(mp_obj_t self_in, mp_obj_t stream) {
+    mp_camera_pre_event_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_get_stream_raise(stream, MP_STREAM_OP_WRITE);
+    if (self->dumping) {
+        mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("dump in progress"));
+    }
+    self->dumping = true;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        pre_event_write_frames(self, stream);
+        nlr_pop();
+    } else {
+        self->dumping = false;
+        nlr_jump(nlr.ret_val);
+    }
+    self->dumping = false;
+    return MP_OBJ_NEW_SMALL_INT(self->ring.count);
+}
+static MP_DEFINE_CONST_FUN_OBJ_2(pre_event_dump_obj, pre_event_dump);
+
+static mp_obj_t pre_event_clear(mp_obj_t self_in) {
+    mp_camera_pre_event_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    camera_ring_clear(&self->ring);
+    self->dropped = 0;
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(pre_event_clear_obj, pre_event_clear);
+
+static mp_obj_t pre_event_stats(mp_obj_t self_in) {
+    mp_camera_pre_event_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    const camera_ring_t *ring = &self->ring;
+    int64_t span_us = ring->count
+        ? camera_ring_get(ring, ring->count - 1)->timestamp_us - camera_ring_get(ring, 0)->timestamp_us
+        : 0;
+    mp_obj_t dict = mp_obj_new_dict(5);
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_frames), mp_obj_new_int_from_uint(ring->count));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_bytes), mp_obj_new_int_from_uint(ring->bytes));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_span_us), mp_obj_new_int_from_ll(span_us));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_evicted), mp_obj_new_int_from_uint(ring->evicted));
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_dropped), mp_obj_new_int_from_uint(self->dropped));
+    return dict;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(pre_event_stats_obj, pre_event_stats);
+
+static mp_obj_t pre_event_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
+    mp_camera_pre_event_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    switch (op) {
+        case MP_UNARY_OP_BOOL:
+            return mp_obj_new_bool(self->ring.count != 0);
+        case MP_UNARY_OP_LEN:
+            return MP_OBJ_NEW_SMALL_INT(self->ring.count);
+        default:
+            return MP_OBJ_NULL;
+    }
+}
+
+static const mp_rom_map_elem_t pre_event_locals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_add), MP_ROM_PTR(&pre_event_add_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dump), MP_ROM_PTR(&pre_event_dump_obj) },
+    { MP_ROM_QSTR(MP_QSTR_clear), MP_ROM_PTR(&pre_event_clear_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stats), MP_ROM_PTR(&pre_event_stats_obj) },
+};
+static MP_DEFINE_CONST_DICT(pre_event_locals_dict, pre_event_locals_table);
+
+MP_DEFINE_CONST_OBJ_TYPE(
+    mp_camera_pre_event_type,
+    MP_QSTR_PreEventBuffer,
+    MP_TYPE_FLAG_NONE,
+    make_new, pre_event_make_new,
+    unary_op, pre_event_unary_op,
+    locals_dict, &pre_event_locals_dict
+);
+
+// encode_jpeg: software JPEG encoding of raw frames, e.g. for sensors without JPEG support.
+// With a stream, the JPEG is written in chunks while it is encoded, so there is no buffer for the whole JPEG.
+
+typedef struct {
+    mp_obj_t    stream;
+    int         errcode;
+} jpeg_stream_t;
+
+static bool jpeg_stream_write(void *ctx, const uint8_t *data, size_t len) {
+    jpeg_stream_t *out = ctx;
+    mp_uint_t written = mp_stream_rw(out->stream, (void *)data, len, &out->errcode, MP_STREAM_RW_WRITE);
+    return written == len;
+}
+
+// encode_jpeg(frame, stream=None, *, quality=None, subsampling=420, chunk_size=512)
+// Returns a new JPEG frame, or the number of bytes written to stream.
+static mp_obj_t mp_camera_encode_jpeg(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_frame, ARG_stream, ARG_quality, ARG_subsampling, ARG_chunk_size };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_frame, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_stream, MP_ARG_OBJ, {.u_obj = MP_ROM_NONE} },
+        { MP_QSTR_quality, MP_ARG_OBJ | MP_ARG_KW_ONLY, {.u_obj = MP_ROM_NONE} },
+        { MP_QSTR_subsampling, MP_ARG_INT | MP_ARG_KW_ONLY, {.u_int = CAMERA_JPEG_SUBSAMPLING_420} },
+        { MP_QSTR_chunk_size, MP_ARG_INT | MP_ARG_KW_ONLY, {.u_int = MICROPY_CAMERA_JPEG_CHUNK_SIZE} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_camera_frame_obj_t *frame = mp_camera_frame_get_valid(args[ARG_frame].u_obj);
+    camera_conv_format_t format = (camera_conv_format_t)frame->format;
+    if (!camera_jpeg_supported(format)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("JPEG encoding needs RGB565, YUV422 or GRAYSCALE frames"));
+    }
+    if (frame->len < (size_t)frame->width * frame->height * camera_conv_bytes_per_pixel(format)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("Frame is too short for its size"));
+    }
+    if (format == CAMERA_CONV_YUV422 && (frame->width & 1)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("YUV422 frames need an even width"));
+    }
+    mp_int_t subsampling = args[ARG_subsampling].u_int;
+    if (subsampling != CAMERA_JPEG_SUBSAMPLING_444 && subsampling != CAMERA_JPEG_SUBSAMPLING_422
+        && subsampling != CAMERA_JPEG_SUBSAMPLING_420) {
+        mp_raise_ValueError(MP_ERROR_TEXT("subsampling must be 444, 422 or 420"));
+    }
+    // By default the quality of the camera, so software and hardware encoded frames look alike
+    mp_int_t quality = MICROPY_CAMERA_JPEG_QUALITY;
+    if (args[ARG_quality].u_obj != mp_const_none) {
+        quality = mp_obj_get_int(args[ARG_quality].u_obj);
+    } else if (frame->camera) {
+        quality = mp_camera_hal_get_quality(frame->camera);
+    }
+    if (quality < 0 || quality > 100) {
+        mp_raise_ValueError(MP_ERROR_TEXT("quality must be between 0 and 100"));
+    }
+
+    if (args[ARG_stream].u_obj == mp_const_none) {
+        mp_obj_t jpeg = mp_camera_frame_new_jpeg(frame->buf, frame->width, frame->height, frame->format,
+            quality, subsampling, frame->timestamp_us, frame->sequence);
+        if (jpeg == MP_OBJ_NULL) {
+            mp_raise_msg(&mp_type_OSError, MP_ERROR_TEXT("Failed to convert image"));
+        }
+        return jpeg;
+    }
+
+    mp_int_t chunk_len = args[ARG_chunk_size].u_int;
+    if (chunk_len < 64) {
+        mp_raise_ValueError(MP_ERROR_TEXT("chunk_size must be at least 64"));
+    }
+    jpeg_stream_t out = { args[ARG_stream].u_obj, 0 };
+    mp_get_stream_raise(out.stream, MP_STREAM_OP_WRITE);
+    uint8_t *chunk = m_new(uint8_t, chunk_len);
+    size_t len = camera_jpeg_encode(format, frame->buf, frame->width, frame->height, quality,
+        (camera_jpeg_subsampling_t)subsampling, chunk, chunk_len, jpeg_stream_write, &out);
+    m_del(uint8_t, chunk, chunk_len);
+    if (len == 0) {
+        mp_raise_OSError(out.errcode ? out.errcode : MP_ENOSPC);
+    }
+    return mp_obj_new_int_from_uint(len);
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(mp_camera_encode_jpeg_obj, 1, mp_camera_encode_jpeg);
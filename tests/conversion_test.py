@@ -0,0 +1,145 @@
+import time
+import gc
+import camera
+from camera import PixelFormat
+
+# Regression suite for the native pixel format conversions.
+# The first part works on synthetic frames and does not need a camera, so it also runs on a host build.
+# The second part benchmarks capture(out_format) on a real camera, if one is available.
+
+BYTES_PER_PIXEL = {
+    PixelFormat.RGB565: 2,
+    PixelFormat.YUV422: 2,
+    PixelFormat.GRAYSCALE: 1,
+    PixelFormat.RGB888: 3,
+    PixelFormat.RGB444: 2,
+    PixelFormat.RGB555: 2,
+}
+
+CONVERSIONS = [
+    (PixelFormat.RGB565, PixelFormat.RGB888),
+    (PixelFormat.RGB565, PixelFormat.GRAYSCALE),
+    (PixelFormat.RGB888, PixelFormat.RGB565),
+    (PixelFormat.RGB888, PixelFormat.GRAYSCALE),
+    (PixelFormat.YUV422, PixelFormat.RGB565),
+    (PixelFormat.YUV422, PixelFormat.RGB888),
+    (PixelFormat.YUV422, PixelFormat.GRAYSCALE),
+    (PixelFormat.GRAYSCALE, PixelFormat.RGB565),
+    (PixelFormat.GRAYSCALE, PixelFormat.RGB888),
+    (PixelFormat.RGB444, PixelFormat.RGB565),
+    (PixelFormat.RGB444, PixelFormat.RGB888),
+    (PixelFormat.RGB555, PixelFormat.RGB565),
+    (PixelFormat.RGB555, PixelFormat.RGB888),
+]
+
+def format_name(fmt):
+    for name in dir(PixelFormat):
+        if not name.startswith('_') and getattr(PixelFormat, name) == fmt:
+            return name
+    return str(fmt)
+
+def test_rgb565_rgb888():
+    print("Test RGB565 <-> RGB888")
+    src = bytes([0xF8, 0x00, 0x07, 0xE0, 0x00, 0x1F, 0xFF, 0xFF])  # red, green, blue, white
+    assert camera.convert(src, PixelFormat.RGB565, PixelFormat.RGB888) == bytearray([255, 0, 0, 0, 255, 0, 0, 0, 255, 255, 255, 255])
+    assert camera.convert(bytes([255, 0, 0, 0, 255, 0, 0, 0, 255, 255, 255, 255]), PixelFormat.RGB888, PixelFormat.RGB565) == bytearray(src)
+
+def test_yuv422():
+    print("Test YUV422 -> RGB565/RGB888/GRAYSCALE")
+    src = bytes([0, 128, 255, 128, 76, 85, 76, 255])  # black, white, red, red
+    assert camera.convert(src, PixelFormat.YUV422, PixelFormat.GRAYSCALE) == bytearray([0, 255, 76, 76])
+    rgb = camera.convert(src, PixelFormat.YUV422, PixelFormat.RGB888)
+    assert rgb[0:6] == bytearray([0, 0, 0, 255, 255, 255])
+    assert rgb[6] > 250 and rgb[7] < 5 and rgb[8] < 5
+    assert camera.convert(src, PixelFormat.YUV422, PixelFormat.RGB565)[0:4] == bytearray([0x00, 0x00, 0xFF, 0xFF])
+    assert camera.convert(src[:6], PixelFormat.YUV422, PixelFormat.GRAYSCALE) == bytearray([0, 255]), "A trailing odd pixel is not converted"
+
+def test_unpack():
+    print("Test RGB444/RGB555 unpack")
+    assert camera.convert(bytes([0x0F, 0x00, 0x00, 0xF0, 0x00, 0x0F]), PixelFormat.RGB444, PixelFormat.RGB888) == bytearray([255, 0, 0, 0, 255, 0, 0, 0, 255])
+    assert camera.convert(bytes([0x7C, 0x00, 0x03, 0xE0, 0x00, 0x1F]), PixelFormat.RGB555, PixelFormat.RGB565) == bytearray([0xF8, 0x00, 0x07, 0xE0, 0x00, 0x1F])
+
+def test_grayscale_roundtrip():
+    print("Test GRAYSCALE roundtrip")
+    gray = bytes(range(256))
+    for fmt in (PixelFormat.RGB565, PixelFormat.RGB888):
+        back = camera.convert(camera.convert(gray, PixelFormat.GRAYSCALE, fmt), fmt, PixelFormat.GRAYSCALE)
+        for i in range(256):
+            assert abs(back[i] - i) <= 8, f"{format_name(fmt)}: {i} -> {back[i]}"
+
+def test_output_buffer():
+    print("Test conversion into output buffer")
+    out = bytearray(12)
+    assert camera.convert(bytes(8), PixelFormat.RGB565, PixelFormat.RGB888, out=out) == 12
+    try:
+        camera.convert(bytes(8), PixelFormat.RGB565, PixelFormat.RGB888, out=bytearray(11))
+        assert False, "Conversion into a too small buffer should have failed"
+    except ValueError:
+        pass
+
+def test_unsupported():
+    print("Test unsupported conversions")
+    for src, dst in ((PixelFormat.JPEG, PixelFormat.RGB565), (PixelFormat.RGB565, PixelFormat.YUV420)):
+        try:
+            camera.convert(bytes(8), src, dst)
+            assert False, "Conversion should have failed"
+        except ValueError:
+            pass
+
+def test_frame():
+    print("Test Frame from a buffer")
+    data = bytearray(range(8))
+    frame = camera.Frame(data, 2, 2, PixelFormat.RGB565, timestamp=42)
+    data[0] = 0xFF  # The frame owns a copy of the data
+    assert bytes(frame) == bytes(range(8))
+    assert (frame.width, frame.height, frame.format, frame.timestamp, len(frame)) == (2, 2, PixelFormat.RGB565, 42, 8)
+    assert camera.Frame(b"\xff\xd8", 640, 480, PixelFormat.JPEG)   # No size check for compressed formats
+    for args in ((bytes(7), 2, 2, PixelFormat.RGB565), (bytes(8), 0, 2, PixelFormat.RGB565), (bytes(8), 2, 2, 99)):
+        try:
+            camera.Frame(*args)
+            assert False, "Frame should have been rejected"
+        except ValueError:
+            pass
+
+def benchmark_conversions(width=320, height=240, rounds=5):
+    print(f"\nConversion benchmark on synthetic {width}x{height} frames:")
+    print(f"{'Conversion':<25}{'ms/frame':<12}{'MPix/s':<10}")
+    for src_fmt, dst_fmt in CONVERSIONS:
+        src = bytes(i & 0xFF for i in range(width * height * BYTES_PER_PIXEL[src_fmt]))
+        out = bytearray(width * height * BYTES_PER_PIXEL[dst_fmt])
+        gc.collect()
+        start = time.ticks_us()
+        for _ in range(rounds):
+            camera.convert(src, src_fmt, dst_fmt, out=out)
+        elapsed = time.ticks_diff(time.ticks_us(), start) / rounds
+        name = f"{format_name(src_fmt)}->{format_name(dst_fmt)}"
+        print(f"{name:<25}{elapsed / 1000:<12.2f}{width * height / elapsed:<10.2f}")
+
+def benchmark_capture(duration=2):
+    try:
+        cam = camera.Camera()
+    except Exception as e:
+        print("\nNo camera available, skipping capture benchmark:", e)
+        return
+    try:
+        print(f"\nCapture benchmark with {cam.get_sensor_name()} ({format_name(cam.get_pixel_format())}):")
+        for out_fmt in [None] + [dst for src, dst in CONVERSIONS if src == cam.get_pixel_format()]:
+            frames = 0
+            start = time.ticks_ms()
+            while time.ticks_diff(time.ticks_ms(), start) < duration * 1000:
+                if cam.capture(out_fmt):
+                    frames += 1
+            print(f"{'native' if out_fmt is None else format_name(out_fmt):<25}{frames / duration:.1f} FPS")
+    finally:
+        cam.deinit()
+
+if __name__ == "__main__":
+    test_rgb565_rgb888()
+    test_yuv422()
+    test_unpack()
+    test_grayscale_roundtrip()
+    test_output_buffer()
+    test_unsupported()
+    test_frame()
+    benchmark_conversions()
+    benchmark_capture()
@@ -1,5 +1,5 @@
 import time
-from camera import Camera, FrameSize, PixelFormat
+from camera import Camera, FrameSize, PixelFormat, MotionDetector, AutoExposure, estimate_memory, stats
 
 def test_property_get_frame_size():
     with Camera() as cam:
@@ -35,6 +35,252 @@ def test_must_be_initialized():
             else:
                 assert True
                 
+def test_frame_lifetime():
+    with Camera(pixel_format=PixelFormat.RGB565, frame_size=FrameSize.QQVGA) as cam:
+        print("Testing frame lifetime")
+        frame = cam.capture()
+        assert frame.width == 160 and frame.height == 120
+        assert frame.format == PixelFormat.RGB565
+        assert len(frame) == 160 * 120 * 2
+        assert len(bytes(frame)) == len(frame)
+        first_timestamp = frame.timestamp
+        head = frame[:16]
+        assert isinstance(head, bytes) and head == bytes(frame)[:16]
+        with cam.capture() as frame2:
+            assert frame2.timestamp > first_timestamp
+            assert not frame, "Previous frame should be invalid after the next capture"
+        assert len(head) == 16, "Slices are copies, which stay valid"
+        assert not frame2
+        for access in (len, bytes, lambda f: f[0]):
+            try:
+                access(frame2)
+                assert False, "Accessing a released frame should fail"
+            except ValueError:
+                pass
+
+def test_frame_sequence():
+    with Camera(pixel_format=PixelFormat.JPEG, frame_size=FrameSize.QVGA) as cam:
+        print("Testing frame sequence numbers and counters")
+        cam.frame_stats(reset=True)
+        last = cam.capture()
+        last_sequence, last_timestamp = last.sequence, last.timestamp
+        for _ in range(10):
+            time.sleep_ms(100)  # Let the sensor deliver frames we do not fetch
+            img = cam.capture()
+            assert img.sequence > last_sequence, "Sequence numbers must increase"
+            assert img.timestamp > last_timestamp, "Timestamps must increase"
+            last_sequence, last_timestamp = img.sequence, img.timestamp
+        stats = cam.frame_stats()
+        assert stats['captured'] == 11
+        assert stats['sequence'] == last_sequence
+        print("\t", stats)
+        assert cam.frame_stats(reset=True)['captured'] == 11
+        assert cam.frame_stats()['captured'] == 0
+
+def test_perf():
+    with Camera(pixel_format=PixelFormat.JPEG, frame_size=FrameSize.QVGA) as cam:
+        print("Testing performance counters")
+        cam.reconfigure(frame_size=FrameSize.QQVGA)
+        p = cam.perf(reset=True)
+        assert p['init']['count'] == 1 and p['switch_sensor']['count'] == 1
+        for _ in range(10):
+            cam.capture()
+        p = cam.perf()
+        assert p['captures'] == 10 and p['failed'] == 0
+        assert p['capture_rate'] > 0
+        assert p['fb_get']['count'] <= 10
+        assert sum(p['fb_get']['histogram']) == p['fb_get']['count']
+        assert p['hold']['count'] == 9, "All but the last frame have been returned"
+        assert len(p['fb_get']['histogram']) == len(p['buckets_us']) + 1
+        print("\tfb_get:", p['fb_get'], "hold:", p['hold'])
+        assert cam.perf(reset=True)['captures'] == 10
+        assert cam.perf()['captures'] == 0
+
+def test_incremental_reconfigure():
+    with Camera(pixel_format=PixelFormat.JPEG, frame_size=FrameSize.VGA) as cam:
+        print("Testing incremental reconfigure")
+        assert cam.reconfigure(frame_size=FrameSize.VGA) == 'none'
+        assert cam.reconfigure(frame_size=FrameSize.QVGA) == 'sensor', "Smaller JPEG frames fit into the buffers"
+        img = cam.capture()
+        assert (img.width, img.height) == (320, 240), "Frames of the previous frame size must be dropped"
+        cam.frame_size = FrameSize.VGA
+        assert cam.capture().width == 640
+        assert cam.reconfigure(fb_count=2) == 'restart'
+        assert cam.reconfigure(pixel_format=PixelFormat.RGB565, frame_size=FrameSize.QQVGA) == 'restart'
+        assert cam.reconfigure(pixel_format=PixelFormat.YUV422) == 'sensor'
+        img = cam.capture()
+        assert img.format == PixelFormat.YUV422 and len(img) == 160 * 120 * 2
+        p = cam.perf()
+        print("\tsensor switch:", p['switch_sensor']['mean_us'], "us, restart:", p['reconfigure']['mean_us'], "us")
+        assert p['switch_sensor']['count'] == 3 and p['reconfigure']['count'] == 2
+
+def test_held_frames():
+    with Camera(pixel_format=PixelFormat.JPEG, fb_count=2) as cam:
+        print("Testing held frames")
+        first = cam.capture(hold=True)
+        second = cam.capture(hold=True)
+        assert first and second, "Held frames should stay valid"
+        try:
+            cam.capture()
+            assert False, "Capture should fail while all frame buffers are held"
+        except OSError:
+            pass
+        first.release()
+        third = cam.capture()
+        assert second and third
+        cam.free_buffer()
+        assert not second and not third
+
+def test_capture_into():
+    with Camera(pixel_format=PixelFormat.RGB565, frame_size=FrameSize.QQVGA) as cam:
+        print("Testing capture_into")
+        buf = bytearray(160 * 120 * 2)
+        assert cam.capture_into(buf) == len(buf)
+        gray = bytearray(160 * 120)
+        assert cam.capture_into(gray, PixelFormat.GRAYSCALE) == len(gray)
+        try:
+            cam.capture_into(bytearray(10))
+            assert False, "Too small buffer should raise ValueError"
+        except ValueError:
+            pass
+        assert cam.capture(), "Frame buffer should be returned after a failed capture_into"
+
+def test_roi():
+    with Camera(pixel_format=PixelFormat.RGB565, frame_size=FrameSize.QQVGA) as cam:
+        print("Testing capture with roi and bin")
+        img = cam.capture(roi=(10, 20, 64, 32))
+        assert (img.width, img.height, len(img)) == (64, 32, 64 * 32 * 2)
+        img = cam.capture(PixelFormat.GRAYSCALE, bin=4)
+        assert (img.width, img.height, img.format, len(img)) == (40, 30, PixelFormat.GRAYSCALE, 40 * 30)
+        for roi in ((-1, 0, 10, 10), (150, 0, 20, 10), (0, 0, 0, 10)):
+            try:
+                cam.capture(roi=roi)
+                assert False, "Invalid roi should raise ValueError"
+            except ValueError:
+                pass
+        try:
+            cam.capture(bin=3)
+            assert False, "Invalid bin should raise ValueError"
+        except ValueError:
+            pass
+        assert cam.capture(), "Frame buffer should be returned after a region capture"
+
+def test_poll():
+    import select
+    with Camera(pixel_format=PixelFormat.JPEG) as cam:
+        print("Testing poll")
+        poller = select.poll()
+        poller.register(cam, select.POLLIN)
+        assert poller.poll(1000), "A frame should be ready within 1s"
+        assert cam.capture()
+
+def test_on_frame():
+    with Camera(pixel_format=PixelFormat.JPEG) as cam:
+        print("Testing on_frame")
+        frames = []
+        def on_frame(frame):
+            assert frame, "Frame should be valid during the callback"
+            frames.append((len(frame), frame))
+        cam.on_frame(on_frame)
+        time.sleep(1)
+        cam.on_frame(None)
+        assert frames, "Callback should have been called within 1s"
+        assert not frames[-1][1], "Frame should be released after the callback"
+
+def test_fanout():
+    import io
+    from camera import FanOut
+    with Camera(pixel_format=PixelFormat.JPEG) as cam:
+        print("Testing fan-out")
+        fan = FanOut(cam)
+        fast = io.BytesIO()
+        raw = io.BytesIO()
+        fan.add(fast)
+        fan.add(raw, None)
+        for _ in range(3):
+            assert not fan.step(), "No sink should disconnect"
+        fan.close()
+        stats = fan.stats()
+        assert [s[1] for s in stats] == [3, 3], "Blocking sinks should get every frame"
+        assert [s[2] for s in stats] == [0, 0]
+        assert fast.getvalue().count(b'--frame\r\n') == 3
+        assert raw.getvalue().startswith(b'\xff\xd8'), "Raw sink should only get JPEG data"
+        fan.remove(raw)
+        assert len(fan) == 1
+
+def test_motion_detector():
+    with Camera(pixel_format=PixelFormat.GRAYSCALE, frame_size=FrameSize.QVGA) as cam:
+        print("Testing motion detector")
+        motion = MotionDetector(grid=(16, 12), threshold=12)
+        assert motion.detect(cam.capture()) == 0, "First frame should only set the reference"
+        start = time.ticks_us()
+        for _ in range(10):
+            score = motion.detect(cam.capture())
+            assert 0 <= score <= 1
+            assert len(motion.mask) == 16 * 12
+            for x, y, w, h in motion.boxes():
+                assert x + w <= 320 and y + h <= 240
+        print("\tDetection time per frame:", time.ticks_diff(time.ticks_us(), start) // 10, "us incl. capture")
+        try:
+            motion.detect(cam.capture(PixelFormat.RGB565))
+            assert False, "RGB565 frames should raise ValueError"
+        except ValueError:
+            pass
+        try:
+            MotionDetector(grid=(64, 1))
+            assert False, "Too fine grid should raise ValueError"
+        except ValueError:
+            pass
+
+def test_stats():
+    for pixel_format, channels in ((PixelFormat.RGB565, 3), (PixelFormat.YUV422, 3), (PixelFormat.GRAYSCALE, 1)):
+        with Camera(pixel_format=pixel_format, frame_size=FrameSize.QQVGA) as cam:
+            print("Testing stats for", pixel_format)
+            img = cam.capture()
+            s = stats(img, stride=2, grid=(4, 3), bins=16)
+            assert len(s['histogram']) == 16 and sum(s['histogram']) == s['samples'] == 80 * 60
+            assert len(s['mean']) == len(s['min']) == len(s['max']) == channels
+            assert all(lo <= m <= hi for lo, m, hi in zip(s['min'], s['mean'], s['max']))
+            assert len(s['grid']) == 12
+            assert stats(img)['samples'] == 160 * 120
+            try:
+                stats(img, stride=64)
+                assert False, "Blocks smaller than the stride should raise ValueError"
+            except ValueError:
+                pass
+
+def test_auto_exposure():
+    with Camera(pixel_format=PixelFormat.RGB565, frame_size=FrameSize.QVGA) as cam:
+        print("Testing auto exposure")
+        ae = AutoExposure(cam, interval=1)
+        assert not cam.get_exposure_ctrl() and not cam.get_gain_ctrl()
+        for _ in range(30):
+            with cam.capture() as img:
+                ae.update(img)
+        print("\tConverged:", ae.converged, "luma:", ae.luma, "after", ae.convergence_ms, "ms /", ae.convergence_frames, "frames")
+        assert 0 <= ae.luma <= 255
+        ae.stop()
+        assert cam.get_exposure_ctrl() and cam.get_gain_ctrl()
+        try:
+            AutoExposure(cam, gain=2)
+            assert False, "Invalid gain should raise ValueError"
+        except ValueError:
+            pass
+
+def test_memory_planner():
+    print("Testing memory planner")
+    plan = estimate_memory(FrameSize.SVGA, PixelFormat.JPEG, 1)
+    assert plan["fb_size"] == 800 * 600 // 5, "JPEG buffers should be sized like in the camera driver"
+    assert estimate_memory(FrameSize.SVGA, PixelFormat.RGB565)["fb_size"] == 800 * 600 * 2
+    with Camera(pixel_format=PixelFormat.JPEG, frame_size=FrameSize.QVGA, fb_count=1) as cam:
+        too_many = plan["max_fb_count"] + 1
+        try:
+            cam.reconfigure(frame_size=FrameSize.SVGA, fb_count=too_many)
+            assert too_many > 8, "Configuration beyond the PSRAM budget should be rejected"
+        except MemoryError:
+            assert cam.get_fb_count() == 1, "Running configuration should stay untouched"
+        assert cam.capture(), "Camera should still capture"
+
 def test_camera_properties():
     with Camera() as cam:
         print(f"Testing get/set methods")
@@ -51,6 +297,64 @@ def test_camera_properties():
                     except Exception:
                         print("\tFailed test for property", prop_name)
 
+def test_subclass_properties():
+    from acamera import Camera as ACamera
+    with ACamera(pixel_format=PixelFormat.JPEG) as cam:
+        print("Testing properties of a subclass")
+        cam.contrast = 1
+        cam.vflip = True
+        assert (cam.contrast, cam.get_contrast(), cam.vflip) == (1, 1, True)
+        assert 'contrast' not in cam.__dict__
+
+    class PlainCamera(Camera):
+        _native_properties = property()
+    with PlainCamera(pixel_format=PixelFormat.JPEG) as cam:
+        cam.brightness = 1
+        assert cam.get_brightness() == 1 and 'brightness' not in cam.__dict__, "One property routes the stores"
+        try:
+            cam.sensor_name = "none"
+            assert False, "Read-only property should not be writable"
+        except AttributeError:
+            pass
+
+def test_apply():
+    with Camera(pixel_format=PixelFormat.JPEG) as cam:
+        print("Testing apply")
+        profile = {'contrast': 1, 'brightness': -1, 'vflip': True, 'exposure_ctrl': False, 'aec_value': 300, 'quality': 70}
+        assert cam.apply(profile) == ()
+        assert (cam.contrast, cam.brightness, cam.vflip, cam.exposure_ctrl, cam.aec_value, cam.quality) == (1, -1, True, False, 300, 70)
+        for invalid in ({'contrast': 0, 'no_such_setting': 1}, {'contrast': 0, 'aec_value': 5000}):
+            try:
+                cam.apply(invalid)
+                assert False, "Invalid batch should have been rejected"
+            except ValueError:
+                pass
+            assert cam.contrast == 1, "Nothing is written before the batch is validated"
+
+        cam.apply({'contrast': -1, 'vflip': False}, deferred=True)
+        assert cam.contrast == 1, "Deferred batches wait for the next frame"
+        applied_after = cam.capture().timestamp
+        assert cam.contrast == -1 and not cam.vflip
+        assert cam.capture().timestamp > applied_after
+
+def test_snapshot_restore():
+    with Camera(pixel_format=PixelFormat.JPEG, frame_size=FrameSize.VGA) as cam:
+        print("Testing snapshot and restore")
+        cam.apply({'contrast': 2, 'hmirror': True, 'wb_mode': 1, 'quality': 60})
+        cam.frame_size = FrameSize.QVGA
+        snapshot = cam.snapshot()
+        print("\tsnapshot:", len(snapshot), "bytes")
+        cam.reconfigure(frame_size=FrameSize.VGA, fb_count=2)  # Restarts the driver, which resets the sensor
+        assert cam.contrast != 2 or not cam.hmirror
+        assert cam.restore(snapshot) == ()
+        assert (cam.frame_size, cam.contrast, cam.hmirror, cam.wb_mode, cam.quality) == (FrameSize.QVGA, 2, True, 1, 60)
+        for invalid in (b'', snapshot[:-2], b'XX' + snapshot[2:], snapshot[:4] + b'\xff\xff' + snapshot[6:]):
+            try:
+                cam.restore(invalid)
+                assert False, "Invalid snapshot should have been rejected"
+            except ValueError:
+                pass
+
 def test_invalid_settings():
     print(f"Testing invalid settings")
     invalid_settings = [
@@ -77,6 +381,23 @@ if __name__ == "__main__":
     test_property_get_frame_size()
     test_property_get_pixel_format()
     test_must_be_initialized()
+    test_frame_lifetime()
+    test_frame_sequence()
+    test_perf()
+    test_incremental_reconfigure()
+    test_held_frames()
+    test_capture_into()
+    test_roi()
+    test_poll()
+    test_on_frame()
+    test_fanout()
+    test_motion_detector()
+    test_stats()
+    test_auto_exposure()
+    test_memory_planner()
     test_camera_properties()
+    test_subclass_properties()
+    test_apply()
+    test_snapshot_restore()
     test_invalid_settings()
 
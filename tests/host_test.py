@@ -0,0 +1,376 @@
+import time
+from camera import Camera, FrameSize, PixelFormat, stats
+
+# Tests of the host build (unix port) with the synthetic sensor, see "Host build (unix port)" in the README.
+# They assume the default frame rate of 30 fps (MICROPY_CAMERA_FPS unset or 30).
+
+FRAME_PERIOD_US = 1000000 // 30
+
+FRAME_LENGTHS = {
+    PixelFormat.RGB565: 2,
+    PixelFormat.YUV422: 2,
+    PixelFormat.RGB444: 2,
+    PixelFormat.RGB555: 2,
+    PixelFormat.RGB888: 3,
+    PixelFormat.GRAYSCALE: 1,
+    PixelFormat.RAW: 1,
+}
+
+def test_sensor_info():
+    with Camera() as cam:
+        print("Test sensor info")
+        assert cam.get_sensor_name() == "SYNTHETIC"
+        assert cam.get_max_frame_size() == FrameSize.QSXGA
+        assert (cam.get_pixel_width(), cam.get_pixel_height()) == (160, 120)
+        try:
+            cam.sensor_name = "none"
+            assert False, "Read-only property should not be writable"
+        except AttributeError:
+            pass
+
+def test_pixel_formats():
+    with Camera(frame_size=FrameSize.QQVGA) as cam:
+        print("Test pixel formats")
+        for fmt, bytes_per_pixel in FRAME_LENGTHS.items():
+            cam.reconfigure(pixel_format=fmt)
+            img = cam.capture()
+            assert img.format == fmt and (img.width, img.height) == (160, 120)
+            assert len(img) == 160 * 120 * bytes_per_pixel, "Unexpected length of format %d" % fmt
+        cam.reconfigure(pixel_format=PixelFormat.YUV420)
+        assert len(cam.capture()) == 160 * 120 * 3 // 2
+        cam.reconfigure(pixel_format=PixelFormat.JPEG)
+        jpeg = bytes(cam.capture())
+        assert jpeg[:2] == b'\xff\xd8' and jpeg[-2:] == b'\xff\xd9'
+
+def test_frame_sizes():
+    with Camera(pixel_format=PixelFormat.GRAYSCALE) as cam:
+        print("Test frame sizes")
+        for frame_size in (FrameSize.R96X96, FrameSize.QVGA, FrameSize.VGA, FrameSize.HD, FrameSize.P_HD):
+            cam.reconfigure(frame_size=frame_size)
+            img = cam.capture()
+            assert (img.width, img.height) == (cam.get_pixel_width(), cam.get_pixel_height())
+            assert len(img) == img.width * img.height
+
+def test_colorbar():
+    with Camera(pixel_format=PixelFormat.RGB888) as cam:
+        print("Test colorbar")
+        cam.colorbar = True
+        first = bytes(cam.capture())
+        assert bytes(cam.capture()) == first, "Color bars do not move"
+        assert first[0:3] == b'\xff\xff\xff', "The first bar is white"
+        assert first[-3:] == b'\x00\x00\x00', "The last bar is black"
+        cam.hmirror = True
+        assert bytes(cam.capture())[0:3] == b'\x00\x00\x00'
+
+def test_moving_scene():
+    with Camera(pixel_format=PixelFormat.GRAYSCALE) as cam:
+        print("Test moving scene")
+        first = bytes(cam.capture())
+        assert bytes(cam.capture()) != first, "Consecutive frames differ"
+        s = stats(cam.capture())
+        assert s['max'][0] > s['min'][0]
+
+def test_brightness():
+    with Camera(pixel_format=PixelFormat.GRAYSCALE) as cam:
+        print("Test brightness")
+        cam.colorbar = True
+        dark = stats(cam.capture())['mean'][0]
+        cam.brightness = 2
+        assert stats(cam.capture())['mean'][0] > dark
+
+def test_frame_timing():
+    with Camera(pixel_format=PixelFormat.JPEG) as cam:
+        print("Test frame timing")
+        cam.frame_stats(reset=True)
+        last = cam.capture()
+        last_sequence, last_timestamp = last.sequence, last.timestamp
+        for _ in range(5):
+            img = cam.capture()
+            assert img.sequence == last_sequence + 1, "Back to back captures get consecutive frames"
+            assert abs(img.timestamp - last_timestamp - FRAME_PERIOD_US) < 100
+            last_sequence, last_timestamp = img.sequence, img.timestamp
+        time.sleep_ms(10 * FRAME_PERIOD_US // 1000)
+        img = cam.capture()
+        assert img.sequence >= last_sequence + 9, "LATEST skips the frames which were not grabbed"
+        s = cam.frame_stats()
+        assert s['captured'] == 7 and s['dropped'] == img.sequence - last_sequence - 1
+        assert s['frame_period_us'] == FRAME_PERIOD_US
+
+def test_reconfigure():
+    with Camera(pixel_format=PixelFormat.JPEG, frame_size=FrameSize.VGA) as cam:
+        print("Test reconfigure")
+        assert cam.reconfigure(frame_size=FrameSize.VGA) == 'none'
+        assert cam.reconfigure(frame_size=FrameSize.QVGA) == 'sensor', "Smaller frames fit into the buffers"
+        assert cam.reconfigure(frame_size=FrameSize.UXGA) == 'restart'
+        assert cam.reconfigure(fb_count=3) == 'restart'
+        assert cam.reconfigure(pixel_format=PixelFormat.GRAYSCALE) == 'restart', "Raw frames are larger than JPEG frames"
+        assert cam.reconfigure(pixel_format=PixelFormat.RGB565, frame_size=FrameSize.VGA) == 'sensor'
+        img = cam.capture()
+        assert img.format == PixelFormat.RGB565 and len(img) == 640 * 480 * 2
+
+def test_apply_snapshot():
+    with Camera() as cam:
+        print("Test apply and snapshot")
+        assert cam.apply({'contrast': 2, 'hmirror': True, 'quality': 60}) == ()
+        snapshot = cam.snapshot()
+        cam.reconfigure(frame_size=FrameSize.VGA, fb_count=3)   # Restarts the sensor, which resets the settings
+        assert cam.contrast == 0 and not cam.hmirror
+        assert cam.restore(snapshot) == ()
+        assert (cam.frame_size, cam.contrast, cam.hmirror, cam.quality) == (FrameSize.QQVGA, 2, True, 60)
+        try:
+            cam.apply({'saturation': 5})
+            assert False, "Values out of range should be rejected"
+        except ValueError:
+            pass
+
+def test_deferred_apply():
+    with Camera() as cam:
+        print("Test deferred apply")
+        cam.apply({'contrast': 1}, deferred=True)
+        cam.perf(reset=True)
+        assert cam.contrast == 0, "Deferred batches wait for the next frame"
+        cam.capture()
+        assert cam.contrast == 1, "Resetting the perf counters keeps the pending batch"
+
+def test_on_frame():
+    with Camera(pixel_format=PixelFormat.JPEG) as cam:
+        print("Test on_frame")
+        frames = []
+        cam.on_frame(lambda frame: frames.append(frame.sequence))
+        time.sleep_ms(500)
+        cam.on_frame(None)
+        assert len(frames) > 5, "The callback should be called for most frames"
+        assert frames == sorted(frames)
+
+def test_poll():
+    import select
+    with Camera(pixel_format=PixelFormat.GRAYSCALE) as cam:
+        print("Test poll")
+        img = cam.capture()
+        poller = select.poll()
+        poller.register(cam, select.POLLIN)
+        for _ in range(3):
+            assert poller.poll(1000), "A frame becomes ready within a frame period"
+        assert img and len(bytes(img)) == 160 * 120, "Polling does not invalidate frames in use"
+        assert cam.capture().sequence > img.sequence
+
+def slow_socket_pair(port):
+    import socket
+    addr = socket.getaddrinfo('127.0.0.1', port)[0][-1]
+    server = socket.socket()
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server.bind(addr)
+    server.listen(1)
+    sender = socket.socket()
+    # Small socket buffers, so a frame never fits in one write (SO_SNDBUF/SO_RCVBUF are 7/8 on Linux)
+    sender.setsockopt(socket.SOL_SOCKET, getattr(socket, 'SO_SNDBUF', 7), 4096)
+    sender.connect(addr)
+    receiver, _ = server.accept()
+    receiver.setsockopt(socket.SOL_SOCKET, getattr(socket, 'SO_RCVBUF', 8), 4096)
+    receiver.setblocking(False)
+    return server, sender, receiver
+
+def test_fanout_nonblocking(port=8766):
+    from camera import FanOut
+    server, sender, receiver = slow_socket_pair(port)
+    try:
+        with Camera(pixel_format=PixelFormat.RGB565, frame_size=FrameSize.VGA) as cam:
+            print("Test fan-out to a non-blocking socket")
+            fan = FanOut(cam, boundary=None)
+            fan.add(sender)
+            frame_len = 640 * 480 * 2
+            received = 0
+            deadline = time.ticks_add(time.ticks_ms(), 5000)
+            while received < frame_len:
+                assert not fan.step(), "Partial writes must not disconnect the sink"
+                try:
+                    received += len(receiver.recv(4096))
+                except OSError:
+                    pass
+                assert time.ticks_diff(deadline, time.ticks_ms()) > 0, "Frame should be delivered within 5s"
+            assert len(fan) == 1
+            fan.close()
+    finally:
+        sender.close()
+        receiver.close()
+        server.close()
+
+def test_fanout_free_buffer(port=8767):
+    from camera import FanOut
+    server, sender, receiver = slow_socket_pair(port)
+    try:
+        with Camera(pixel_format=PixelFormat.RGB565, frame_size=FrameSize.VGA) as cam:
+            print("Test fan-out after free_buffer")
+            fan = FanOut(cam, boundary=None)
+            fan.add(sender)
+            fan.step()
+            cam.free_buffer()   # Invalidates the frame which is still being sent
+            assert not fan.step(), "The sink should be kept"
+            assert fan.stats()[0][2] == 1, "The part in flight should count as dropped"
+            fan.step()
+            fan.close()
+    finally:
+        sender.close()
+        receiver.close()
+        server.close()
+
+def test_replay():
+    import os
+    import struct
+    print("Test replay")
+    path = '/tmp/host_test.mcr'
+    frames = []
+    with Camera(pixel_format=PixelFormat.GRAYSCALE) as cam, open(path, 'wb') as f:
+        f.write(b'MPCR' + struct.pack('<BBHHHI', 1, PixelFormat.GRAYSCALE, 0, 160, 120, 0))
+        for _ in range(5):
+            with cam.capture() as frame:
+                frames.append((frame.timestamp, bytes(frame)))
+                f.write(struct.pack('<qI', frame.timestamp, len(frame)))
+                f.write(frame)
+    os.putenv('MICROPY_CAMERA_REPLAY', path)
+    try:
+        with Camera() as cam:
+            assert cam.get_pixel_format() == PixelFormat.GRAYSCALE, "The recording defines the pixel format"
+            last = None
+            for i in range(1, 8):   # The constructor captured frame 0
+                img = cam.capture()
+                assert bytes(img) == frames[i % 5][1], "Frames are replayed in order and repeat"
+                if 1 < i < 5:
+                    assert img.timestamp - last == frames[i][0] - frames[i - 1][0], "Replays keep the timing"
+                last = img.timestamp
+            try:
+                cam.reconfigure(pixel_format=PixelFormat.RGB565)
+                assert False, "The pixel format of a replay cannot change"
+            except ValueError:
+                pass
+    finally:
+        os.unsetenv('MICROPY_CAMERA_REPLAY')
+
+def test_avi_recorder():
+    import struct
+    from camera import AVIRecorder
+    print("Test AVI recorder")
+    path = '/tmp/host_test.avi'
+    with Camera(pixel_format=PixelFormat.JPEG, frame_size=FrameSize.QVGA) as cam, open(path, 'wb') as f:
+        with AVIRecorder(cam, f, buffer_size=32768, batch_size=4096) as rec:
+            recorded = sum(rec.step() for _ in range(20))
+            s = rec.stats()
+        assert recorded == s['frames'] == 20 and s['dropped'] == s['skipped'] == 0
+        assert abs(s['fps'] - 30) < 1, "Back to back steps record every sensor frame"
+    with open(path, 'rb') as f:
+        data = f.read()
+    riff, size, avi = struct.unpack('<4sI4s', data[:12])
+    assert riff == b'RIFF' and avi == b'AVI ' and size == len(data) - 8
+    assert struct.unpack('<II', data[64:72]) == (320, 240), "avih contains the frame size"
+    assert struct.unpack('<I', data[48:52])[0] == recorded, "avih contains the number of frames"
+    assert data[508:512] == b'movi', "Frame data starts at a sector boundary"
+    offset, chunks = 512, []
+    while data[offset:offset + 4] == b'00dc':
+        length = struct.unpack('<I', data[offset + 4:offset + 8])[0]
+        assert data[offset + 8:offset + 10] == b'\xff\xd8'
+        chunks.append((offset - 508, length))
+        offset += 8 + length + (length & 1)
+    assert data[offset:offset + 4] == b'idx1' and len(chunks) == recorded
+    for i, chunk in enumerate(chunks):
+        entry = struct.unpack('<4sIII', data[offset + 8 + 16 * i:offset + 24 + 16 * i])
+        assert entry == (b'00dc', 0x10) + chunk, "The index points to the frames"
+
+def test_pre_event_buffer():
+    import struct
+    from camera import PreEventBuffer
+    print("Test pre-event buffer")
+    frame_len = 160 * 120
+    with Camera(pixel_format=PixelFormat.GRAYSCALE) as cam:
+        pre = PreEventBuffer(5 * frame_len + 1000)
+        frames = []
+        for _ in range(10):
+            img = cam.capture()
+            frames.append((img.timestamp, bytes(img)))
+            assert pre.add(img)
+        s = pre.stats()
+        assert s['frames'] == len(pre) == 5 and s['bytes'] == 5 * frame_len, "The byte budget evicts the oldest frames"
+        assert s['evicted'] == 5 and s['span_us'] == frames[-1][0] - frames[5][0]
+        with open('/tmp/host_test_pre.mcr', 'wb') as f:
+            assert pre.dump(f) == 5
+        with open('/tmp/host_test_pre.mcr', 'rb') as f:
+            assert f.read(16) == b'MPCR' + struct.pack('<BBHHHI', 1, PixelFormat.GRAYSCALE, 0, 160, 120, 0)
+            for timestamp, data in frames[5:]:
+                assert struct.unpack('<qI', f.read(12)) == (timestamp, frame_len)
+                assert f.read(frame_len) == data, "Dumps contain the window, oldest frame first"
+
+        pre = PreEventBuffer(10 * frame_len, max_age_ms=FRAME_PERIOD_US * 3 // 1000 + 1)
+        for _ in range(6):
+            pre.add(cam.capture())
+        assert len(pre) == 4, "Frames older than max_age_ms are evicted"
+
+        pre.clear()
+        cam.on_frame(pre.add)
+        time.sleep_ms(300)
+        cam.on_frame(None)
+        assert len(pre) > 5 and pre.stats()['dropped'] == 0
+
+def test_encode_jpeg():
+    import io
+    from camera import encode_jpeg
+    print("Test JPEG encoder")
+    with Camera(pixel_format=PixelFormat.RGB565) as cam:
+        img = cam.capture(hold=True)
+        jpeg = encode_jpeg(img, quality=80)
+        assert jpeg.format == PixelFormat.JPEG and (jpeg.width, jpeg.height) == (160, 120)
+        assert jpeg.timestamp == img.timestamp and jpeg.sequence == img.sequence
+        data = bytes(jpeg)
+        assert data[:2] == b'\xff\xd8' and data[-2:] == b'\xff\xd9' and len(data) < len(img) // 4
+        out = io.BytesIO()
+        assert encode_jpeg(img, out, quality=80, chunk_size=64) == len(data)
+        assert out.getvalue() == data, "Streamed and in-memory JPEGs are the same"
+        assert len(encode_jpeg(img, quality=10)) < len(data)
+        assert len(encode_jpeg(img, quality=80, subsampling=444)) > len(data)
+        for kwargs in ({'subsampling': 411}, {'quality': 101}):
+            try:
+                encode_jpeg(img, **kwargs)
+                assert False, "Invalid arguments should be rejected"
+            except ValueError:
+                pass
+        img.release()
+
+        cam.quality = 80
+        assert bytes(cam.capture(PixelFormat.JPEG))[:2] == b'\xff\xd8', "Captures are encoded in software"
+        buf = bytearray(16 * 1024)
+        n = cam.capture_into(buf, PixelFormat.JPEG)
+        assert buf[:2] == b'\xff\xd8' and buf[n - 2:n] == b'\xff\xd9'
+        try:
+            cam.capture_into(bytearray(1000), PixelFormat.JPEG)
+            assert False, "The JPEG does not fit"
+        except ValueError:
+            pass
+        thumb = cam.capture(PixelFormat.JPEG, bin=2)
+        assert thumb.format == PixelFormat.JPEG and (thumb.width, thumb.height) == (80, 60)
+
+        cam.reconfigure(pixel_format=PixelFormat.GRAYSCALE)
+        assert bytes(encode_jpeg(cam.capture()))[:2] == b'\xff\xd8'
+        cam.reconfigure(pixel_format=PixelFormat.RGB888)
+        try:
+            encode_jpeg(cam.capture())
+            assert False, "RGB888 cannot be encoded"
+        except ValueError:
+            pass
+
+if __name__ == "__main__":
+    test_sensor_info()
+    test_pixel_formats()
+    test_frame_sizes()
+    test_colorbar()
+    test_moving_scene()
+    test_brightness()
+    test_frame_timing()
+    test_reconfigure()
+    test_apply_snapshot()
+    test_deferred_apply()
+    test_on_frame()
+    test_poll()
+    test_fanout_nonblocking()
+    test_fanout_free_buffer()
+    test_replay()
+    test_avi_recorder()
+    test_pre_event_buffer()
+    test_encode_jpeg()
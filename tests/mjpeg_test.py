@@ -0,0 +1,85 @@
+import io
+import socket
+from camera import MJPEGWriter
+
+# Tests for the native MJPEG multipart writer.
+# They use in-memory streams and a local socket, so they do not need a camera and also run on a host build.
+
+FRAME = bytes(range(256)) * 8
+
+def parse_parts(data, boundary):
+    parts = []
+    while data:
+        header, _, rest = data.partition(b'\r\n\r\n')
+        lines = header.split(b'\r\n')
+        assert lines[0] == b'--' + boundary, "Part should start with the boundary"
+        length = None
+        for line in lines[1:]:
+            if line.startswith(b'Content-Length: '):
+                length = int(line[16:])
+        assert b'Content-Type: image/jpeg' in lines, "Part should have a content type"
+        parts.append(rest[:length])
+        assert rest[length:length + 2] == b'\r\n', "Part should end with CRLF"
+        data = rest[length + 2:]
+    return parts
+
+def test_multipart():
+    stream = io.BytesIO()
+    writer = MJPEGWriter(stream, 'frame')
+    assert writer.content_type == 'multipart/x-mixed-replace; boundary=frame'
+    n = writer.write(FRAME)
+    assert n == len(stream.getvalue()), "write should return the size of the part"
+    writer.write(b'\xff\xd8\xff\xd9')
+    data = stream.getvalue()
+    assert parse_parts(data, b'frame') == [FRAME, b'\xff\xd8\xff\xd9']
+
+def test_raw():
+    stream = io.BytesIO()
+    writer = MJPEGWriter(stream, None)
+    writer.write(FRAME)
+    writer.write(memoryview(FRAME)[:10])
+    assert stream.getvalue() == FRAME + FRAME[:10], "Without boundary only the frame data is written"
+
+def test_invalid():
+    try:
+        MJPEGWriter(io.BytesIO(), 'x' * 71)
+        assert False, "Too long boundary should raise ValueError"
+    except ValueError:
+        pass
+    try:
+        MJPEGWriter(42)
+        assert False, "Non-stream should raise"
+    except (TypeError, OSError):
+        pass
+
+def test_socket(port=8765):
+    addr = socket.getaddrinfo('127.0.0.1', port)[0][-1]
+    server = socket.socket()
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server.bind(addr)
+    server.listen(1)
+    sender = socket.socket()
+    sender.connect(addr)
+    receiver, _ = server.accept()
+    try:
+        writer = MJPEGWriter(sender, b'boundary')
+        for i in range(3):
+            writer.write(FRAME[:100 * (i + 1)])
+        sender.close()
+        data = b''
+        while True:
+            chunk = receiver.recv(1024)
+            if not chunk:
+                break
+            data += chunk
+        assert parse_parts(data, b'boundary') == [FRAME[:100], FRAME[:200], FRAME[:300]]
+    finally:
+        receiver.close()
+        server.close()
+
+if __name__ == "__main__":
+    test_multipart()
+    test_raw()
+    test_invalid()
+    test_socket()
+    print("MJPEG writer tests passed")
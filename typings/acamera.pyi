@@ -1,12 +1,13 @@
 from camera import Camera as _Camera
-from camera import FrameSize, PixelFormat, GainCeiling, GrabMode
+from camera import FrameSize, PixelFormat, GainCeiling, GrabMode, Frame
 
 class Camera(_Camera):
-    async def acapture(self) -> memoryview:
-        """Asynchronously capture a frame and return it as a memoryview.
+    async def acapture(self, out_format: int | None = None, *, hold: bool = False) -> Frame | None:
+        """Asynchronously capture a frame and return it as a Frame.
         
-        Yields control back to the event loop while waiting for a frame to become available.
+        Waits for a frame by polling the camera through the event loop, so other tasks run (and the
+        CPU idles) while the frame is pending. The arguments are the same as for capture.
         """
         ...
 
-__all__ = ['Camera', 'FrameSize', 'PixelFormat', 'GainCeiling', 'GrabMode']
\ No newline at end of file
+__all__ = ['Camera', 'FrameSize', 'PixelFormat', 'GainCeiling', 'GrabMode', 'Frame']
\ No newline at end of file
@@ -1,5 +1,5 @@
 from __future__ import annotations
-from typing import Final
+from typing import Callable, Final
 
 class GainCeiling():
     X2: Final[int] = 0    # 2X gain
@@ -63,6 +63,63 @@ class FrameSize():
         ...
 
 
+class Frame():
+    """A captured frame. Supports the buffer protocol, len() and slicing.
+
+    Frames of the camera point directly into the driver frame buffer. They stay valid until they
+    are released, the next frame is captured, free_buffer() is called or the camera is deinitialized.
+    Accessing the data of an invalid frame raises ValueError. bool(frame) tells if a frame is still valid.
+    The validity is only checked when the buffer is acquired: a memoryview(frame) points into the driver
+    buffer and must not outlive the with block of the frame or release(). Slices are bytes copies, so they
+    stay valid after the frame has been released.
+    """
+    def __init__(self, data: bytes | bytearray | memoryview, width: int, height: int, format: int, *,
+                 timestamp: int = 0) -> None:
+        """Create a frame owning a copy of data, e.g. to process synthetic or stored images.
+
+        Raises ValueError if data is smaller than width*height pixels of format (not checked for JPEG, YUV420 and RAW).
+        """
+        ...
+
+    @property
+    def width(self) -> int:
+        """Frame width in pixels."""
+        ...
+
+    @property
+    def height(self) -> int:
+        """Frame height in pixels."""
+        ...
+
+    @property
+    def format(self) -> int:
+        """Pixel format of the frame data (PixelFormat)."""
+        ...
+
+    @property
+    def timestamp(self) -> int:
+        """Capture timestamp of the driver in microseconds."""
+        ...
+
+    @property
+    def sequence(self) -> int:
+        """Sensor frame number. A gap to the previous frame is the number of frames dropped in between."""
+        ...
+
+    def release(self) -> None:
+        """Give the frame buffer back to the driver. The frame cannot be used afterwards."""
+        ...
+
+    def __len__(self) -> int:
+        ...
+
+    def __enter__(self) -> Frame:
+        ...
+
+    def __exit__(self, *args) -> None:
+        ...
+
+
 class Camera():
     def __init__(self, *,
                  data_pins: list[int] | None = None,
@@ -359,8 +416,13 @@ class Camera():
     def reconfigure(self, *, frame_size: int | None = None,
                    pixel_format: int | None = None,
                    grab_mode: int | None = None,
-                   fb_count: int | None = None) -> None:
-        """Reconfigure camera with new settings."""
+                   fb_count: int | None = None) -> str:
+        """Reconfigure camera with new settings.
+
+        Returns how the settings were applied: 'none' if nothing changed, 'sensor' if the sensor applied them
+        and the frame buffers were reused (JPEG frame sizes which fit into the buffers, RGB565 <-> YUV422),
+        'restart' if the driver had to be restarted.
+        """
         ...
 
     def init(self) -> None:
@@ -375,12 +437,105 @@ class Camera():
         """Check if a frame is available."""
         ...
 
-    def capture(self) -> memoryview:
-        """Capture a frame and return it as a memoryview."""
+    def capture(self, out_format: int | None = None, *, hold: bool = False,
+                roi: tuple[int, int, int, int] | None = None, bin: int = 1) -> Frame | None:
+        """Capture a frame and return it as a Frame.
+
+        A frame is returned to the driver on the next capture, unless hold is True. Held frames
+        stay valid until they are released or free_buffer() is called. At most fb_count frames can be
+        held at once; further captures raise OSError until a frame is released.
+
+        If out_format is given and differs from the configured pixel format, the frame is
+        converted natively into a Frame owning its data, which stays valid until it is released.
+        RGB565, YUV422 and GRAYSCALE frames are converted to JPEG by the software encoder (see encode_jpeg).
+
+        roi=(x, y, w, h) crops and bin (1, 2 or 4) averages bin x bin pixel blocks in a single pass
+        (RGB565, RGB888, GRAYSCALE and YUV422 only). The result is a Frame owning its data of
+        w//bin x h//bin pixels; hold is ignored. Raises ValueError if the region exceeds the frame.
+        """
+        ...
+
+    def capture_into(self, buf: bytearray | memoryview, out_format: int | None = None) -> int | None:
+        """Capture a frame into a preallocated buffer and return the number of bytes written.
+
+        The frame buffer is given back to the driver before the method returns, and no memory is allocated.
+        Raises ValueError if buf is too small. Returns None if no frame could be captured.
+        """
+        ...
+
+    def on_frame(self, callback: Callable[[Frame], None] | None) -> None:
+        """Call callback(frame) for every new frame, or stop with None.
+
+        Frames are grabbed by a background task and the callback is scheduled with micropython.schedule.
+        If the callback falls behind, pending frames are replaced by newer ones (coalescing).
+        The frame is only valid during the callback.
+        """
+        ...
+
+    def stream_mjpeg(self, sock, *, boundary: str | bytes = "frame", max_fps: int = 0, max_frames: int = 0) -> int:
+        """Stream JPEG frames as multipart MJPEG parts to sock.
+
+        Headers and frame buffers are written directly to the socket. Returns the number of frames sent,
+        when the client disconnects or max_frames (0 = no limit) have been sent. max_fps limits the frame rate.
+        The camera must use PixelFormat.JPEG. The HTTP response header must be sent before.
+        """
         ...
 
     def free_buffer(self) -> None:
-        """Free the frame buffer."""
+        """Free all frame buffers handed out by capture, including held ones."""
+        ...
+
+    def apply(self, settings: dict, *, deferred: bool = False) -> tuple[str, ...]:
+        """Apply a dict of sensor settings (e.g. {'contrast': 1, 'vflip': True}) as one batch.
+
+        All settings are validated before anything is written; unknown names, settings the sensor does not
+        have and values out of range raise ValueError. Only changed values are written and all of them are
+        verified at the end. Returns the names of the settings which did not take effect.
+        With deferred=True the batch is applied right after the next frame is captured and frames started
+        while it was written are dropped, so no frame is captured with half-applied settings.
+        """
+        ...
+
+    def snapshot(self) -> bytes:
+        """Save the frame size and all sensor settings (contrast, exposure, gains, mirroring, ...) in a compact binary form."""
+        ...
+
+    def restore(self, snapshot: bytes, *, deferred: bool = False) -> tuple[str, ...]:
+        """Restore a snapshot of the same sensor model in one call, e.g. after a reboot or reconfigure.
+
+        The settings are applied as one batch like apply(). Raises ValueError for invalid snapshots and
+        snapshots of another sensor model. Returns the names of the settings which did not take effect.
+        """
+        ...
+
+    def perf(self, reset: bool = False) -> dict:
+        """Return the performance counters since the last reset as dict with the keys:
+
+        - captures: capture calls (capture, capture_into and the frame callback)
+        - failed: captures which got no frame from the driver
+        - capture_rate: captures per second
+        - fb_get: time blocked waiting for the driver to deliver a frame
+        - hold: time a frame buffer was out of the driver (from capture until it was released)
+        - init, reconfigure: durations of init and of reconfigurations which restarted the driver
+        - switch_sensor: durations of reconfigurations applied by the sensor alone
+        - buckets_us: upper bounds of the histogram buckets in microseconds
+
+        The durations are dicts with count, mean_us, max_us and histogram (counts per bucket; the last bucket
+        counts everything above the last bound). With reset=True, all counters start from 0 again.
+        """
+        ...
+
+    def frame_stats(self, reset: bool = False) -> dict:
+        """Return the frame counters as dict with the keys:
+
+        - captured: frames grabbed from the driver
+        - dropped: sensor frames between the grabbed frames, estimated from the driver timestamps
+        - overwritten: frames of the frame callback replaced by a newer one before they were handed out
+        - sequence: sequence number of the last frame
+        - sensor_fps: frame rate of the sensor, estimated from the timestamps (None if unknown)
+
+        With reset=True, captured, dropped and overwritten start from 0 again.
+        """
         ...
 
     # Deprecated methods (use properties instead)
@@ -620,3 +775,260 @@ class Camera():
         """Deprecated: Use the grab_mode property instead."""
         ...
 
+
+class MJPEGWriter:
+    """Writes frames as multipart MJPEG parts to a stream."""
+
+    content_type: str
+    """Value for the Content-Type header of the HTTP response."""
+
+    def __init__(self, stream, boundary: str | bytes | None = "frame") -> None:
+        """Create a writer for stream. Without boundary, only the frame data is written."""
+        ...
+
+    def write(self, frame: Frame | bytes | bytearray | memoryview) -> int:
+        """Write a complete part (header, frame data and trailer) and return its size in bytes.
+
+        Partial writes are resumed. Raises OSError if the stream fails.
+        """
+        ...
+
+
+class FanOut:
+    """Captures each frame once and distributes it to several sinks with their own send progress."""
+
+    def __init__(self, camera: Camera, *, boundary: str | bytes | None = "frame", max_fps: int = 0) -> None:
+        """Create a fan-out for camera. boundary is the default multipart boundary of the sinks."""
+        ...
+
+    def add(self, sink, boundary: str | bytes | None = ...) -> None:
+        """Add a stream (e.g. socket or file). Sockets are switched to non-blocking mode.
+
+        Without boundary, only the frame data is written.
+        """
+        ...
+
+    def remove(self, sink) -> None:
+        """Remove a sink. Raises ValueError if it has not been added."""
+        ...
+
+    def step(self) -> list | tuple:
+        """Send pending data and, if due, capture a frame and hand it to all idle sinks.
+
+        Sinks which are still busy with an older frame drop the new one. Returns the sinks which have
+        disconnected (and have been removed).
+        """
+        ...
+
+    def stats(self) -> list[tuple[object, int, int]]:
+        """Return (sink, delivered, dropped) for each sink."""
+        ...
+
+    def close(self) -> None:
+        """Give the frame buffer of the last capture back to the driver."""
+        ...
+
+    def __len__(self) -> int: ...
+
+
+class AVIRecorder:
+    """Records JPEG frames into an AVI (MJPEG) file, with a staging buffer between capture and storage."""
+
+    def __init__(self, camera: Camera, stream, *, buffer_size: int = 131072, batch_size: int = 16384) -> None:
+        """Create a recorder writing to stream, which must be writable and seekable (e.g. a file).
+
+        buffer_size is rounded up to at least two batches. batch_size must be a multiple of 512.
+        """
+        ...
+
+    def step(self) -> bool:
+        """Capture a frame, stage it and write staged data. Return False if no frame was recorded.
+
+        One batch is written per step, or more while the staging buffer is more than half full.
+        Frames which do not fit into the staging buffer are dropped.
+        """
+        ...
+
+    def add(self, frame: Frame) -> bool:
+        """Record a JPEG frame like step, but without capturing. Return False if it was dropped."""
+        ...
+
+    def flush(self) -> None:
+        """Write all staged data."""
+        ...
+
+    def close(self) -> None:
+        """Write the staged data and the index, and complete the header. The stream is not closed."""
+        ...
+
+    def stats(self) -> dict:
+        """Return frames, dropped, skipped (sensor frames never captured), bytes (written), pending (staged bytes),
+        fps (achieved frame rate) and max_write_us (longest write)."""
+        ...
+
+    def __enter__(self) -> AVIRecorder:
+        ...
+
+    def __exit__(self, *args) -> None:
+        ...
+
+
+class PreEventBuffer:
+    """Ring buffer of the most recent frames within a byte budget, e.g. the frames before an event."""
+
+    def __init__(self, size: int, *, max_frames: int = 300, max_age_ms: int = 0) -> None:
+        """Create a buffer of size bytes for up to max_frames frames.
+
+        With max_age_ms, frames older than max_age_ms before the newest frame are evicted too.
+        """
+        ...
+
+    def add(self, frame: Frame) -> bool:
+        """Copy frame into the buffer, evicting the oldest frames until it fits. Can be passed to Camera.on_frame.
+
+        Return False if the frame is larger than the buffer or a dump is in progress. A frame of another pixel
+        format or size clears the buffer.
+        """
+        ...
+
+    def dump(self, stream) -> int:
+        """Write the frames, oldest first, in the recording format of examples/record.py and return their number.
+
+        The frames stay in the buffer.
+        """
+        ...
+
+    def clear(self) -> None:
+        """Remove all frames and reset the statistics."""
+        ...
+
+    def stats(self) -> dict:
+        """Return frames, bytes, span_us (from the oldest to the newest frame), evicted and dropped."""
+        ...
+
+    def __len__(self) -> int: ...
+
+
+class MotionDetector:
+    """Block based motion detection on GRAYSCALE and YUV422 frames.
+
+    Frames are downsampled by scale and compared to a reference frame in grid blocks. A block moves, if the
+    mean absolute luma difference of its pixels exceeds threshold.
+    """
+
+    mask: bytearray
+    """cols x rows bytes of the last frame, 1 for moving blocks (row by row). Overwritten by detect."""
+    moving: int
+    """Number of moving blocks of the last frame."""
+    grid: tuple[int, int]
+    threshold: int
+
+    def __init__(self, *, grid: tuple[int, int] = (16, 12), threshold: int = 12, scale: int = 4,
+                 learn: float = 1.0) -> None:
+        """Create a detector with a grid of up to 32 x 32 blocks and scale 1, 2, 4 or 8.
+
+        learn is the weight of the current frame in the new reference: 1.0 compares to the previous frame,
+        smaller values compare to a slowly adapting background.
+        """
+        ...
+
+    def detect(self, frame: Frame) -> float:
+        """Compare frame to the reference and return the fraction of moving blocks (0.0 to 1.0).
+
+        The first frame (and the first after a reset or frame size change) only sets the reference and returns 0.0.
+        """
+        ...
+
+    def boxes(self, max_boxes: int = 8) -> list[tuple[int, int, int, int]]:
+        """Return the bounding boxes (x, y, w, h) of connected moving blocks of the last frame in frame pixels.
+
+        If there are more regions than max_boxes (at most 16), the largest ones are returned.
+        """
+        ...
+
+    def reset(self) -> None:
+        """Drop the reference frame."""
+        ...
+
+
+class AutoExposure:
+    """Software auto exposure and white balance loop.
+
+    Drives aec_value and agc_gain toward a target mean luma and steps through the white balance presets
+    (wb_mode) until the gray world means of red and blue are balanced. The sensor's own exposure and gain
+    control are switched off while the loop runs.
+    """
+
+    converged: bool
+    """True while luma and white balance are within tolerance."""
+    convergence_ms: int
+    """Time the loop needed to converge the last time it left the tolerance band (or after start)."""
+    convergence_frames: int
+    """Frames the loop needed to converge the last time."""
+    luma: int
+    """Filtered mean luma of the last update."""
+    target: int
+
+    def __init__(self, camera: Camera, *, target: int = 110, gain: float = 0.7, damping: float = 0.2,
+                 interval: int = 2, tolerance: int = 8, stride: int = 4, awb: bool = True,
+                 max_exposure: int = 1200, max_gain: int = 30) -> None:
+        """Start the loop on camera.
+
+        gain is the fraction of the exposure error corrected per update, damping the weight of the previous
+        luma in the filtered luma. The loop updates every interval frames, since the sensor applies new settings
+        with a delay. stride is the sampling stride of the statistics. Once converged, the luma may drift up to
+        twice the tolerance before the exposure is changed again.
+        """
+        ...
+
+    def update(self, frame: Frame) -> bool:
+        """Feed a RGB565, RGB888, GRAYSCALE or YUV422 frame to the loop and return converged."""
+        ...
+
+    def stop(self) -> None:
+        """Stop the loop and hand exposure, gain and white balance back to the sensor."""
+        ...
+
+
+def convert(src: bytes | bytearray | memoryview, src_format: int, dst_format: int, *,
+            out: bytearray | memoryview | None = None) -> bytearray | int:
+    """Convert raw pixels from src_format into dst_format.
+
+    Returns a new bytearray, or the number of bytes written if an output buffer is given.
+    YUV422 is converted in pairs of pixels, a trailing odd pixel of a YUV422 source is ignored.
+    """
+    ...
+
+
+def encode_jpeg(frame: Frame, stream: object | None = None, *, quality: int | None = None,
+                subsampling: int = 420, chunk_size: int = 512) -> Frame | int:
+    """Encode a RGB565, YUV422 or GRAYSCALE frame into a baseline JPEG in software.
+
+    Without stream, returns a new JPEG Frame owning its data (with the timestamp and sequence of frame).
+    With stream, writes the JPEG in chunks of chunk_size bytes while encoding and returns the number of bytes written.
+    quality (0-100) defaults to the quality of the camera, subsampling is 420, 422 or 444.
+    """
+    ...
+
+
+def stats(frame: Frame, *, stride: int = 1, grid: tuple[int, int] = (4, 4), bins: int = 256) -> dict:
+    """Compute image statistics of a RGB565, RGB888, GRAYSCALE or YUV422 frame in one pass.
+
+    Returns a dict with the keys:
+    - histogram: list of bins luma counts (bins is a power of 2 up to 256)
+    - luma: mean luma
+    - mean, min, max: per channel tuples, (R, G, B), (Y, U, V) or (Y,)
+    - grid: bytes of cols x rows block mean lumas (row by row, up to 32 x 32 blocks)
+    - samples: number of sampled pixels
+    Only every stride-th pixel of every stride-th row is sampled.
+    """
+    ...
+
+
+def estimate_memory(frame_size: int, pixel_format: int, fb_count: int = 1) -> dict:
+    """Estimate the frame buffer memory of a configuration and check it against the free PSRAM.
+
+    Returns a dict with the keys fb_size, required, available, largest_block, max_fb_count and fits.
+    The buffers of a running camera are counted as available, since reconfigure frees them first.
+    """
+    ...